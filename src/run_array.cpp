@@ -0,0 +1,340 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_array.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Drive array
+ *
+ * Simulates several independent SSDs in one process, each on a thread of a
+ * pool.  The drives share only the configuration, which is loaded before the
+ * threads start, so they scale with the number of cores.
+ *
+ * By default the drives form a RAID 0 array: a host workload of single-page
+ * requests over the logical pages of the array is cut into stripes of
+ * stripe_pages pages laid out round the drives, and each drive serves the
+ * requests that fall on it at their start times.  With -o the drives instead
+ * sweep the overprovisioning: one drive for each listed percentage, each
+ * serving the whole workload over its own logical pages.
+ *
+ * The workload is uniform random pages from the working set, half the
+ * logical pages of each drive since the block-mapped FTL runs out of log
+ * blocks on a full device, one request every interarrival time.  A read of a
+ * page that was not written yet is issued as a write.  Every worker generates
+ * the workload itself from the same seed and keeps the requests of its drive,
+ * so no state is shared while the drives run.
+ *
+ * Output is one comma-separated line per drive after a header line:
+ * 	drive,overprovisioning,requests,failed,host_pages,flash_pages,wa,erases,
+ * 	max_block_erases,read_p99,write_p99,finish_time,cpu_seconds
+ * followed by the wall time of the whole run and its speedup, the processor
+ * time of all drives over the wall time.
+ *
+ * usage: array [-d drives] [-j threads] [-n requests] [-r read_percent]
+ * 		[-s stripe_pages] [-i interarrival] [-o percent,...] [-l log] config
+ * 	-l logs drive i to log.i instead of discarding the FTL log
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* requests per batch */
+#define ARRAY_CHUNK 4096
+
+/* seed of the workload, the same for every drive */
+#define ARRAY_SEED 88172645463325252ULL
+
+/* the run, shared read-only by the workers */
+struct array_options
+{
+	unsigned int drives;
+	unsigned long requests;
+	unsigned int read_percent;
+	unsigned long stripe_pages;
+	double interarrival;
+	bool sweep;
+	std::vector<double> overprovisioning;
+	const char *log_name;
+};
+
+/* the results of one drive, written only by the worker that ran it */
+struct drive_result
+{
+	double overprovisioning;
+	unsigned long requests;
+	unsigned long failed;
+	unsigned long host_pages;
+	unsigned long flash_pages;
+	double write_amplification;
+	unsigned long erases;
+	unsigned long max_block_erases;
+	double read_p99;
+	double write_p99;
+	double finish_time;
+	double cpu_seconds;
+};
+
+static double wall_time(void)
+{
+	struct timespec now;
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* processor time of the calling thread, which does not count the time other
+ * 	threads ran when there are more threads than cores */
+static double thread_time(void)
+{
+	struct timespec now;
+	(void) clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* xorshift64, one generator per worker */
+static uint64_t next_random(uint64_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+/* working set of a drive, whole stripes of it in array mode */
+static unsigned long working_set(const Geometry &geometry, const struct array_options &options)
+{
+	unsigned long span = geometry.get_usable_pages() / 2;
+	if(!options.sweep)
+		span -= span % options.stripe_pages;
+	return span;
+}
+
+/* pass a chunk of requests to the drive as one batch and empty it */
+static void serve(Ssd &ssd, std::vector<struct request> &requests, struct drive_result &result)
+{
+	struct completion completions[ARRAY_CHUNK];
+	unsigned long i;
+	assert(requests.size() <= ARRAY_CHUNK);
+	if(requests.empty())
+		return;
+	ssd.submit_batch(&requests[0], requests.size(), completions);
+	for(i = 0; i < requests.size(); i++)
+	{
+		if(completions[i].status != SUCCESS)
+			result.failed++;
+		if(requests[i].start_time + completions[i].time_taken > result.finish_time)
+			result.finish_time = requests[i].start_time + completions[i].time_taken;
+	}
+	result.requests += requests.size();
+	requests.clear();
+	return;
+}
+
+/* generate the workload and serve the requests that fall on one drive */
+static void run_drive(unsigned int drive, const struct array_options &options, struct drive_result &result)
+{
+	double overprovisioning = options.sweep ? options.overprovisioning[drive] : OVERPROVISIONING;
+	Geometry geometry(SSD_SIZE, PACKAGE_SIZE, DIE_SIZE, PLANE_SIZE, BLOCK_SIZE, overprovisioning);
+	unsigned long span = working_set(geometry, options);
+	unsigned long host_span = options.sweep ? span : span * options.drives;
+	std::vector<bool> written(span, false);
+	std::vector<struct request> requests;
+	uint64_t random = ARRAY_SEED;
+	unsigned long i;
+	double start = thread_time();
+
+	memset(&result, 0, sizeof(result));
+	result.overprovisioning = overprovisioning;
+
+	std::string log_name = "/dev/null";
+	if(options.log_name != NULL)
+	{
+		char suffix[16];
+		snprintf(suffix, sizeof(suffix), ".%u", drive);
+		log_name = std::string(options.log_name) + suffix;
+	}
+	FILE *log_file = fopen(log_name.c_str(), "w");
+	if(log_file == NULL)
+	{
+		fprintf(stderr, "Log file %s could not be opened.  Exiting.\n", log_name.c_str());
+		exit(FILE_ERR);
+	}
+	Ssd *ssd = new Ssd(log_file, geometry);
+
+	requests.reserve(ARRAY_CHUNK);
+	for(i = 0; i < options.requests; i++)
+	{
+		unsigned long page = next_random(&random) % host_span;
+		bool read = next_random(&random) % 100 < options.read_percent;
+		if(!options.sweep)
+		{
+			/* RAID 0: stripe s of the array is stripe s / drives of drive
+			 * 	s % drives */
+			unsigned long stripe = page / options.stripe_pages;
+			if(stripe % options.drives != drive)
+				continue;
+			page = (stripe / options.drives) * options.stripe_pages + page % options.stripe_pages;
+		}
+
+		struct request req;
+		memset(&req, 0, sizeof(req));
+		req.type = (read && written[page]) ? READ : WRITE;
+		req.logical_address = page;
+		req.size = 1;
+		req.start_time = i * options.interarrival;
+		written[page] = true;
+		requests.push_back(req);
+		if(requests.size() == ARRAY_CHUNK)
+			serve(*ssd, requests, result);
+	}
+	serve(*ssd, requests, result);
+
+	result.host_pages = ssd -> get_total_host_writes();
+	result.flash_pages = ssd -> get_total_writes_observed();
+	result.write_amplification = ssd -> get_write_amplification();
+	result.erases = ssd -> get_total_erases_performed();
+	result.max_block_erases = ssd -> get_wear_summary().max_erases;
+	result.read_p99 = ssd -> get_latency_percentile(READ, 0.99);
+	result.write_p99 = ssd -> get_latency_percentile(WRITE, 0.99);
+	delete ssd;
+	fclose(log_file);
+	result.cpu_seconds = thread_time() - start;
+	return;
+}
+
+/* take drives off the shared counter until none are left */
+static void worker(const struct array_options *options, std::atomic<unsigned int> *next_drive, struct drive_result *results)
+{
+	unsigned int drive;
+	while((drive = (*next_drive)++) < options -> drives)
+		run_drive(drive, *options, results[drive]);
+	return;
+}
+
+/* parse a comma-separated list of percentages */
+static bool parse_percentages(const char *list, std::vector<double> &values)
+{
+	char *end;
+	values.clear();
+	while(*list != '\0')
+	{
+		double value = strtod(list, &end);
+		if(end == list || value < 0.0 || value >= 100.0)
+			return false;
+		values.push_back(value);
+		list = (*end == ',') ? end + 1 : end;
+		if(*end != ',' && *end != '\0')
+			return false;
+	}
+	return !values.empty();
+}
+
+int main(int argc, char **argv)
+{
+	struct array_options options;
+	unsigned int threads = std::thread::hardware_concurrency();
+	unsigned int i;
+	int option;
+	bool usage = false;
+
+	options.drives = 4;
+	options.requests = 1000000;
+	options.read_percent = 30;
+	options.stripe_pages = 16;
+	options.interarrival = 0.0001;
+	options.sweep = false;
+	options.log_name = NULL;
+	while((option = getopt(argc, argv, "d:j:n:r:s:i:o:l:")) != -1)
+	{
+		if(option == 'd')
+			options.drives = strtoul(optarg, NULL, 10);
+		else if(option == 'j')
+			threads = strtoul(optarg, NULL, 10);
+		else if(option == 'n')
+			options.requests = strtoul(optarg, NULL, 10);
+		else if(option == 'r')
+			options.read_percent = strtoul(optarg, NULL, 10);
+		else if(option == 's')
+			options.stripe_pages = strtoul(optarg, NULL, 10);
+		else if(option == 'i')
+			options.interarrival = strtod(optarg, NULL);
+		else if(option == 'o')
+		{
+			options.sweep = true;
+			usage |= !parse_percentages(optarg, options.overprovisioning);
+		}
+		else if(option == 'l')
+			options.log_name = optarg;
+		else
+			usage = true;
+	}
+	if(options.sweep)
+		options.drives = options.overprovisioning.size();
+	if(usage || optind + 1 != argc || options.drives == 0 || options.stripe_pages == 0 || options.read_percent > 100 || options.interarrival < 0.0)
+	{
+		fprintf(stderr, "usage: %s [-d drives] [-j threads] [-n requests] [-r read_percent] [-s stripe_pages] [-i interarrival] [-o percent,...] [-l log] config\n", argv[0]);
+		exit(FILE_ERR);
+	}
+	if(threads == 0)
+		threads = 1;
+	if(threads > options.drives)
+		threads = options.drives;
+
+	load_config(argv[optind]);
+	for(i = 0; i < options.drives; i++)
+	{
+		double overprovisioning = options.sweep ? options.overprovisioning[i] : OVERPROVISIONING;
+		if(working_set(Geometry(SSD_SIZE, PACKAGE_SIZE, DIE_SIZE, PLANE_SIZE, BLOCK_SIZE, overprovisioning), options) == 0)
+		{
+			fprintf(stderr, "Drive %u has no working set.  Exiting.\n", i);
+			exit(FILE_ERR);
+		}
+	}
+
+	std::vector<struct drive_result> results(options.drives);
+	std::vector<std::thread> pool;
+	std::atomic<unsigned int> next_drive(0);
+	double start = wall_time();
+	for(i = 0; i < threads; i++)
+		pool.push_back(std::thread(worker, &options, &next_drive, &results[0]));
+	for(i = 0; i < threads; i++)
+		pool[i].join();
+	double wall_seconds = wall_time() - start;
+
+	double drive_seconds = 0.0;
+	printf("drive,overprovisioning,requests,failed,host_pages,flash_pages,wa,erases,max_block_erases,read_p99,write_p99,finish_time,cpu_seconds\n");
+	for(i = 0; i < options.drives; i++)
+	{
+		const struct drive_result &result = results[i];
+		printf("%u,%.2lf,%lu,%lu,%lu,%lu,%.3lf,%lu,%lu,%.9lf,%.9lf,%.9lf,%.3lf\n", i, result.overprovisioning, result.requests, result.failed,
+			result.host_pages, result.flash_pages, result.write_amplification, result.erases, result.max_block_erases,
+			result.read_p99, result.write_p99, result.finish_time, result.cpu_seconds);
+		drive_seconds += result.cpu_seconds;
+	}
+	printf("threads: %u wall: %.3lf s processor: %.3lf s speedup: %.2lf\n", threads, wall_seconds, drive_seconds, (wall_seconds > 0.0) ? drive_seconds / wall_seconds : 0.0);
+	return 0;
+}
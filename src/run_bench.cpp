@@ -0,0 +1,493 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_bench.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Benchmarks
+ *
+ * Times the simulator itself, not the simulated device.  Every benchmark runs
+ * once for each configuration file given on the command line, in a child
+ * process of its own so the configuration, the FTL tables and the peak
+ * resident set size start fresh.
+ *
+ * Microbenchmarks time single calls:
+ * 	translate_empty: Ftl::translate of the first write of each logical page
+ * 	translate_log_hit: Ftl::translate of an overwrite whose log block has room
+ * 	translate_clean: Ftl::translate of an overwrite whose log block is full,
+ * 		which cleans the block
+ * 	channel_lock_N: Channel::lock with a scheduling table of N entries
+ * 	shuffle_data_log: Garbage_collector::shuffle_data_log after random
+ * 		overwrites
+ * 	get_max_num_erases: Ssd::get_max_num_erases
+ * The translate benchmarks issue the translated events untimed, so the flash
+ * matches the FTL.
+ *
+ * End-to-end benchmarks time whole Ssd::event_arrive calls:
+ * 	seq_fill: write every logical page once in order
+ * 	random_overwrite: uniform random writes, then an untimed read of every
+ * 		logical page, so a full device cleaning in steady state counts
+ * 		its failed writes and lost pages as failures
+ * 	zipf_hot_cold: Zipfian (theta 0.99) writes
+ * 	read_mostly: 90% reads and 10% writes
+ * 	shared_random_overwrite: random_overwrite in the shared log mode
+ * 		(FTL_MODE 2), whatever mode the configuration selects
+ * All but translate_empty and seq_fill first write every logical page and
+ * then stay within the full device.
+ *
+ * Output is one comma-separated line per benchmark after a header line:
+ * 	config,benchmark,ops,ns_per_op,allocs_per_op,peak_rss_kb,failures
+ * Allocations are counted through operator new; the few arrays the hardware
+ * classes malloc are not counted.
+ *
+ * usage: bench [-b benchmark] config...
+ * 	-b runs only the benchmarks whose name starts with benchmark
+ * An empty configuration such as /dev/null runs the default geometry.
+ */
+
+#include <new>
+#include <algorithm>
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <vector>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* operations of the microbenchmarks that do not depend on the device size */
+#define BENCH_CHANNEL_OPS 200000
+#define BENCH_SHUFFLE_OPS 2000
+#define BENCH_ERASES_OPS 1000000
+
+/* rounds of translate_clean over all logical blocks */
+#define BENCH_CLEAN_ROUNDS 4
+
+static unsigned long allocations = 0;
+
+void *operator new(size_t size)
+{
+	allocations++;
+	void *memory = malloc(size ? size : 1);
+	if(memory == NULL)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *memory) throw()
+{
+	free(memory);
+}
+
+void operator delete[](void *memory) throw()
+{
+	free(memory);
+}
+
+/* what a benchmark measured, only the timed region counts */
+struct bench_result
+{
+	unsigned long ops;
+	double seconds;
+	unsigned long allocations;
+	unsigned long failures;
+};
+
+/* a benchmark on a new SSD and its simulated clock */
+struct bench_state
+{
+	Ssd *ssd;
+	double time;
+	unsigned long pages;
+	unsigned long span;
+	uint64_t random;
+	struct bench_result result;
+	double started;
+	unsigned long started_allocations;
+};
+
+static double wall_time(void)
+{
+	struct timespec now;
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void timer_start(struct bench_state &state)
+{
+	state.started_allocations = allocations;
+	state.started = wall_time();
+	return;
+}
+
+static void timer_stop(struct bench_state &state, unsigned long ops)
+{
+	state.result.seconds += wall_time() - state.started;
+	state.result.allocations += allocations - state.started_allocations;
+	state.result.ops += ops;
+	return;
+}
+
+/* xorshift, so the workloads are the same on every run and machine */
+static unsigned long next_random(struct bench_state &state, unsigned long range)
+{
+	state.random ^= state.random << 13;
+	state.random ^= state.random >> 7;
+	state.random ^= state.random << 17;
+	return state.random % range;
+}
+
+/* write a page through the FTL, timing only Ftl::translate if timed */
+static enum status ftl_write(struct bench_state &state, unsigned long logical_address, bool timed)
+{
+	Controller &controller = state.ssd -> get_controller();
+	Event *event = controller.new_event(WRITE, logical_address, 1, state.time);
+	if(timed)
+		timer_start(state);
+	enum status status = controller.get_ftl().translate(*event);
+	if(timed)
+		timer_stop(state, 1);
+	if(status == SUCCESS)
+		status = controller.issue(*event);
+	if(status == SUCCESS)
+		state.time = event -> get_finish_time();
+	else
+		state.result.failures++;
+	controller.free_events(*event);
+	return status;
+}
+
+/* a host request through Ssd::event_arrive */
+static void host_request(struct bench_state &state, enum event_type type, unsigned long logical_address)
+{
+	int status;
+	Address address;
+	state.time += state.ssd -> event_arrive(type, logical_address, 1, state.time, &status, address);
+	if(status != SUCCESS)
+		state.result.failures++;
+	return;
+}
+
+static void fill(struct bench_state &state, unsigned long pages)
+{
+	unsigned long i;
+	for(i = 0; i < pages; i++)
+		host_request(state, WRITE, i);
+	return;
+}
+
+/* write the working set untimed before the benchmark */
+static void prefill(struct bench_state &state)
+{
+	fill(state, state.span);
+	state.result.failures = 0;
+	return;
+}
+
+static void bench_translate_empty(struct bench_state &state)
+{
+	unsigned long i;
+	for(i = 0; i < state.pages; i++)
+		(void) ftl_write(state, i, true);
+	return;
+}
+
+static void bench_translate_log_hit(struct bench_state &state)
+{
+	unsigned long i;
+	prefill(state);
+	for(i = 0; i < state.span; i++)
+		(void) ftl_write(state, i, i % BLOCK_SIZE != 0);
+	return;
+}
+
+static void bench_translate_clean(struct bench_state &state)
+{
+	unsigned long i;
+	unsigned int round;
+	prefill(state);
+	for(round = 0; round < BENCH_CLEAN_ROUNDS; round++)
+		for(i = 0; i < state.span; i++)
+		{
+			(void) ftl_write(state, i, false);
+			if(i % BLOCK_SIZE == BLOCK_SIZE - 1)
+				(void) ftl_write(state, i - (BLOCK_SIZE - 1), true);
+		}
+	return;
+}
+
+static void bench_channel_lock(struct bench_state &state, unsigned int table_size)
+{
+	Channel channel(BUS_CTRL_DELAY, BUS_DATA_DELAY, table_size, BUS_MAX_CONNECT);
+	double duration = BUS_CTRL_DELAY + BUS_DATA_DELAY;
+	unsigned long i;
+
+	/* requests arrive faster than the channel serves them, with jitter so
+	 * 	they fill gaps between earlier reservations */
+	timer_start(state);
+	for(i = 0; i < BENCH_CHANNEL_OPS; i++)
+	{
+		double start = i * duration * 0.75 + next_random(state, table_size) * duration * 0.5;
+		Event event(READ, 0, 1, start);
+		if(channel.lock(start, duration, event) != SUCCESS)
+			state.result.failures++;
+	}
+	timer_stop(state, BENCH_CHANNEL_OPS);
+	return;
+}
+
+static void bench_channel_lock_8(struct bench_state &state)
+{
+	bench_channel_lock(state, 8);
+}
+
+static void bench_channel_lock_64(struct bench_state &state)
+{
+	bench_channel_lock(state, 64);
+}
+
+static void bench_channel_lock_512(struct bench_state &state)
+{
+	bench_channel_lock(state, 512);
+}
+
+static void bench_channel_lock_4096(struct bench_state &state)
+{
+	bench_channel_lock(state, 4096);
+}
+
+static void bench_shuffle_data_log(struct bench_state &state)
+{
+	Garbage_collector &garbage = state.ssd -> get_controller().get_ftl().garbage;
+	unsigned long i;
+	unsigned int j;
+	prefill(state);
+	for(i = 0; i < BENCH_SHUFFLE_OPS; i++)
+	{
+		for(j = 0; j < BLOCK_SIZE; j++)
+			(void) ftl_write(state, next_random(state, state.span), false);
+		timer_start(state);
+		(void) garbage.shuffle_data_log();
+		timer_stop(state, 1);
+	}
+	return;
+}
+
+static void bench_get_max_num_erases(struct bench_state &state)
+{
+	unsigned long i;
+	unsigned long sum = 0;
+	prefill(state);
+	timer_start(state);
+	for(i = 0; i < BENCH_ERASES_OPS; i++)
+		sum += state.ssd -> get_max_num_erases();
+	timer_stop(state, BENCH_ERASES_OPS);
+	/* keep the calls from being optimized away */
+	if(sum == 1)
+		state.result.failures++;
+	return;
+}
+
+static void bench_seq_fill(struct bench_state &state)
+{
+	timer_start(state);
+	fill(state, state.pages);
+	timer_stop(state, state.pages);
+	return;
+}
+
+static void bench_random_overwrite(struct bench_state &state)
+{
+	unsigned long i;
+	unsigned long ops = state.pages * 4;
+	prefill(state);
+	timer_start(state);
+	for(i = 0; i < ops; i++)
+		host_request(state, WRITE, next_random(state, state.span));
+	timer_stop(state, ops);
+	for(i = 0; i < state.span; i++)
+		host_request(state, READ, i);
+	return;
+}
+
+static void bench_zipf_hot_cold(struct bench_state &state)
+{
+	unsigned long span = state.span;
+	unsigned long ops = state.pages * 4;
+	std::vector<double> cdf(span);
+	double total = 0.0;
+	unsigned long i;
+
+	/* rank r is chosen with probability proportional to 1 / r^0.99 and
+	 * 	scattered over the span so hot pages share blocks with cold ones */
+	for(i = 0; i < span; i++)
+	{
+		total += 1.0 / pow(i + 1, 0.99);
+		cdf[i] = total;
+	}
+	prefill(state);
+	timer_start(state);
+	for(i = 0; i < ops; i++)
+	{
+		double pick = (next_random(state, 1UL << 30) / (double) (1UL << 30)) * total;
+		unsigned long rank = std::lower_bound(cdf.begin(), cdf.end(), pick) - cdf.begin();
+		if(rank >= span)
+			rank = span - 1;
+		host_request(state, WRITE, (rank * 2654435761UL) % span);
+	}
+	timer_stop(state, ops);
+	return;
+}
+
+static void bench_read_mostly(struct bench_state &state)
+{
+	unsigned long i;
+	unsigned long ops = state.pages * 4;
+	prefill(state);
+	timer_start(state);
+	for(i = 0; i < ops; i++)
+		host_request(state, (next_random(state, 10) == 0) ? WRITE : READ, next_random(state, state.span));
+	timer_stop(state, ops);
+	return;
+}
+
+/* a benchmark and the config entry it sets over the configuration file
+ * 	before the SSD is built, none if entry is NULL */
+struct bench_case
+{
+	const char *name;
+	void (*run)(struct bench_state &state);
+	const char *entry;
+	double value;
+};
+
+static const struct bench_case cases[] = {
+	{"translate_empty", bench_translate_empty, NULL, 0},
+	{"translate_log_hit", bench_translate_log_hit, NULL, 0},
+	{"translate_clean", bench_translate_clean, NULL, 0},
+	{"channel_lock_8", bench_channel_lock_8, NULL, 0},
+	{"channel_lock_64", bench_channel_lock_64, NULL, 0},
+	{"channel_lock_512", bench_channel_lock_512, NULL, 0},
+	{"channel_lock_4096", bench_channel_lock_4096, NULL, 0},
+	{"shuffle_data_log", bench_shuffle_data_log, NULL, 0},
+	{"get_max_num_erases", bench_get_max_num_erases, NULL, 0},
+	{"seq_fill", bench_seq_fill, NULL, 0},
+	{"random_overwrite", bench_random_overwrite, NULL, 0},
+	{"zipf_hot_cold", bench_zipf_hot_cold, NULL, 0},
+	{"read_mostly", bench_read_mostly, NULL, 0},
+	{"shared_random_overwrite", bench_random_overwrite, "FTL_MODE", SHARED_LOGS}
+};
+
+/* run in the child process: load the configuration, run one benchmark on a
+ * 	new SSD and print its line */
+static void run_case(const char *config_name, const struct bench_case &bench)
+{
+	struct bench_state state;
+	struct rusage usage;
+
+	load_config(config_name);
+	if(bench.entry != NULL)
+	{
+		char entry[128];
+		strncpy(entry, bench.entry, sizeof(entry) - 1);
+		entry[sizeof(entry) - 1] = '\0';
+		load_entry(entry, bench.value, 0);
+	}
+	FILE *log_file = fopen("/dev/null", "w");
+	if(log_file == NULL)
+		exit(FILE_ERR);
+	memset(&state, 0, sizeof(state));
+	state.random = 88172645463325252ULL;
+
+	/* the logical pages the FTL keeps after overprovisioning */
+	Geometry geometry;
+	state.pages = geometry.get_usable_pages();
+	state.span = state.pages;
+	state.ssd = new Ssd(log_file, geometry);
+
+	bench.run(state);
+
+	(void) getrusage(RUSAGE_SELF, &usage);
+	printf("%s,%s,%lu,%.1lf,%.3lf,%ld,%lu\n", config_name, bench.name, state.result.ops,
+		(state.result.ops > 0) ? state.result.seconds * 1e9 / state.result.ops : 0.0,
+		(state.result.ops > 0) ? (double) state.result.allocations / state.result.ops : 0.0,
+		usage.ru_maxrss, state.result.failures);
+	delete state.ssd;
+	fclose(log_file);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	const char *filter = NULL;
+	int option;
+	int i;
+	unsigned int j;
+	int failed = 0;
+
+	while((option = getopt(argc, argv, "b:")) != -1)
+	{
+		if(option == 'b')
+			filter = optarg;
+		else
+			optind = argc + 1;
+	}
+	if(optind >= argc)
+	{
+		fprintf(stderr, "usage: %s [-b benchmark] config...\n", argv[0]);
+		exit(FILE_ERR);
+	}
+
+	printf("config,benchmark,ops,ns_per_op,allocs_per_op,peak_rss_kb,failures\n");
+	for(i = optind; i < argc; i++)
+		for(j = 0; j < sizeof(cases) / sizeof(cases[0]); j++)
+		{
+			if(filter != NULL && strncmp(cases[j].name, filter, strlen(filter)) != 0)
+				continue;
+			fflush(stdout);
+			pid_t child = fork();
+			if(child < 0)
+			{
+				fprintf(stderr, "Benchmark %s could not be started.  Exiting.\n", cases[j].name);
+				exit(MEM_ERR);
+			}
+			if(child == 0)
+			{
+				run_case(argv[i], cases[j]);
+				fflush(stdout);
+				exit(0);
+			}
+			int status;
+			if(waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			{
+				fprintf(stderr, "Benchmark %s failed with configuration %s\n", cases[j].name, argv[i]);
+				failed = 1;
+			}
+		}
+	return failed;
+}
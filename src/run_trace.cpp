@@ -0,0 +1,534 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* run_trace.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Trace replayer
+ *
+ * Replays a block trace against the simulated SSD and reports the simulator
+ * throughput in requests per second next to the simulated device metrics.
+ *
+ * Accepted trace formats, detected from the first line:
+ * 	MSR Cambridge / SNIA IOTTA csv:
+ * 		Timestamp,Hostname,DiskNumber,Type,Offset,Size,ResponseTime
+ * 		with the timestamp in 100ns ticks, offset and size in bytes
+ * 	SPC (UMass) csv:
+ * 		ASU,LBA,Size,Opcode,Timestamp
+ * 		with the LBA in 512 byte sectors, the size in bytes and the timestamp
+ * 		in seconds
+ * 	blkparse text output:
+ * 		dev cpu sequence time pid action rwbs sector + sectors
+ * 		only requests issued to the driver (action D) are replayed; discards
+ * 		are replayed as trims
+ * 	the binary cache written by this program
+ *
+ * A text trace is memory-mapped and converted once to fixed size binary
+ * records cached next to it (trace.fsb), so later runs skip the parsing.  The
+ * cache is rebuilt when the size or modification time of the trace changes.
+ * Records are streamed from the cache in chunks and each chunk is passed to
+ * Ssd::submit_batch as one batch.
+ *
+ * Byte offsets are turned into logical pages of page_size bytes and wrapped
+ * to the logical capacity of the SSD.  Request times are relative to the
+ * first request of the trace, plus the offset given with -o.
+ *
+ * A drive can be preconditioned once and saved with -w, and later runs can
+ * start from it with -r instead of replaying the preconditioning trace.  The
+ * trace of a run that starts from a snapshot should be offset past the
+ * simulated time of the run that wrote it, or its first requests wait for the
+ * flash operations still busy in the snapshot.
+ *
+ * usage: trace [-p page_size] [-n max_requests] [-c cache] [-l log]
+ * 	[-r snapshot] [-w snapshot] [-o offset] config trace
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* requests per batch and per read of the binary cache */
+#define TRACE_CHUNK 65536
+
+#define TRACE_MAGIC "FSBTRC01"
+
+/* binary cache header, the source size and time identify the text trace the
+ * 	records were converted from */
+struct trace_header
+{
+	char magic[8];
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint64_t count;
+};
+
+/* one request of the binary cache */
+struct trace_record
+{
+	double time;
+	uint64_t offset;
+	uint32_t bytes;
+	uint32_t type;
+};
+
+enum trace_format{MSR, SPC, BLKPARSE};
+
+/* replay totals for one request type */
+struct trace_stats
+{
+	unsigned long requests;
+	unsigned long failed;
+	unsigned long pages;
+	double total_time;
+	double max_time;
+};
+
+static double wall_time(void)
+{
+	struct timespec now;
+	(void) clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* field parsing on the mapped trace, which is not null-terminated
+ * each parser advances *cur past what it read */
+static void skip_blanks(const char **cur, const char *end)
+{
+	while(*cur < end && (**cur == ' ' || **cur == '\t'))
+		(*cur)++;
+	return;
+}
+
+static bool parse_ulong(const char **cur, const char *end, uint64_t *value)
+{
+	skip_blanks(cur, end);
+	if(*cur >= end || **cur < '0' || **cur > '9')
+		return false;
+	for(*value = 0; *cur < end && **cur >= '0' && **cur <= '9'; (*cur)++)
+		*value = *value * 10 + (**cur - '0');
+	return true;
+}
+
+static bool parse_double(const char **cur, const char *end, double *value)
+{
+	uint64_t whole;
+	double scale = 0.1;
+	if(!parse_ulong(cur, end, &whole))
+		return false;
+	*value = (double) whole;
+	if(*cur < end && **cur == '.')
+		for((*cur)++; *cur < end && **cur >= '0' && **cur <= '9'; (*cur)++)
+		{
+			*value += (**cur - '0') * scale;
+			scale /= 10;
+		}
+	return true;
+}
+
+/* advance past the next separator */
+static void skip_field(const char **cur, const char *end, char separator)
+{
+	while(*cur < end && **cur != separator && **cur != '\n')
+		(*cur)++;
+	if(*cur < end && **cur == separator)
+		(*cur)++;
+	return;
+}
+
+/* advance past a blank-separated word and return its start */
+static const char *next_word(const char **cur, const char *end)
+{
+	skip_blanks(cur, end);
+	const char *word = *cur;
+	while(*cur < end && **cur != ' ' && **cur != '\t' && **cur != '\n')
+		(*cur)++;
+	return word;
+}
+
+static enum trace_format detect_format(const char *cur, const char *end)
+{
+	unsigned int commas = 0;
+	for(; cur < end && *cur != '\n'; cur++)
+		if(*cur == ',')
+			commas++;
+	if(commas >= 6)
+		return MSR;
+	if(commas >= 4)
+		return SPC;
+	return BLKPARSE;
+}
+
+/* parse one line into record, returns false for lines that are not replayed
+ * 	(headers, comments, blkparse summaries and other actions)
+ * MSR timestamps are kept relative to first_tick, the timestamp of the first
+ * 	request, since absolute ticks do not fit a double to the microsecond */
+static bool parse_line(enum trace_format format, const char *cur, const char *end, struct trace_record &record, uint64_t &first_tick)
+{
+	uint64_t value;
+	const char *word;
+	if(format == MSR)
+	{
+		if(!parse_ulong(&cur, end, &value))
+			return false;
+		if(first_tick == 0)
+			first_tick = value;
+		record.time = (value > first_tick) ? (value - first_tick) / 1e7 : 0.0;
+		skip_field(&cur, end, ',');
+		skip_field(&cur, end, ',');
+		skip_field(&cur, end, ',');
+		skip_blanks(&cur, end);
+		if(cur < end && (*cur == 'W' || *cur == 'w'))
+			record.type = WRITE;
+		else if(cur < end && (*cur == 'R' || *cur == 'r'))
+			record.type = READ;
+		else
+			return false;
+		skip_field(&cur, end, ',');
+		if(!parse_ulong(&cur, end, &record.offset))
+			return false;
+		skip_field(&cur, end, ',');
+		if(!parse_ulong(&cur, end, &value))
+			return false;
+		record.bytes = (uint32_t) value;
+		return true;
+	}
+	if(format == SPC)
+	{
+		skip_field(&cur, end, ',');
+		if(!parse_ulong(&cur, end, &record.offset))
+			return false;
+		record.offset *= 512;
+		skip_field(&cur, end, ',');
+		if(!parse_ulong(&cur, end, &value))
+			return false;
+		record.bytes = (uint32_t) value;
+		skip_field(&cur, end, ',');
+		skip_blanks(&cur, end);
+		if(cur < end && (*cur == 'W' || *cur == 'w'))
+			record.type = WRITE;
+		else if(cur < end && (*cur == 'R' || *cur == 'r'))
+			record.type = READ;
+		else
+			return false;
+		skip_field(&cur, end, ',');
+		return parse_double(&cur, end, &record.time);
+	}
+
+	/* blkparse: skip the device, cpu and sequence, the pid sits between the
+	 * 	time and the action */
+	(void) next_word(&cur, end);
+	(void) next_word(&cur, end);
+	(void) next_word(&cur, end);
+	if(!parse_double(&cur, end, &record.time))
+		return false;
+	(void) next_word(&cur, end);
+	word = next_word(&cur, end);
+	if(cur - word != 1 || *word != 'D')
+		return false;
+	word = next_word(&cur, end);
+	if(memchr(word, 'D', cur - word) != NULL)
+		record.type = TRIM;
+	else if(memchr(word, 'W', cur - word) != NULL)
+		record.type = WRITE;
+	else if(memchr(word, 'R', cur - word) != NULL)
+		record.type = READ;
+	else
+		return false;
+	if(!parse_ulong(&cur, end, &record.offset))
+		return false;
+	record.offset *= 512;
+	word = next_word(&cur, end);
+	if(cur - word != 1 || *word != '+' || !parse_ulong(&cur, end, &value))
+		return false;
+	record.bytes = (uint32_t) (value * 512);
+	return true;
+}
+
+static bool read_header(FILE *file, struct trace_header &header)
+{
+	return fread(&header, sizeof(header), 1, file) == 1 && memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) == 0;
+}
+
+/* open the binary records of trace_name, converting it first if the cache is
+ * 	missing or stale
+ * returns the cache positioned at the first record */
+static FILE *open_records(const char *trace_name, const std::string &cache_name, unsigned long *count)
+{
+	struct stat source;
+	struct trace_header header;
+	FILE *file;
+
+	if(stat(trace_name, &source) != 0)
+	{
+		fprintf(stderr, "Trace file %s not found.  Exiting.\n", trace_name);
+		exit(FILE_ERR);
+	}
+
+	/* the trace itself may already be a binary cache */
+	if((file = fopen(trace_name, "rb")) != NULL)
+	{
+		if(read_header(file, header))
+		{
+			*count = header.count;
+			return file;
+		}
+		fclose(file);
+	}
+	if((file = fopen(cache_name.c_str(), "rb")) != NULL)
+	{
+		if(read_header(file, header) && header.source_size == (uint64_t) source.st_size && header.source_mtime == (int64_t) source.st_mtime)
+		{
+			*count = header.count;
+			return file;
+		}
+		fclose(file);
+	}
+
+	int fd = open(trace_name, O_RDONLY);
+	if(fd < 0)
+	{
+		fprintf(stderr, "Trace file %s could not be opened: %s.  Exiting.\n", trace_name, strerror(errno));
+		exit(FILE_ERR);
+	}
+	const char *data = NULL;
+	if(source.st_size > 0)
+	{
+		data = (const char *) mmap(NULL, source.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data == MAP_FAILED)
+		{
+			fprintf(stderr, "Trace file %s could not be mapped: %s.  Exiting.\n", trace_name, strerror(errno));
+			exit(FILE_ERR);
+		}
+		(void) madvise((void *) data, source.st_size, MADV_SEQUENTIAL);
+	}
+
+	/* write to a temporary file and rename it so a cache is always complete */
+	std::string temp_name = cache_name + ".tmp";
+	FILE *cache = fopen(temp_name.c_str(), "w+b");
+	if(cache == NULL)
+	{
+		fprintf(stderr, "Trace cache %s could not be created: %s.  Exiting.\n", temp_name.c_str(), strerror(errno));
+		exit(FILE_ERR);
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.source_size = source.st_size;
+	header.source_mtime = source.st_mtime;
+	(void) fwrite(&header, sizeof(header), 1, cache);
+
+	struct trace_record *records = new struct trace_record[TRACE_CHUNK];
+	unsigned int buffered = 0;
+	const char *end = data + source.st_size;
+	const char *line = data;
+	enum trace_format format = detect_format(data, end);
+	uint64_t first_tick = 0;
+	while(line < end)
+	{
+		const char *next = (const char *) memchr(line, '\n', end - line);
+		next = (next == NULL) ? end : next + 1;
+		struct trace_record &record = records[buffered];
+		memset(&record, 0, sizeof(record));
+		if(parse_line(format, line, next, record, first_tick) && record.bytes > 0 && ++buffered == TRACE_CHUNK)
+		{
+			(void) fwrite(records, sizeof(*records), buffered, cache);
+			header.count += buffered;
+			buffered = 0;
+		}
+		line = next;
+	}
+	(void) fwrite(records, sizeof(*records), buffered, cache);
+	header.count += buffered;
+	delete[] records;
+	if(data != NULL)
+		(void) munmap((void *) data, source.st_size);
+	close(fd);
+
+	rewind(cache);
+	if(fwrite(&header, sizeof(header), 1, cache) != 1 || fflush(cache) != 0 || rename(temp_name.c_str(), cache_name.c_str()) != 0)
+	{
+		fprintf(stderr, "Trace cache %s could not be written: %s.  Exiting.\n", cache_name.c_str(), strerror(errno));
+		exit(FILE_ERR);
+	}
+	if(fseek(cache, sizeof(header), SEEK_SET) != 0)
+		exit(FILE_ERR);
+	*count = header.count;
+	return cache;
+}
+
+static void print_stats(const char *name, const struct trace_stats &stats)
+{
+	if(stats.requests == 0)
+		return;
+	printf("%-6s requests: %lu failed: %lu pages: %lu mean time: %.9lf max time: %.9lf\n", name, stats.requests, stats.failed, stats.pages, stats.total_time / stats.requests, stats.max_time);
+	return;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long page_size = 4096;
+	unsigned long max_requests = 0;
+	const char *cache_option = NULL;
+	const char *log_name = "/dev/null";
+	const char *restore_name = NULL;
+	const char *save_name = NULL;
+	double time_offset = 0.0;
+	int option;
+
+	while((option = getopt(argc, argv, "p:n:c:l:r:w:o:")) != -1)
+	{
+		if(option == 'p')
+			page_size = strtoul(optarg, NULL, 10);
+		else if(option == 'n')
+			max_requests = strtoul(optarg, NULL, 10);
+		else if(option == 'c')
+			cache_option = optarg;
+		else if(option == 'l')
+			log_name = optarg;
+		else if(option == 'r')
+			restore_name = optarg;
+		else if(option == 'w')
+			save_name = optarg;
+		else if(option == 'o')
+			time_offset = strtod(optarg, NULL);
+		else
+			optind = argc + 1;
+	}
+	if(optind + 2 != argc || page_size == 0 || time_offset < 0.0)
+	{
+		fprintf(stderr, "usage: %s [-p page_size] [-n max_requests] [-c cache] [-l log] [-r snapshot] [-w snapshot] [-o offset] config trace\n", argv[0]);
+		exit(FILE_ERR);
+	}
+	const char *trace_name = argv[optind + 1];
+	std::string cache_name = (cache_option != NULL) ? cache_option : std::string(trace_name) + ".fsb";
+
+	load_config(argv[optind]);
+	FILE *log_file = fopen(log_name, "w");
+	if(log_file == NULL)
+	{
+		fprintf(stderr, "Log file %s could not be opened.  Exiting.\n", log_name);
+		exit(FILE_ERR);
+	}
+
+	double convert_start = wall_time();
+	unsigned long count;
+	FILE *cache = open_records(trace_name, cache_name, &count);
+	double convert_time = wall_time() - convert_start;
+	if(max_requests != 0 && max_requests < count)
+		count = max_requests;
+
+	/* the logical pages the FTL keeps after overprovisioning */
+	Geometry geometry;
+	unsigned long capacity = geometry.get_usable_pages();
+	if(capacity == 0)
+	{
+		fprintf(stderr, "The SSD has no logical pages.  Exiting.\n");
+		exit(FILE_ERR);
+	}
+
+	Ssd *ssd = new Ssd(log_file, geometry);
+	if(restore_name != NULL && ssd -> load_snapshot(restore_name) != SUCCESS)
+	{
+		fprintf(stderr, "Snapshot %s could not be loaded.  Exiting.\n", restore_name);
+		exit(FILE_ERR);
+	}
+	struct trace_record *records = new struct trace_record[TRACE_CHUNK];
+	struct request *requests = new struct request[TRACE_CHUNK];
+	struct completion *completions = new struct completion[TRACE_CHUNK];
+	struct trace_stats stats[TRIM + 1];
+	memset(stats, 0, sizeof(stats));
+	double first_time = -1.0;
+	double last_finish = time_offset;
+	unsigned long replayed = 0;
+
+	double replay_start = wall_time();
+	while(replayed < count)
+	{
+		size_t n = fread(records, sizeof(*records), (count - replayed < TRACE_CHUNK) ? count - replayed : TRACE_CHUNK, cache);
+		if(n == 0)
+		{
+			fprintf(stderr, "Trace cache %s ends after %lu of %lu requests.\n", cache_name.c_str(), replayed, count);
+			break;
+		}
+		size_t i;
+		for(i = 0; i < n; i++)
+		{
+			const struct trace_record &record = records[i];
+			unsigned long first = record.offset / page_size;
+			unsigned long pages = (record.offset + record.bytes - 1) / page_size - first + 1;
+			if(first_time < 0.0)
+				first_time = record.time;
+			if(pages > capacity)
+				pages = capacity;
+			first %= capacity;
+			if(first + pages > capacity)
+				first = capacity - pages;
+			requests[i].type = (enum event_type) record.type;
+			requests[i].logical_address = first;
+			requests[i].size = pages;
+			requests[i].start_time = (record.time > first_time) ? record.time - first_time + time_offset : time_offset;
+			requests[i].pages = NULL;
+		}
+		ssd -> submit_batch(requests, n, completions);
+		for(i = 0; i < n; i++)
+		{
+			struct trace_stats &type_stats = stats[requests[i].type];
+			type_stats.requests++;
+			type_stats.pages += requests[i].size;
+			if(completions[i].status != SUCCESS)
+				type_stats.failed++;
+			type_stats.total_time += completions[i].time_taken;
+			if(completions[i].time_taken > type_stats.max_time)
+				type_stats.max_time = completions[i].time_taken;
+			if(requests[i].start_time + completions[i].time_taken > last_finish)
+				last_finish = requests[i].start_time + completions[i].time_taken;
+		}
+		replayed += n;
+	}
+	double replay_time = wall_time() - replay_start;
+
+	printf("trace: %s requests: %lu page size: %lu logical pages: %lu\n", trace_name, replayed, page_size, capacity);
+	printf("conversion: %.3lf s replay: %.3lf s throughput: %.0lf requests/s\n", convert_time, replay_time, (replay_time > 0.0) ? replayed / replay_time : 0.0);
+	print_stats("read", stats[READ]);
+	print_stats("write", stats[WRITE]);
+	print_stats("trim", stats[TRIM]);
+	printf("simulated time: %.9lf\n", last_finish);
+	ssd -> print_report(stdout);
+	if(save_name != NULL && ssd -> save_snapshot(save_name) != SUCCESS)
+	{
+		fprintf(stderr, "Snapshot %s could not be saved.  Exiting.\n", save_name);
+		exit(FILE_ERR);
+	}
+
+	delete[] completions;
+	delete[] requests;
+	delete[] records;
+	delete ssd;
+	fclose(cache);
+	fclose(log_file);
+	return 0;
+}
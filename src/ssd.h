@@ -36,8 +36,15 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <list>
 #include <map>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 
 #ifndef _SSD_H
@@ -116,6 +123,75 @@ extern const double PAGE_WRITE_DELAY;
 /* Overprovisioning */
 extern const float OVERPROVISIONING;
 
+/* Consistency checker on (1) or off (0) */
+extern const unsigned int CONSISTENCY_CHECK;
+
+/* Ssd class:
+ * 	max number of outstanding requests accepted by Ssd::submit */
+extern const unsigned int QUEUE_DEPTH;
+
+/* Background garbage collection on (1) or off (0) for Ssd::run
+ * 	free log blocks below which it runs between requests
+ * 	free log blocks it restores while the device is idle */
+extern const unsigned int BACKGROUND_GC;
+extern const unsigned int GC_LOW_WATERMARK;
+extern const unsigned int GC_HIGH_WATERMARK;
+
+/* FTL mapping scheme, see enum ftl_mode
+ * 	page mapping entries cached in RAM, 0 to keep the whole page map in RAM
+ * 	page mapping entries in each translation page on flash */
+extern const unsigned int FTL_MODE;
+extern const unsigned int MAP_CACHE_SIZE;
+extern const unsigned int MAP_ENTRIES_PER_PAGE;
+
+/* Write-back buffer in RAM for the Controller:
+ * 	logical pages it holds, 0 to pass every request to the FTL
+ * 	eviction policy, see enum buffer_policy
+ * 	least recently used pages searched for a clean victim by CFLRU */
+extern const unsigned int WRITE_BUFFER_SIZE;
+extern const unsigned int WRITE_BUFFER_POLICY;
+extern const unsigned int WRITE_BUFFER_WINDOW;
+
+/* Hot/cold separation of logical blocks in block mapping mode:
+ * 	host page writes after which the update count of a logical block is
+ * 		halved, 0 to place blocks regardless of their update frequency
+ * 	decayed update count from which a logical block is hot */
+extern const unsigned int HEAT_HALF_LIFE;
+extern const unsigned int HOT_THRESHOLD;
+
+/* Parallelism:
+ * 	1 to stripe the FTL's physical blocks across packages, dies and planes
+ * 		and place log blocks on another die than their data block, 0 to
+ * 		number them package by package
+ * 	1 to run reads or programs on sibling planes of a die as one multi-plane
+ * 		operation, 0 to run one operation at a time on each die
+ * 	worker threads that run independent flash operations package by
+ * 		package, see Dispatcher, 0 to run them on the caller's thread */
+extern const unsigned int BLOCK_STRIPING;
+extern const unsigned int MULTI_PLANE;
+extern const unsigned int PACKAGE_THREADS;
+
+/* Instrumentation:
+ * 	FTL log file detail, see FTL_LOG
+ * 	flash operations kept in the trace ring of the Ssd, 0 to keep none
+ * 	length of the report's latency percentile windows, 0 for one window */
+extern const unsigned int LOG_LEVEL;
+extern const unsigned int TRACE_RING_SIZE;
+extern const double REPORT_WINDOW;
+
+/* FTL log levels
+ * 	0 - nothing, the default
+ * 	1 - garbage collection steps and failures
+ * 	2 - every request the FTL translates
+ * 	3 - also the FTL tables after every request (Ftl::print_info)
+ * Statements above MAX_LOG_LEVEL are compiled out, so building with
+ * 	-DMAX_LOG_LEVEL=0 leaves no tracing at all in the request path. */
+#ifndef MAX_LOG_LEVEL
+#define MAX_LOG_LEVEL 3
+#endif
+#define LOG_ENABLED(level) ((level) <= MAX_LOG_LEVEL && (level) <= LOG_LEVEL)
+#define FTL_LOG(level, ...) do { if(LOG_ENABLED(level)) fprintf(__VA_ARGS__); } while(0)
+
 /* Log file path */
 extern const char LOG_FILE[255];
 
@@ -140,8 +216,10 @@ enum block_state{FREE, ACTIVE, INACTIVE};
  * 	erase - erase block at address (all pages in block are erased - 
  * 	                                page states set to empty)
  * 	merge - move valid pages from block at address (page state set to invalid)
- * 	           to free pages in block at merge_address */
-enum event_type{READ, WRITE, ERASE, MERGE};
+ * 	           to free pages in block at merge_address
+ * 	trim  - tell the FTL the data of the logical pages is no longer needed,
+ * 	        so it is dropped instead of copied by garbage collection */
+enum event_type{READ, WRITE, ERASE, MERGE, TRIM};
 
 /* General return status
  * return status for simulator operations that only need to provide general
@@ -161,6 +239,27 @@ enum address_valid{NONE, PACKAGE, DIE, PLANE, BLOCK, PAGE};
  * GREEDY: greedy by min effort.
  * COST_BENEFIT: LFS cost-benefit. */
 enum GC_POLICY{FIFO, LRU, GREEDY, COST_BENEFIT};
+
+/* FTL mapping schemes
+ * BLOCK_MAPPED: logical blocks on data blocks, each with at most one log block.
+ * PAGE_MAPPED: logical pages anywhere, with a demand-paged mapping table.
+ * SHARED_LOGS: logical blocks on data blocks, with one sequential log block and
+ *              a pool of random log blocks shared by all data blocks (FAST). */
+enum ftl_mode{BLOCK_MAPPED, PAGE_MAPPED, SHARED_LOGS};
+
+/* Write buffer eviction policies
+ * BUFFER_LRU: least recently used page.
+ * BUFFER_CFLRU: clean-first LRU, the least recently used clean page among the
+ *               WRITE_BUFFER_WINDOW least recently used pages, else LRU. */
+enum buffer_policy{BUFFER_LRU, BUFFER_CFLRU};
+
+/* Update frequency of a logical block for placement, see HEAT_HALF_LIFE
+ * TEMP_UNKNOWN: hot/cold separation is off.
+ * TEMP_HOT: updated often, placed on the least worn blocks, or on the hot
+ *           frontier block in page mapping mode.
+ * TEMP_COLD: rarely updated, placed on the most worn blocks still usable, or
+ *            on the cold frontier block with the collection copies. */
+enum temperature{TEMP_UNKNOWN, TEMP_HOT, TEMP_COLD};
 /* Selected garbage collection policy */
 extern enum GC_POLICY SELECTED_GC_POLICY;
 
@@ -173,9 +272,13 @@ extern enum GC_POLICY SELECTED_GC_POLICY;
  * constructors that accept args
  * (e.g. a Ssd contains a Controller, Ram, Bus, and Packages). */
 class Address;
+class Geometry;
 class Event;
+class Event_pool;
 class Channel;
 class Bus;
+class Snapshot;
+class Flash_store;
 class Page;
 class Block;
 class Plane;
@@ -184,7 +287,9 @@ class Package;
 class Garbage_Collector;
 class Wear_Leveler;
 class Ftl;
+struct ftl_state;
 class Ram;
+class Dispatcher;
 class Controller;
 class Ssd;
 
@@ -214,6 +319,158 @@ public:
   bool operator!=(const Address &rhs);
 };
 
+/* The geometry of one SSD: the number of packages, of dies per package, of
+ * planes per die, of blocks per plane and of pages per block, and the sizes
+ * the FTL derives from them, computed once.  Every size that is a power of 2
+ * gets a shift and a mask so splitting a physical page number into an
+ * address takes no divisions.  Each Ssd keeps its own geometry, so
+ * differently sized SSDs can share a process.
+ * The split and join functions are defined in this header so the FTL and the
+ * flash store inline them.  Builds with FIXED_GEOMETRY take the sizes from
+ * Fixed_geometry instead, see below. */
+class Geometry
+{
+public:
+	Geometry(unsigned int ssd_size = SSD_SIZE, unsigned int package_size = PACKAGE_SIZE, unsigned int die_size = DIE_SIZE, unsigned int plane_size = PLANE_SIZE, unsigned int block_size = BLOCK_SIZE, double overprovisioning = OVERPROVISIONING);
+	unsigned int get_ssd_size(void) const { return sizes[PACKAGE]; }
+	unsigned int get_package_size(void) const { return sizes[DIE]; }
+	unsigned int get_die_size(void) const { return sizes[PLANE]; }
+	unsigned int get_plane_size(void) const { return sizes[BLOCK]; }
+	unsigned int get_block_size(void) const { return sizes[PAGE]; }
+	unsigned long get_package_blocks(void) const { return package_blocks; }
+	unsigned long get_die_blocks(void) const { return die_blocks; }
+	unsigned long get_raw_pages(void) const { return raw_pages; }
+	unsigned long get_physical_blocks(void) const { return physical_blocks; }
+	unsigned long get_op_pages(void) const { return op_pages; }
+	unsigned long get_op_blocks(void) const { return op_blocks; }
+	unsigned long get_usable_pages(void) const { return usable_pages; }
+	unsigned int get_logical_blocks(void) const { return logical_blocks; }
+	inline void split(unsigned long physical_page, unsigned int *package, unsigned int *die, unsigned int *plane, unsigned int *block, unsigned int *page) const;
+	inline void split_striped(unsigned long physical_page, unsigned int *package, unsigned int *die, unsigned int *plane, unsigned int *block, unsigned int *page) const;
+	inline unsigned long get_block_index(const Address &address) const;
+	inline unsigned long get_plane_index(const Address &address) const;
+private:
+	inline unsigned long divide(unsigned long value, enum address_valid level) const;
+	inline unsigned int remainder(unsigned long value, enum address_valid level) const;
+	/* sizes[level] units make up each unit of the level above, e.g.
+	 * 	sizes[PAGE] is the pages per block; shifts[level] is log2 of the
+	 * 	size, or -1 if it is not a power of 2 */
+	unsigned int sizes[PAGE + 1];
+	int shifts[PAGE + 1];
+	unsigned long package_blocks;
+	unsigned long die_blocks;
+	unsigned long raw_pages;
+	unsigned long physical_blocks;
+	unsigned long op_pages;
+	unsigned long op_blocks;
+	unsigned long usable_pages;
+	unsigned int logical_blocks;
+};
+
+#ifdef FIXED_GEOMETRY
+#if !defined(FIXED_SSD_SIZE) || !defined(FIXED_PACKAGE_SIZE) || !defined(FIXED_DIE_SIZE) || !defined(FIXED_PLANE_SIZE) || !defined(FIXED_BLOCK_SIZE)
+#error "FIXED_GEOMETRY needs FIXED_SSD_SIZE, FIXED_PACKAGE_SIZE, FIXED_DIE_SIZE, FIXED_PLANE_SIZE and FIXED_BLOCK_SIZE"
+#endif
+/* Geometry fixed at compile time for builds that only simulate one drive:
+ * 	make CFLAGS="... -DFIXED_GEOMETRY -DFIXED_SSD_SIZE=4 -DFIXED_PACKAGE_SIZE=8
+ * 		-DFIXED_DIE_SIZE=2 -DFIXED_PLANE_SIZE=64 -DFIXED_BLOCK_SIZE=64"
+ * All splits and joins are constant expressions over the template
+ * 	arguments, so the compiler folds them into shifts and masks even where
+ * 	a runtime Geometry would have to divide.  Geometry checks that the config
+ * 	file matches the build. */
+template <unsigned int ssd_size, unsigned int package_size, unsigned int die_size, unsigned int plane_size, unsigned int block_size>
+struct Fixed_geometry
+{
+	static constexpr unsigned long block_of(unsigned long physical_page) { return physical_page / block_size; }
+	static constexpr unsigned int page_of(unsigned long physical_page) { return physical_page % block_size; }
+	static constexpr unsigned int package_of(unsigned long nth_block) { return nth_block / plane_size / die_size / package_size % ssd_size; }
+	static constexpr unsigned int die_of(unsigned long nth_block) { return nth_block / plane_size / die_size % package_size; }
+	static constexpr unsigned int plane_of(unsigned long nth_block) { return nth_block / plane_size % die_size; }
+	static constexpr unsigned int block_in_plane(unsigned long nth_block) { return nth_block % plane_size; }
+	static constexpr unsigned int striped_package_of(unsigned long nth_block) { return nth_block % ssd_size; }
+	static constexpr unsigned int striped_die_of(unsigned long nth_block) { return nth_block / ssd_size % package_size; }
+	static constexpr unsigned int striped_plane_of(unsigned long nth_block) { return nth_block / ssd_size / package_size % die_size; }
+	static constexpr unsigned int striped_block_in_plane(unsigned long nth_block) { return nth_block / ssd_size / package_size / die_size % plane_size; }
+	static constexpr unsigned long block_index(unsigned int package, unsigned int die, unsigned int plane, unsigned int block) { return (((unsigned long) package * package_size + die) * die_size + plane) * plane_size + block; }
+};
+typedef Fixed_geometry<FIXED_SSD_SIZE, FIXED_PACKAGE_SIZE, FIXED_DIE_SIZE, FIXED_PLANE_SIZE, FIXED_BLOCK_SIZE> fixed_geometry;
+#endif
+
+/* value / sizes[level] */
+inline unsigned long Geometry::divide(unsigned long value, enum address_valid level) const
+{
+	return (shifts[level] >= 0) ? value >> shifts[level] : value / sizes[level];
+}
+
+/* value % sizes[level] */
+inline unsigned int Geometry::remainder(unsigned long value, enum address_valid level) const
+{
+	return (shifts[level] >= 0) ? value & (sizes[level] - 1) : value % sizes[level];
+}
+
+/* address of a physical page with the blocks numbered package by package */
+inline void Geometry::split(unsigned long physical_page, unsigned int *package, unsigned int *die, unsigned int *plane, unsigned int *block, unsigned int *page) const
+{
+#ifdef FIXED_GEOMETRY
+	unsigned long nth_block = fixed_geometry::block_of(physical_page);
+	*package = fixed_geometry::package_of(nth_block);
+	*die = fixed_geometry::die_of(nth_block);
+	*plane = fixed_geometry::plane_of(nth_block);
+	*block = fixed_geometry::block_in_plane(nth_block);
+	*page = fixed_geometry::page_of(physical_page);
+#else
+	unsigned long rest = divide(physical_page, PAGE);
+	*page = remainder(physical_page, PAGE);
+	*block = remainder(rest, BLOCK);
+	rest = divide(rest, BLOCK);
+	*plane = remainder(rest, PLANE);
+	rest = divide(rest, PLANE);
+	*die = remainder(rest, DIE);
+	*package = remainder(divide(rest, DIE), PACKAGE);
+#endif
+	return;
+}
+
+/* address of a physical page with consecutive blocks going round the
+ * 	packages, then the dies of each package, then the planes of each die */
+inline void Geometry::split_striped(unsigned long physical_page, unsigned int *package, unsigned int *die, unsigned int *plane, unsigned int *block, unsigned int *page) const
+{
+#ifdef FIXED_GEOMETRY
+	unsigned long nth_block = fixed_geometry::block_of(physical_page);
+	*package = fixed_geometry::striped_package_of(nth_block);
+	*die = fixed_geometry::striped_die_of(nth_block);
+	*plane = fixed_geometry::striped_plane_of(nth_block);
+	*block = fixed_geometry::striped_block_in_plane(nth_block);
+	*page = fixed_geometry::page_of(physical_page);
+#else
+	unsigned long rest = divide(physical_page, PAGE);
+	*page = remainder(physical_page, PAGE);
+	*package = remainder(rest, PACKAGE);
+	rest = divide(rest, PACKAGE);
+	*die = remainder(rest, DIE);
+	rest = divide(rest, DIE);
+	*plane = remainder(rest, PLANE);
+	*block = remainder(divide(rest, PLANE), BLOCK);
+#endif
+	return;
+}
+
+/* physical block number of a block address, numbered package by package */
+inline unsigned long Geometry::get_block_index(const Address &address) const
+{
+#ifdef FIXED_GEOMETRY
+	return fixed_geometry::block_index(address.package, address.die, address.plane, address.block);
+#else
+	return ((((unsigned long) address.package * sizes[DIE] + address.die) * sizes[PLANE] + address.plane) * sizes[BLOCK]) + address.block;
+#endif
+}
+
+/* plane number of a plane address, numbered like blocks */
+inline unsigned long Geometry::get_plane_index(const Address &address) const
+{
+	return ((unsigned long) address.package * sizes[DIE] + address.die) * sizes[PLANE] + address.plane;
+}
+
 /* Class to manage I/O requests as events for the SSD.  It was designed to keep
  * track of an I/O request by storing its type, addressing, and timing.  The
  * SSD class creates an instance for each I/O request it receives. */
@@ -230,6 +487,7 @@ public:
 	enum event_type get_event_type(void) const;
 	double get_start_time(void) const;
 	double get_time_taken(void) const;
+	double get_finish_time(void) const;
 	double get_bus_wait_time(void) const;
 	Event *get_next(void) const;
 	void set_address(const Address &address);
@@ -238,6 +496,7 @@ public:
 	double incr_bus_wait_time(double time);
 	double incr_time_taken(double time_incr);
 	void print(FILE *stream = stdout);
+	friend class Event_pool;
 private:
 	double start_time;
 	double time_taken;
@@ -250,6 +509,26 @@ private:
 	Event *next;
 };
 
+/* Number of Events allocated at a time when the Event_pool runs out */
+#define EVENT_POOL_CHUNK 64
+
+/* Free list of Events owned by the Ssd so that requests and their garbage
+ * collection traffic do not allocate once the pool has warmed up.  Events
+ * are carved from chunks of EVENT_POOL_CHUNK and recycled through their next
+ * pointers, so a whole event list is returned with one call. */
+class Event_pool
+{
+public:
+	Event_pool(void);
+	~Event_pool(void);
+	Event *alloc(enum event_type type, unsigned long logical_address, unsigned int size, double start_time);
+	void free(Event &event_list);
+private:
+	void grow(void);
+	Event *free_list;
+	std::vector<Event *> chunks;
+};
+
 /* Quicksort for Channel class
  * Supply base pointer to array to be sorted along with inclusive range of
  * indices to sort.  The move operations for sorting the first array will also
@@ -270,7 +549,10 @@ void quicksort(double *array1, double *array2, long left, long right);
  * can be queued, and the maximum number of devices that can connect to the bus.
  * To elaborate, the table size is the size of the channel scheduling table that
  * holds start and finish times of events that have not yet completed in order
- * to determine where the next event can be scheduled for bus utilization. */
+ * to determine where the next event can be scheduled for bus utilization.
+ * The table is a treap of non-overlapping reservations ordered by time, where
+ * each subtree knows its largest idle gap, so expiring, inserting and finding
+ * the earliest gap that fits an event all take O(log table_size). */
 class Channel
 {
 public:
@@ -279,17 +561,39 @@ public:
 	enum status lock(double start_time, double duration, Event &event);
 	enum status connect(void);
 	enum status disconnect(void);
+	void save(Snapshot &snapshot) const;
+	void load(Snapshot &snapshot);
 private:
 	void unlock(double current_time);
+	double find_gap(double start_time, double duration) const;
+	double reserve(double sched_time, double duration);
+	double gap(int entry) const;
+	void update(int entry);
+	void split(int entry, double time, int &before, int &after);
+	void split_expired(int entry, double time, int &expired, int &active);
+	int join(int before, int after);
+	int first(int entry) const;
+	int last(int entry) const;
+	void set_first_gap(int entry, double prev_unlock);
+	void release(int entry);
 	unsigned int table_size;
 	double * const lock_time;
 	double * const unlock_time;
+	/* finish time of the previous reservation (negative for the first one)
+	 * and the largest idle gap between reservations in each subtree */
+	double * const prev_unlock_time;
+	double * const max_gap_time;
+	int * const left;
+	int * const right;
+	unsigned int * const priority;
+	int root;
+	int free_entry;
 	unsigned int table_entries;
-	unsigned int selected_entry;
 	unsigned int num_connected;
 	unsigned int max_connections;
 	double ctrl_delay;
 	double data_delay;
+	bool full_warned;
 };
 
 /* Multi-channel bus comprised of Channel class objects
@@ -309,42 +613,302 @@ public:
 	enum status connect(unsigned int channel);
 	enum status disconnect(unsigned int channel);
 	Channel &get_channel(unsigned int channel);
+	void save(Snapshot &snapshot) const;
+	void load(Snapshot &snapshot);
 private:
 	unsigned int num_channels;
 	Channel * const channels;
 };
 
+/* A host request for Ssd::submit_batch.  A request covers size logical pages
+ * starting at logical_address, or the size logical pages listed in pages for
+ * a scatter-gather request (pages is NULL for a contiguous request). */
+struct request
+{
+	enum event_type type;
+	unsigned long logical_address;
+	unsigned int size;
+	double start_time;
+	const unsigned long *pages;
+};
+
+/* Completion of a request from Ssd::submit_batch or Ssd::submit.  The time
+ * taken is the finish time of the last page with respect to the request's
+ * start time, so pages serviced in parallel on different channels and dies
+ * overlap.  It includes the queue wait time, the time the request waited for
+ * a free slot when QUEUE_DEPTH requests were already outstanding.  The
+ * status is SUCCESS only if every page of the request succeeded. */
+struct completion
+{
+	enum status status;
+	double time_taken;
+	double bus_wait_time;
+	double queue_wait_time;
+	unsigned int pages_failed;
+};
+
+/* Called by Ssd::run when the simulated time reaches a completion */
+typedef void (*completion_callback)(const struct request &req, const struct completion &done, void *context);
+
+/* A request accepted by Ssd::submit, first waiting to be issued at its start
+ * time and then waiting to complete at time.  seq breaks ties between equal
+ * times in submission order. */
+struct pending_io
+{
+	struct request req;
+	completion_callback callback;
+	void *context;
+	unsigned long seq;
+	double time;
+	struct completion done;
+};
+
+/* Write buffer statistics kept by the Ram.  Hits are requests served by the
+ * buffer, and absorbed overwrites are writes to pages already dirty in it,
+ * which never reach the flash. */
+struct buffer_stats
+{
+	unsigned long read_hits;
+	unsigned long read_misses;
+	unsigned long write_hits;
+	unsigned long write_misses;
+	unsigned long overwrites_absorbed;
+	unsigned long flushes;
+	unsigned long pages_flushed;
+};
+
+/* Number of equal-width erase count buckets in a wear histogram */
+#define WEAR_HISTOGRAM_BUCKETS 16
+
+/* Wear statistics for the whole SSD or for one plane.  They are kept up to
+ * date by the Flash_store on every erase, so reading them is cheap.  Bucket i
+ * of the histogram counts the blocks with erase counts in
+ * [i * bucket_width, (i + 1) * bucket_width). */
+struct wear_summary
+{
+	unsigned long min_erases;
+	unsigned long max_erases;
+	unsigned long blocks_at_min;
+	unsigned long total_erases;
+	double last_erase_time;
+	unsigned long bucket_width;
+	unsigned long histogram[WEAR_HISTOGRAM_BUCKETS];
+};
+
+/* Counters of the work done by the FTL, see Ftl::get_stats
+ * 	host_* count pages the FTL was asked to read, write or trim
+ * 	gc_page_copies counts pages moved by garbage collection, copybacks the
+ * 		part of them moved inside a plane
+ * 	erases counts the block erases the FTL issued
+ * 	switch_merges turn a log block into a data block, partial_merges do so
+ * 		after copying the rest of the data block, full_merges copy a logical
+ * 		block into a new data block */
+struct ftl_stats
+{
+	unsigned long host_reads;
+	unsigned long host_writes;
+	unsigned long host_trims;
+	unsigned long gc_page_copies;
+	unsigned long copybacks;
+	unsigned long erases;
+	unsigned long switch_merges;
+	unsigned long partial_merges;
+	unsigned long full_merges;
+	unsigned long log_block_allocations;
+};
+
+/* Histogram of simulated times: bucket 0 counts times under 1 microsecond,
+ * 	bucket i times from 2^(i-1) up to 2^i microseconds and the last bucket
+ * 	everything longer */
+#define LATENCY_HISTOGRAM_BUCKETS 32
+struct latency_histogram
+{
+	unsigned long count;
+	double total;
+	double max;
+	unsigned long buckets[LATENCY_HISTOGRAM_BUCKETS];
+};
+
+/* Simulated time taken by host requests that succeeded and the part of it
+ * 	spent waiting for the bus, see Ssd::get_request_stats */
+struct request_stats
+{
+	struct latency_histogram read_latency;
+	struct latency_histogram write_latency;
+	struct latency_histogram bus_wait;
+};
+
+/* Log-linear histogram of simulated times for percentiles, taking the time
+ * 	units as seconds: times are counted in whole nanoseconds, exactly below
+ * 	PERCENTILE_SUB_BUCKETS and otherwise in PERCENTILE_SUB_BUCKETS buckets
+ * 	per power of 2, so a percentile is within 1/PERCENTILE_SUB_BUCKETS of the
+ * 	true time */
+#define PERCENTILE_SUB_BUCKETS 16
+#define PERCENTILE_BUCKETS (57 * PERCENTILE_SUB_BUCKETS)
+struct percentile_histogram
+{
+	unsigned long count;
+	unsigned long buckets[PERCENTILE_BUCKETS];
+};
+
+/* Host requests that started in one report window, see Ssd::print_report
+ * 	failed counts the requests that failed, which the latencies leave out
+ * 	host_writes counts the pages the host wrote and flash_writes the pages
+ * 		programmed while serving them, garbage collection copies included */
+struct report_window
+{
+	double start_time;
+	unsigned long failed;
+	unsigned long host_writes;
+	unsigned long flash_writes;
+	struct percentile_histogram read_latency;
+	struct percentile_histogram write_latency;
+};
+
+/* A flash operation kept in the trace ring of the Ssd, see Ssd::dump_trace
+ * 	physical_page is the flash store index of the page, or of the first page
+ * 		of the block for an erase; for a merge it is the source page */
+struct trace_entry
+{
+	double start_time;
+	double finish_time;
+	uint64_t logical_address;
+	uint64_t physical_page;
+	uint32_t type;
+	uint32_t status;
+};
+
+/* A snapshot file holds the state of an Ssd, see Ssd::save_snapshot.  It is a
+ * short header followed by sections, each a 64-bit length and that many
+ * bytes padded to 8 bytes, written and read back in the same order by the
+ * classes that own the state.  Snapshots are written with stdio and read
+ * from a read-only mmap of the file, so loading the same snapshot in many
+ * processes costs one copy of each table out of the shared page cache.
+ * A section whose length is not the one the reader expects means the file
+ * is damaged, and read exits with FILE_ERR since the Ssd is partly loaded by
+ * then; Ssd::load_snapshot checks the configuration before it loads anything.
+ * The file is in host byte order. */
+class Snapshot
+{
+public:
+	Snapshot(void);
+	~Snapshot(void);
+	enum status create(const char *path);
+	enum status open(const char *path);
+	enum status close(void);
+	void write(const void *data, size_t size);
+	void read(void *data, size_t size);
+	template <class T> void write_array(const T *values, unsigned long count) { write(values, count * sizeof(T)); }
+	template <class T> void read_array(T *values, unsigned long count) { read(values, count * sizeof(T)); }
+	template <class T> void write_vector(const std::vector<T> &values);
+	template <class T> void read_vector(std::vector<T> &values);
+private:
+	size_t next_length(void);
+	const char *path;
+	/* the file being written, or the mapping being read */
+	FILE *file;
+	const unsigned char *map;
+	size_t map_size;
+	size_t offset;
+	bool failed;
+};
+
+/* a vector is a section with its length followed by a section with its
+ * 	elements, so it is read back at the length it was written */
+template <class T> void Snapshot::write_vector(const std::vector<T> &values)
+{
+	uint64_t count = values.size();
+	write(&count, sizeof(count));
+	write_array(values.empty() ? NULL : &values[0], count);
+}
+
+template <class T> void Snapshot::read_vector(std::vector<T> &values)
+{
+	uint64_t count;
+	read(&count, sizeof(count));
+	values.resize(count);
+	read_array(values.empty() ? NULL : &values[0], count);
+}
+
+/* The flash store holds the state of every page and block in the SSD in flat
+ * arrays so the Page, Block, Plane, Die and Package classes can be thin views
+ * over it instead of one object per page.  Page states are packed 2 bits
+ * each, the per-block counters are parallel arrays indexed by the physical
+ * block number (Geometry::get_block_index), and the page and erase delays
+ * are held once.  The store also keeps the wear summaries of every plane and
+ * of the whole SSD. */
+class Flash_store
+{
+public:
+	Flash_store(const Geometry &geometry = Geometry(), unsigned long block_erases = BLOCK_ERASES, double page_read_delay = PAGE_READ_DELAY, double page_write_delay = PAGE_WRITE_DELAY, double erase_delay = BLOCK_ERASE_DELAY);
+	~Flash_store(void);
+	const Geometry &get_geometry(void) const;
+	unsigned long get_block_index(const Address &address) const;
+	unsigned long get_page_index(const Address &address) const;
+	unsigned long get_num_blocks(void) const;
+	unsigned int get_block_size(void) const;
+	unsigned long get_erases_remaining(unsigned long block) const;
+	double get_last_erase_time(unsigned long block) const;
+	const struct wear_summary &get_wear_summary(void) const;
+	const struct wear_summary &get_wear_summary(unsigned long plane) const;
+	static bool packages_disjoint(const Geometry &geometry);
+	void save(Snapshot &snapshot) const;
+	void load(Snapshot &snapshot);
+	friend class Page;
+	friend class Block;
+private:
+	enum page_state get_page_state(unsigned long page) const;
+	void set_page_state(unsigned long page, enum page_state state);
+	void init_wear(struct wear_summary &wear, unsigned long count);
+	void record_erase(unsigned long block, double time);
+	void add_erase(struct wear_summary &wear, unsigned long erases, double time, unsigned long first, unsigned long count);
+	const Geometry geometry;
+	unsigned long num_blocks;
+	unsigned int plane_size;
+	unsigned int block_size;
+	unsigned long block_erases;
+	unsigned char * const page_states;
+	unsigned int * const pages_valid;
+	unsigned int * const pages_invalid;
+	unsigned char * const block_states;
+	unsigned long * const erases_remaining;
+	double * const last_erase_time;
+	double page_read_delay;
+	double page_write_delay;
+	double erase_delay;
+	struct wear_summary device_wear;
+	struct wear_summary * const plane_wear;
+	/* erases of blocks in different packages may be recorded by different
+	 * 	threads of the dispatcher, and they all update device_wear */
+	std::mutex wear_lock;
+};
+
 /* The page is the lowest level data storage unit that is the size unit of
- * requests (events).  Pages maintain their state as events modify them. */
+ * requests (events).  A page is a view of one page state in the flash store
+ * that is created as needed. */
 class Page 
 {
 public:
-	Page(const Block &parent, double read_delay = PAGE_READ_DELAY, double write_delay = PAGE_WRITE_DELAY);
-	~Page(void);
+	Page(Flash_store &store, unsigned long index);
 	enum status _read(Event &event);
 	enum status _write(Event &event);
-	const Block &get_parent(void) const;
 	enum page_state get_state(void) const;
 	void set_state(enum page_state state);
 private:
-	enum page_state state;
-	const Block &parent;
-	double read_delay;
-	double write_delay;
-/* 	Address next_page; */
+	Flash_store &store;
+	unsigned long index;
 };
 
 /* The block is the data storage hardware unit where erases are implemented.
- * Blocks maintain wear statistics for the FTL. */
+ * Blocks maintain wear statistics for the FTL.  A block is a view of one
+ * block's counters in the flash store that is created as needed. */
 class Block 
 {
 public:
-	Block(const Plane &parent, unsigned int size = BLOCK_SIZE, unsigned long erases_remaining = BLOCK_ERASES, double erase_delay = BLOCK_ERASE_DELAY);
-	~Block(void);
+	Block(Flash_store &store, unsigned long index);
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status _erase(Event &event);
-	const Plane &get_parent(void) const;
 	unsigned int get_pages_valid(void) const;
 	unsigned int get_pages_invalid(void) const;
 	enum block_state get_state(void) const;
@@ -356,59 +920,60 @@ public:
 	enum status get_next_page(Address &address) const;
 	void invalidate_page(unsigned int page);
 private:
-	unsigned int size;
-	Page * const data;
-	const Plane &parent;
-	unsigned int pages_valid;
-	unsigned int pages_invalid;
-	enum block_state state;
-	unsigned long erases_remaining;
-	double last_erase_time;
-	double erase_delay;
+	Page get_page(unsigned int page) const;
+	Flash_store &store;
+	unsigned long index;
 };
 
 /* The plane is the data storage hardware unit that contains blocks.
- * Plane-level merges are implemented in the plane.  Planes maintain wear
+ * Plane-level merges and page copybacks are implemented in the plane.  Planes
+ * maintain wear
  * statistics for the FTL. */
 class Plane 
 {
 public:
-	Plane(const Die &parent, unsigned int plane_size = PLANE_SIZE, double reg_read_delay = PLANE_REG_READ_DELAY, double reg_write_delay = PLANE_REG_WRITE_DELAY);
+	Plane(const Die &parent, Flash_store &store, unsigned long first_block, unsigned int plane_size = PLANE_SIZE, double reg_read_delay = PLANE_REG_READ_DELAY, double reg_write_delay = PLANE_REG_WRITE_DELAY);
 	~Plane(void);
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status erase(Event &event);
 	enum status _merge(Event &event);
+	enum status copyback(Event &event);
 	const Die &get_parent(void) const;
 	double get_last_erase_time(const Address &address) const;
 	unsigned long get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
+	const struct wear_summary &get_wear_summary(void) const;
 	unsigned int get_size(void) const;
 	enum page_state get_state(const Address &address) const;
 	void get_free_page(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	void save(Snapshot &snapshot) const;
+	void load(Snapshot &snapshot);
 private:
-	void update_wear_stats(void);
 	enum status get_next_page(void);
+	Block get_block(unsigned int block) const;
+	void wait_idle(Event &event) const;
 	unsigned int size;
-	Block * const data;
+	Flash_store &store;
+	unsigned long first_block;
 	const Die &parent;
-	unsigned int least_worn;
-	unsigned long erases_remaining;
-	double last_erase_time;
 	double reg_read_delay;
 	double reg_write_delay;
 	Address next_page;
 	unsigned int free_blocks;
+	double busy_until;
 };
 
 /* The die is the data storage hardware unit that contains planes and is a flash
- * chip.  Dies maintain wear statistics for the FTL. */
+ * chip.  Dies maintain wear statistics for the FTL.  Dies and planes keep the
+ * time they are busy until, so operations on the same die queue behind each
+ * other while other dies and channels work in parallel. */
 class Die 
 {
 public:
-	Die(const Package &parent, Channel &channel, unsigned int die_size = DIE_SIZE);
+	Die(const Package &parent, Channel &channel, Flash_store &store, unsigned long first_block, unsigned int die_size = DIE_SIZE);
 	~Die(void);
 	enum status read(Event &event);
 	enum status write(Event &event);
@@ -423,15 +988,21 @@ public:
 	void get_free_page(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	void save(Snapshot &snapshot) const;
+	void load(Snapshot &snapshot);
 private:
-	void update_wear_stats(const Address &address);
+	void wait_idle(Event &event) const;
+	void schedule(Event &event);
 	unsigned int size;
 	Plane * const data;
 	const Package &parent;
 	Channel &channel;
-	unsigned int least_worn;
-	unsigned long erases_remaining;
-	double last_erase_time;
+	double busy_until;
+	/* the operation started last on the die and the planes taking part in it,
+	 * 	which other planes may join with MULTI_PLANE */
+	enum event_type group_type;
+	double group_start;
+	unsigned long group_planes;
 };
 
 /* The package is the highest level data storage hardware unit.  While the
@@ -441,7 +1012,7 @@ private:
 class Package 
 {
 public:
-	Package (const Ssd &parent, Channel &channel, unsigned int package_size = PACKAGE_SIZE);
+	Package (const Ssd &parent, Channel &channel, Flash_store &store, unsigned long first_block, unsigned int package_size = PACKAGE_SIZE);
 	~Package ();
 	enum status read(Event &event);
 	enum status write(Event &event);
@@ -455,14 +1026,12 @@ public:
 	void get_free_page(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	void save(Snapshot &snapshot) const;
+	void load(Snapshot &snapshot);
 private:
-	void update_wear_stats (const Address &address);
 	unsigned int size;
 	Die * const data;
 	const Ssd &parent;
-	unsigned int least_worn;
-	unsigned long erases_remaining;
-	double last_erase_time;
 };
 
 /* place-holder definitions for GC, WL, FTL, RAM, Controller 
@@ -474,8 +1043,28 @@ public:
 	~Garbage_collector(void);
 	enum status collect(Event &event, enum GC_POLICY policy);
   
-  bool clean(unsigned long data_pba, unsigned long log_pba);
+  bool clean(unsigned long logical_block, unsigned long data_pba, unsigned long log_pba);
+  bool switch_merge(unsigned long logical_block, unsigned long data_pba, unsigned long log_pba);
   unsigned long next_log_block_to_clean(enum GC_POLICY policy);
+  bool shuffle_data_log(void);
+  bool next_unmapped_log_block(unsigned long *log_pba,
+                               unsigned int *pa, unsigned int *d,
+                               unsigned int *pl, unsigned int *b,
+                               enum temperature temp = TEMP_UNKNOWN,
+                               int data_block = -1);
+  unsigned long remap_data_block(unsigned long logical_block,
+                                 unsigned long old_data_pba, unsigned long log_pba);
+  unsigned long remap_log_block(unsigned long logical_block,
+                                unsigned long data_pba, unsigned long old_log_pba);
+  bool reclaim_log_block(enum GC_POLICY policy);
+  bool reclaim_page_block(void);
+  bool next_free_page(unsigned long *physical_address, unsigned int stream);
+  bool next_shared_block(unsigned long *physical_address, bool merging);
+  bool merge_shared_logs(unsigned long logical_block);
+  bool merge_sequential_log(void);
+  bool reclaim_random_log(void);
+  void free_trimmed_block(unsigned long logical_block);
+  void free_dead_block(unsigned long physical_address);
 
   FILE *log_file;
   Ftl &ftl;
@@ -501,39 +1090,120 @@ public:
 	~Ftl(void);
 	enum status read(Event &event);
 	enum status write(Event &event);
+  enum status trim(Event &event);
   enum status garbage_collect(Event &event);
   FILE *log_file;
   enum status translate( Event &event );
+  enum status translate_page( Event &event );
+  enum status translate_shared( Event &event );
+  enum status background_collect(double time, bool idle, double *finish_time);
 	enum status erase(Event &event);
 	enum status merge(Event &event);
 	unsigned long get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
 	enum page_state get_state(const Address &address) const;
     void init_ftl_user();
+  void print_info(void);
+	const struct ftl_stats &get_stats(void) const;
+	void exit_ftl_user(void);
+	void save_ftl_user(Snapshot &snapshot);
+	void load_ftl_user(Snapshot &snapshot);
 	Controller &controller;
 	Garbage_collector garbage;
 	Wear_leveler wear;
-// new functions
-  	bool fetch_log_page(std::string offsets, unsigned int data_page, unsigned int *log_page);
-  	bool next_free_log_page(std::string offsets, unsigned int *page);
-  	bool next_unmapped_log_block(unsigned long *log_pba,
-                                     unsigned int *pa, unsigned int *d, 
-                                     unsigned int *pl, unsigned int *b);
+	/* the FTL's tables, allocated by init_ftl_user */
+	struct ftl_state *state;
 };
 
 /* This is a basic implementation that only provides delay updates to events
  * based on a delay value multiplied by the size (number of pages) needed to
- * be written. */
+ * be written.  It also keeps the write-back buffer of logical pages that the
+ * Controller serves requests from; the buffer tracks which pages are held and
+ * whether they are dirty, not their data. */
 class Ram 
 {
 public:
-	Ram(double read_delay = RAM_READ_DELAY, double write_delay = RAM_WRITE_DELAY);
+	Ram(double read_delay = RAM_READ_DELAY, double write_delay = RAM_WRITE_DELAY, unsigned int buffer_size = WRITE_BUFFER_SIZE);
 	~Ram(void);
 	enum status read(Event &event);
 	enum status write(Event &event);
+	bool buffer_lookup(unsigned long logical_address, bool write);
+	bool buffer_full(void) const;
+	void buffer_insert(unsigned long logical_address, bool dirty);
+	void buffer_remove(unsigned long logical_address);
+	unsigned long buffer_victim(void) const;
+	bool buffer_holds(unsigned long logical_address) const;
+	bool buffer_dirty(unsigned long logical_address) const;
+	void buffer_clean(unsigned long logical_address);
+	void buffer_dirty_pages(unsigned long first, unsigned long count, std::vector<unsigned long> &pages) const;
+	void buffer_flushed(void);
+	const struct buffer_stats &get_buffer_stats(void) const;
+	void save(Snapshot &snapshot) const;
+	void load(Snapshot &snapshot);
 private:
+	struct buffer_entry
+	{
+		bool dirty;
+		std::list<unsigned long>::iterator position;
+	};
 	double read_delay;
 	double write_delay;
+	unsigned int buffer_size;
+	/* buffered pages by logical address, and in order of use with the least
+	 * recently used at the front */
+	std::map<unsigned long, struct buffer_entry> buffer;
+	std::list<unsigned long> lru;
+	struct buffer_stats stats;
+};
+
+/* The dispatcher runs the flash operations of independent event lists, the
+ * lists the controller issues without stopping at a failure such as the
+ * copies and erases of a cleaning step, on worker threads.  Package i belongs
+ * to worker i % threads, which takes the events of its packages in list order
+ * from a lock-free single-producer single-consumer ring filled by the
+ * controller.  Below the controller the packages share nothing but the
+ * device wear summary, so every package and its channel see the same
+ * operations in the same order as on one thread.  Synchronization is
+ * conservative: the controller waits for the whole list before it looks at
+ * any result, so simulated results do not depend on the number of threads.
+ * Lists that stay on the packages of one worker run on the caller's thread. */
+class Dispatcher
+{
+public:
+	Dispatcher(Controller &controller, const Geometry &geometry, unsigned int threads = PACKAGE_THREADS);
+	~Dispatcher(void);
+	bool spans_workers(const Event &event_list) const;
+	void post(Event &event, enum status *status);
+	void wait(void);
+private:
+	/* an event and where to leave the status of its flash operations */
+	struct job
+	{
+		Event *event;
+		enum status *status;
+	};
+	/* a worker thread and its ring of DISPATCH_RING_SIZE jobs
+	 * only the controller writes head and only the worker writes tail, which
+	 * 	it advances once a job is done, so the ring is empty and every job
+	 * 	done when they are equal; they are kept on separate cache lines
+	 * sleeping is set while the worker waits on wake for an empty ring */
+	struct worker
+	{
+		std::thread thread;
+		struct job *ring;
+		std::atomic<unsigned long> head;
+		char head_line[64];
+		std::atomic<unsigned long> tail;
+		char tail_line[64];
+		std::atomic<bool> sleeping;
+		std::mutex lock;
+		std::condition_variable wake;
+	};
+	void work(struct worker &worker);
+	Controller &controller;
+	unsigned int threads;
+	std::vector<struct worker *> workers;
+	std::atomic<bool> stopping;
 };
 
 /* The controller accepts read/write requests through its event_arrive method
@@ -551,8 +1221,22 @@ public:
 	~Controller(void);
 	enum status event_arrive(Event &event);
   FILE *log_file;
-  enum status issue(Event &event_list);
+  enum status issue(Event &event_list, bool stop_on_failure = true);
+	enum status background_collect(double time, bool idle, double *finish_time);
+	Event *new_event(enum event_type type, unsigned long logical_address, unsigned int size, double start_time);
+	void free_events(Event &event_list);
+	const Geometry &get_geometry(void) const;
+	Ftl &get_ftl(void);
+	const struct ftl_stats &get_ftl_stats(void) const;
+	friend class Dispatcher;
 private:
+	enum status issue_event(Event &event);
+	enum status prepare_event(Event &event);
+	enum status execute_event(Event &event);
+	enum status dispatch(Event &event_list);
+	enum status trim(Event &event);
+	enum status buffer_arrive(Event &event);
+	enum status make_buffer_room(Event &event, bool wait);
 	unsigned long get_erases_remaining(const Address &address) const;
 	void get_least_worn(Address &address) const;
 	double get_last_erase_time(const Address &address) const;
@@ -562,6 +1246,9 @@ private:
 	unsigned int get_num_valid(const Address &address) const;
 	Ssd &ssd;
 	Ftl ftl;
+	Dispatcher dispatcher;
+	/* status of each event of the list being dispatched */
+	std::vector<enum status> statuses;
 };
 
 /* The SSD is the single main object that will be created to simulate a real
@@ -570,24 +1257,44 @@ private:
 class Ssd 
 {
 public:
-	Ssd (FILE *log_file, unsigned int ssd_size = SSD_SIZE);
+	Ssd (FILE *log_file, const Geometry &geometry = Geometry());
 	~Ssd(void);
 	double event_arrive(enum event_type type, unsigned long logical_address, unsigned int size, double start_time, int *status, Address &address);
+	void submit_batch(const struct request *reqs, size_t n, struct completion *out);
+	void submit(const struct request &req, completion_callback callback, void *context);
+	void run(double until);
+	void drain(void);
+	unsigned int get_outstanding(void) const;
   unsigned long get_pages_per_block();
   unsigned long get_total_erases_performed();
   unsigned long get_total_writes_observed();
   void write_ref_map(unsigned long lba, Address pba);
   bool is_valid(unsigned long lba, Address validate_with);
   unsigned long get_max_num_erases();
+	const struct wear_summary &get_wear_summary(void) const;
+	const struct wear_summary &get_wear_summary(const Address &address) const;
+	const struct buffer_stats &get_buffer_stats(void) const;
+	const struct ftl_stats &get_ftl_stats(void) const;
+	const struct request_stats &get_request_stats(void) const;
+	unsigned long dump_trace(FILE *stream) const;
+	unsigned long get_total_host_writes(void) const;
+	double get_write_amplification(void) const;
+	double get_latency_percentile(enum event_type type, double fraction) const;
+	void print_report(FILE *stream) const;
+	enum status save_snapshot(const char *path);
+	enum status load_snapshot(const char *path);
+	Controller &get_controller(void);
+	const Geometry &get_geometry(void) const;
   FILE *log_file;
 	friend class Controller;
 private:
+	enum status prepare(Event &event);
 	enum status read(Event &event);
 	enum status write(Event &event);
 	enum status erase(Event &event);
 	enum status merge(Event &event);
+	void trim(const Event &event);
 	unsigned long get_erases_remaining(const Address &address) const;
-	void update_wear_stats(const Address &address);
 	void get_least_worn(Address &address) const;
 	double get_last_erase_time(const Address &address) const;	
 	Package &get_data(void);
@@ -595,18 +1302,62 @@ private:
 	void get_free_page(Address &address) const;
 	unsigned int get_num_free(const Address &address) const;
 	unsigned int get_num_valid(const Address &address) const;
+	void service(const struct request &req, double issue_time, struct completion &out);
+	void collect_idle(double next_arrival);
+	void record_request(enum event_type type, enum status status, double start_time, unsigned int pages, double time_taken, double bus_wait_time);
+	void record_trace(const Event &event, enum status status);
+	/* declared first so the controller and its FTL can size themselves
+	 * 	from it */
+	const Geometry geometry;
 	unsigned int size;
 	Controller controller;
 	Ram ram;
 	Bus bus;
+	Flash_store store;
+	Event_pool events;
 	Package * const data;
-	unsigned long erases_remaining;
-	unsigned long least_worn;
-	double last_erase_time;
   unsigned long total_erases_performed;
   unsigned long total_writes_observed;
-  std::map<unsigned long, Address> ref_map;
-  unsigned long max_num_erases;
+  /* consistency checker tables, left empty when CONSISTENCY_CHECK is 0
+   * ref_map: physical page of the latest write of each logical page
+   * unread_block: physical block holding the latest write of each logical
+   * 	page that has not been read since, so the block must not be erased
+   * unread_pages: number of such logical pages in each physical block */
+  std::vector<unsigned long> ref_map;
+  std::vector<unsigned long> unread_block;
+  std::vector<unsigned int> unread_pages;
+  /* consistency checker results: no read found a stale page, no write went
+   * 	to a page that is not free, and the FTL used no illegal operation,
+   * 	which const hardware queries also report */
+  bool reads_passed;
+  bool writes_passed;
+  mutable bool valid_op;
+	/* discrete-event engine for submit and run
+	 * arrivals: accepted requests not yet issued, a min-heap by start time
+	 * completions: issued requests not yet completed, a min-heap by finish
+	 * 	time */
+	std::vector<struct pending_io> arrivals;
+	std::vector<struct pending_io> completions;
+	unsigned long next_seq;
+	unsigned int outstanding;
+	double now;
+	/* finish time of the background cleaning steps issued so far */
+	double gc_until;
+	struct request_stats request_stats;
+	/* the last TRACE_RING_SIZE flash operations, trace_next is the slot of
+	 * 	the next one and trace_count the number recorded so far */
+	std::vector<struct trace_entry> trace_ring;
+	unsigned long trace_next;
+	unsigned long trace_count;
+	/* write amplification and latency percentiles for Ssd::print_report
+	 * report_totals covers the whole run and report_windows each
+	 * 	REPORT_WINDOW of it that had requests, by window number
+	 * reported_writes is total_writes_observed when the last request was
+	 * 	recorded */
+	unsigned long total_host_writes;
+	unsigned long reported_writes;
+	struct report_window report_totals;
+	std::map<unsigned long, struct report_window> report_windows;
 };
 
 } /* end namespace ssd */
@@ -21,7 +21,8 @@
  * Brendan Tauras 2009-10-26
  *
  * The block is the data storage hardware unit where erases are implemented.
- * Blocks maintain wear statistics for the FTL. */
+ * Blocks maintain wear statistics for the FTL.  The counters live in the
+ * Flash_store, so a Block is only a view that is created as needed. */
 
 #include <new>
 #include <assert.h>
@@ -30,77 +31,33 @@
 
 using namespace ssd;
 
-Block::Block(const Plane &parent, unsigned int block_size, unsigned long erases_remaining, double erase_delay):
-	size(block_size),
-
-	/* use a const pointer (Page * const data) to use as an array
-	 * but like a reference, we cannot reseat the pointer */
-	data((Page *) malloc(block_size * sizeof(Page))),
-	parent(parent),
-	pages_valid(0),
-	pages_invalid(0),
-	state(FREE),
-
-	/* set erases remaining to BLOCK_ERASES to match Block constructor args 
-	 * in Plane class
-	 * this is the cheap implementation but can change to pass through classes */
-/* 	erases_remaining(BLOCK_ERASES), */
-	erases_remaining(erases_remaining),
-
-	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0),
-	erase_delay(erase_delay)
+Block::Block(Flash_store &store, unsigned long index):
+	store(store),
+	index(index)
 {
-	unsigned int i;
-
-	if(erase_delay < 0.0)
-	{
-		fprintf(stderr, "Block warning: %s: constructor received negative erase delay value\n\tsetting erase delay to 0.0\n", __func__);
-		erase_delay = 0.0;
-	}
-
-	/* new cannot initialize an array with constructor args so
-	 * 	malloc the array
-	 * 	then use placement new to call the constructor for each element
-	 * chose an array over container class so we don't have to rely on anything
-	 * 	i.e. STL's std::vector */
-	/* array allocated in initializer list:
-	 * data = (Page *) malloc(size * sizeof(Page)); */
-	if(data == NULL){
-		fprintf(stderr, "Block error: %s: constructor unable to allocate Page data\n", __func__);
-		exit(MEM_ERR);
-	}
-	for(i = 0; i < size; i++)
-		(void) new (&data[i]) Page(*this, PAGE_READ_DELAY, PAGE_WRITE_DELAY);
+	assert(index < store.num_blocks);
 	return;
 }
 
-Block::~Block(void)
+/* view of a page in this block */
+Page Block::get_page(unsigned int page) const
 {
-	assert(data != NULL);
-	unsigned int i;
-	/* call destructor for each Page array element
-	 * since we used malloc and placement new */
-	for(i = 0; i < size; i++)
-		data[i].~Page();
-	free(data);
-	return;
+	assert(page < store.block_size);
+	return Page(store, index * store.block_size + page);
 }
 
 enum status Block::read(Event &event)
 {
-	assert(data != NULL);
-	return data[event.get_address().page]._read(event);
+	return get_page(event.get_address().page)._read(event);
 }
 
 enum status Block::write(Event &event)
 {
-	assert(data != NULL);
-	enum status ret = data[event.get_address().page]._write(event);
+	enum status ret = get_page(event.get_address().page)._write(event);
 	if(ret == SUCCESS)
 	{
-		pages_valid++;
-		state = ACTIVE;
+		store.pages_valid[index]++;
+		store.block_states[index] = ACTIVE;
 	}
 	return ret;
 }
@@ -111,87 +68,79 @@ enum status Block::write(Event &event)
  * returns 1 for success, 0 for failure */
 enum status Block::_erase(Event &event)
 {
-	assert(data != NULL && erase_delay >= 0.0);
+	assert(store.erase_delay >= 0.0);
 	unsigned int i;
 
-	if(erases_remaining < 1)
+	if(store.erases_remaining[index] < 1)
 	{
 		fprintf(stderr, "Block error: %s: No erases remaining when attempting to erase\n", __func__);
 		return FAILURE;
 	}
 
-	for(i = 0; i < size; i++)
-		data[i].set_state(EMPTY);
-	event.incr_time_taken(erase_delay);
-	last_erase_time = event.get_start_time() + event.get_time_taken();
-	erases_remaining--;
-	pages_valid = 0;
-	pages_invalid = 0;
-	state = FREE;
+	for(i = 0; i < store.block_size; i++)
+		get_page(i).set_state(EMPTY);
+	event.incr_time_taken(store.erase_delay);
+	store.record_erase(index, event.get_start_time() + event.get_time_taken());
+	store.pages_valid[index] = 0;
+	store.pages_invalid[index] = 0;
+	store.block_states[index] = FREE;
 	return SUCCESS;
 }
 
-const Plane &Block::get_parent(void) const
-{
-	return parent;
-}
-
 unsigned int Block::get_pages_valid(void) const
 {
-	return pages_valid;
+	return store.pages_valid[index];
 }
 
 unsigned int Block::get_pages_invalid(void) const
 {
-	return pages_invalid;
+	return store.pages_invalid[index];
 }
 
 
 enum block_state Block::get_state(void) const
 {
-	return state;
+	return (enum block_state) store.block_states[index];
 }
 
 enum page_state Block::get_state(unsigned int page) const
 {
-	assert(data != NULL && page < size);
-	return data[page].get_state();
+	return get_page(page).get_state();
 }
 
 enum page_state Block::get_state(const Address &address) const
 {
-   assert(data != NULL && address.page < size && address.valid >= BLOCK);
-   return data[address.page].get_state();
+   assert(address.valid >= BLOCK);
+   return get_page(address.page).get_state();
 }
 
 double Block::get_last_erase_time(void) const
 {
-	return last_erase_time;
+	return store.last_erase_time[index];
 }
 
 unsigned long Block::get_erases_remaining(void) const
 {
-	return erases_remaining;
+	return store.erases_remaining[index];
 }
 
 unsigned int Block::get_size(void) const
 {
-	return size;
+	return store.block_size;
 }
 
 void Block::invalidate_page(unsigned int page)
 {
-	assert(page < size);
-	data[page].set_state(INVALID);
-	pages_invalid++;
+	get_page(page).set_state(INVALID);
+	store.pages_invalid[index]++;
 
 	/* update block state */
-	if(pages_invalid >= size)
-		state = INACTIVE;
-	else if(pages_valid > 0 || pages_invalid > 0)
-		state = ACTIVE;
+	if(store.pages_invalid[index] >= store.block_size)
+		store.block_states[index] = INACTIVE;
+	else if(store.pages_valid[index] > 0 || store.pages_invalid[index] > 0)
+		store.block_states[index] = ACTIVE;
 	else
-		state = FREE;
+		store.block_states[index] = FREE;
 	
 	return;
 }
@@ -202,9 +151,9 @@ enum status Block::get_next_page(Address &address) const
 {
 	unsigned int i;
 
-	for(i = 0; i < size; i++)
+	for(i = 0; i < store.block_size; i++)
 	{
-		if(data[i].get_state() == EMPTY)
+		if(get_page(i).get_state() == EMPTY)
 		{
 			address.page = i;
 			address.valid = PAGE;
@@ -126,3 +126,19 @@ Channel &Bus::get_channel(unsigned int channel)
 	assert(channels != NULL && channel < num_channels);
 	return channels[channel];
 }
+
+void Bus::save(Snapshot &snapshot) const
+{
+	unsigned int i;
+	for(i = 0; i < num_channels; i++)
+		channels[i].save(snapshot);
+	return;
+}
+
+void Bus::load(Snapshot &snapshot)
+{
+	unsigned int i;
+	for(i = 0; i < num_channels; i++)
+		channels[i].load(snapshot);
+	return;
+}
@@ -48,17 +48,24 @@ using namespace ssd;
 Channel::Channel(double ctrl_delay, double data_delay, unsigned int table_size, unsigned int max_connections):
 	table_size(table_size),
 
-	/* use a const pointer (double * const) for the scheduling table arrays
+	/* use const pointers (double * const) for the scheduling table arrays
 	 * like a reference, we cannot reseat the pointer */
 	lock_time(new double[table_size]),
 	unlock_time(new double[table_size]),
+	prev_unlock_time(new double[table_size]),
+	max_gap_time(new double[table_size]),
+	left(new int[table_size]),
+	right(new int[table_size]),
+	priority(new unsigned int[table_size]),
 
+	root(-1),
+	free_entry(0),
 	table_entries(0),
-	selected_entry(0),
 	num_connected(0),
 	max_connections(max_connections),
 	ctrl_delay(ctrl_delay),
-	data_delay(data_delay)
+	data_delay(data_delay),
+	full_warned(false)
 {
 	if(ctrl_delay < 0.0){
 		fprintf(stderr, "Bus channel warning: %s: constructor received negative control delay value\n\tsetting control delay to 0.0\n", __func__);
@@ -73,16 +80,26 @@ Channel::Channel(double ctrl_delay, double data_delay, unsigned int table_size,
 
 	/* initialize scheduling tables
 	 * arrays allocated in initializer list */
-	if(lock_time == NULL || unlock_time == NULL)
+	if(lock_time == NULL || unlock_time == NULL || prev_unlock_time == NULL || max_gap_time == NULL || left == NULL || right == NULL || priority == NULL)
 	{
 		fprintf(stderr, "Bus channel error: %s: constructor unable to allocate channel scheduling tables\n", __func__);
 		exit(MEM_ERR);
 	}
+
+	/* chain every table entry into the free list through the left links
+	 * the treap priorities only need to look random */
 	for(i = 0; i < table_size; i++)
 	{
 		lock_time[i] = BUS_CHANNEL_FREE_FLAG;
 		unlock_time[i] = BUS_CHANNEL_FREE_FLAG;
+		prev_unlock_time[i] = BUS_CHANNEL_FREE_FLAG;
+		max_gap_time[i] = BUS_CHANNEL_FREE_FLAG;
+		left[i] = (i + 1 < table_size) ? (int) (i + 1) : -1;
+		right[i] = -1;
+		priority[i] = (i + 1) * 2654435761u;
 	}
+	if(table_size == 0)
+		free_entry = -1;
 
 	return;
 }
@@ -93,6 +110,11 @@ Channel::~Channel(void)
 	assert(lock_time != NULL && unlock_time != NULL);
 	delete[] lock_time;
 	delete[] unlock_time;
+	delete[] prev_unlock_time;
+	delete[] max_gap_time;
+	delete[] left;
+	delete[] right;
+	delete[] priority;
 	if(num_connected > 0)
 		fprintf(stderr, "Bus channel warning: %s: %d connected devices when bus channel terminated\n", __func__, num_connected);
 	return;
@@ -135,83 +157,19 @@ enum status Channel::disconnect(void)
  * updates event with bus delay and bus wait time if there is wait time
  * bus will automatically unlock after event is finished using bus
  * event is sent across bus as soon as bus channel is available
- * event may fail if bus channel is saturated so check return value
+ * if the scheduling table is full, the event is queued after the last
+ * 	reservation instead of searching for an earlier gap
  */
 enum status Channel::lock(double start_time, double duration, Event &event)
 {
 /* TODO: Recombine assert statements */
 	assert(lock_time != NULL && unlock_time != NULL);assert(num_connected <= max_connections);assert(ctrl_delay >= 0.0);assert(data_delay >= 0.0);assert(start_time >= 0.0);assert(duration >= 0.0);
 
-	#ifndef NDEBUG
-		unsigned int j;
-		printf("Table entries before unlock()\n");
-		for(j = 0; j < table_size; j++)
-			printf("%lf, %lf\n", lock_time[j], unlock_time[j]);
-		printf("Press ENTER to continue...");
-		fflush(stdout);
-		getchar();
-	#endif
-
-	/* free up any table slots and sort existing ones */
+	/* free up any table entries that finished before this event */
 	unlock(start_time);
 
-	#ifndef NDEBUG
-		printf("Table entries after unlock()\n");
-		for(j = 0; j < table_size; j++)
-			printf("%lf, %lf\n", lock_time[j], unlock_time[j]);
-		printf("Press ENTER to continue...");
-		fflush(stdout);
-		getchar();
-	#endif
-
-	/* give up if no free table slots */
-	if(table_entries >= table_size)
-		return FAILURE;
-	
-	unsigned int i = 0;
-	double sched_time = BUS_CHANNEL_FREE_FLAG;
-
-	/* just schedule if table is empty */
-	if(table_entries == 0)
-		sched_time = start_time;
-
-	/* check if can schedule before or in between before just scheduling
-	 * after all other events */
-	else
-	{
-		/* skip over empty table entries
-		 * empty table entries will be first from sorting (in unlock method)
-		 * because the flag is a negative value */
-		while(lock_time[i] == BUS_CHANNEL_FREE_FLAG && i < table_size)
-			i++;
-	
-		/* schedule before first event in table */
-		if(lock_time[i] > start_time && lock_time[i] - start_time >= duration)
-			sched_time = start_time;
-	
-		/* schedule in between other events in table */
-		if(sched_time == BUS_CHANNEL_FREE_FLAG)
-		{
-			for(; i < table_size - 2; i++)
-			{
-				/* enough time to schedule in between next two events */
-				if(unlock_time[i] >= start_time  && lock_time[i + 1] - unlock_time[i] >= duration)
-				{
-					sched_time = unlock_time[i];
-					break;
-				}
-			}
-		}
-	
-		/* schedule after all events in table */
-		if(sched_time == BUS_CHANNEL_FREE_FLAG)
-			sched_time = unlock_time[table_size - 1];
-	}
-
-	/* write scheduling info in free table slot */
-	lock_time[0] = sched_time;
-	unlock_time[0] = sched_time + duration;
-	table_entries++;
+	/* schedule in the earliest gap that fits, then record the reservation */
+	double sched_time = reserve(find_gap(start_time, duration), duration);
 
 	/* update event times for bus wait and time taken */
 	event.incr_bus_wait_time(sched_time - start_time);
@@ -222,26 +180,249 @@ enum status Channel::lock(double start_time, double duration, Event &event)
 
 /* remove all expired entries (finish time is less than provided time)
  * update current number of table entries used
- * sort table by finish times (2nd row) */
+ * the reservations are ordered, so the expired ones split off as a prefix */
 void Channel::unlock(double start_time)
 {
-	unsigned int i;
+	int expired;
+	split_expired(root, start_time, expired, root);
+	release(expired);
 
-	/* remove expired channel lock entries */
-	for(i = 0; i < table_size; i++)
+	/* the new first reservation has no reservation before it */
+	if(root >= 0)
+		set_first_gap(root, BUS_CHANNEL_FREE_FLAG);
+	return;
+}
+
+/* find the earliest time at or after start_time with duration of idle bus
+ * expects entries that finished before start_time to be unlocked, so every
+ * 	reservation still in the table finishes after start_time */
+double Channel::find_gap(double start_time, double duration) const
+{
+	int cur;
+
+	/* just schedule if table is empty */
+	if(root < 0)
+		return start_time;
+
+	/* schedule before first event in table */
+	if(lock_time[first(root)] - start_time >= duration)
+		return start_time;
+
+	/* schedule in the first gap between events that is long enough
+	 * follow the subtree maximums to find it */
+	cur = root;
+	while(cur >= 0 && max_gap_time[cur] >= duration)
 	{
-		if(unlock_time[i] != BUS_CHANNEL_FREE_FLAG)
+		if(left[cur] >= 0 && max_gap_time[left[cur]] >= duration)
+			cur = left[cur];
+		else if(gap(cur) >= duration)
+			return prev_unlock_time[cur];
+		else
+			cur = right[cur];
+	}
+
+	/* schedule after all events in table */
+	return unlock_time[last(root)];
+}
+
+/* record the bus as busy from sched_time for duration
+ * every reservation keeps its own entry so it can expire on its own
+ * returns the time the reservation was actually scheduled */
+double Channel::reserve(double sched_time, double duration)
+{
+	int before;
+	int after;
+	int prev;
+	int entry;
+
+	split(root, sched_time, before, after);
+	prev = (before >= 0) ? last(before) : -1;
+
+	/* no free table entries, so queue after every other event
+	 * the last reservation can simply be extended */
+	if(free_entry < 0)
+	{
+		root = join(before, after);
+		if(!full_warned)
 		{
-			if(unlock_time[i] <= start_time)
-			{
-				lock_time[i] = unlock_time[i] = BUS_CHANNEL_FREE_FLAG;
-				table_entries--;
-			}
+			fprintf(stderr, "Bus channel warning: %s: scheduling table of %u entries is full\n\tqueueing events after the last reservation, consider raising BUS_TABLE_SIZE\n", __func__, table_size);
+			full_warned = true;
 		}
+		entry = last(root);
+		sched_time = unlock_time[entry];
+		unlock_time[entry] = sched_time + duration;
+		return sched_time;
 	}
 
-	/* sort both arrays together - e.g. sort by first array but perform same
-	 * move operation on both arrays */
-	quicksort(lock_time, unlock_time, 0, table_size - 1);
+	/* write scheduling info in free table entry */
+	entry = free_entry;
+	free_entry = left[entry];
+	table_entries++;
+	lock_time[entry] = sched_time;
+	unlock_time[entry] = sched_time + duration;
+	prev_unlock_time[entry] = (prev >= 0) ? unlock_time[prev] : BUS_CHANNEL_FREE_FLAG;
+	left[entry] = -1;
+	right[entry] = -1;
+	priority[entry] = priority[entry] * 1103515245u + 12345u;
+	update(entry);
+	if(after >= 0)
+		set_first_gap(after, unlock_time[entry]);
+	root = join(join(before, entry), after);
+	return sched_time;
+}
+
+/* idle time between a reservation and the one before it
+ * negative for the first reservation so it never counts as a gap */
+double Channel::gap(int entry) const
+{
+	if(prev_unlock_time[entry] < 0.0)
+		return BUS_CHANNEL_FREE_FLAG;
+	return lock_time[entry] - prev_unlock_time[entry];
+}
+
+/* recompute the largest gap of a subtree from its children */
+void Channel::update(int entry)
+{
+	max_gap_time[entry] = gap(entry);
+	if(left[entry] >= 0 && max_gap_time[left[entry]] > max_gap_time[entry])
+		max_gap_time[entry] = max_gap_time[left[entry]];
+	if(right[entry] >= 0 && max_gap_time[right[entry]] > max_gap_time[entry])
+		max_gap_time[entry] = max_gap_time[right[entry]];
+	return;
+}
+
+/* split a subtree into reservations starting before time and the rest */
+void Channel::split(int entry, double time, int &before, int &after)
+{
+	if(entry < 0)
+	{
+		before = after = -1;
+		return;
+	}
+	if(lock_time[entry] < time)
+	{
+		split(right[entry], time, right[entry], after);
+		before = entry;
+	}
+	else
+	{
+		split(left[entry], time, before, left[entry]);
+		after = entry;
+	}
+	update(entry);
+	return;
+}
+
+/* split a subtree into reservations finished by time and the rest */
+void Channel::split_expired(int entry, double time, int &expired, int &active)
+{
+	if(entry < 0)
+	{
+		expired = active = -1;
+		return;
+	}
+	if(unlock_time[entry] <= time)
+	{
+		split_expired(right[entry], time, right[entry], active);
+		expired = entry;
+	}
+	else
+	{
+		split_expired(left[entry], time, expired, left[entry]);
+		active = entry;
+	}
+	update(entry);
+	return;
+}
+
+/* join two subtrees where every reservation in before comes first */
+int Channel::join(int before, int after)
+{
+	if(before < 0)
+		return after;
+	if(after < 0)
+		return before;
+	if(priority[before] > priority[after])
+	{
+		right[before] = join(right[before], after);
+		update(before);
+		return before;
+	}
+	left[after] = join(before, left[after]);
+	update(after);
+	return after;
+}
+
+int Channel::first(int entry) const
+{
+	while(left[entry] >= 0)
+		entry = left[entry];
+	return entry;
+}
+
+int Channel::last(int entry) const
+{
+	while(right[entry] >= 0)
+		entry = right[entry];
+	return entry;
+}
+
+/* set the previous finish time of the first reservation in a subtree */
+void Channel::set_first_gap(int entry, double prev_unlock)
+{
+	if(left[entry] >= 0)
+		set_first_gap(left[entry], prev_unlock);
+	else
+		prev_unlock_time[entry] = prev_unlock;
+	update(entry);
+	return;
+}
+
+/* return every entry of a subtree to the free list */
+void Channel::release(int entry)
+{
+	if(entry < 0)
+		return;
+	release(left[entry]);
+	release(right[entry]);
+	lock_time[entry] = unlock_time[entry] = BUS_CHANNEL_FREE_FLAG;
+	right[entry] = -1;
+	left[entry] = free_entry;
+	free_entry = entry;
+	table_entries--;
+	return;
+}
+
+/* the reservation treap and its free list, see Ssd::save_snapshot */
+void Channel::save(Snapshot &snapshot) const
+{
+	int tree[3] = {root, free_entry, full_warned};
+	snapshot.write_array(lock_time, table_size);
+	snapshot.write_array(unlock_time, table_size);
+	snapshot.write_array(prev_unlock_time, table_size);
+	snapshot.write_array(max_gap_time, table_size);
+	snapshot.write_array(left, table_size);
+	snapshot.write_array(right, table_size);
+	snapshot.write_array(priority, table_size);
+	snapshot.write_array(tree, 3);
+	snapshot.write(&table_entries, sizeof(table_entries));
+	return;
+}
+
+void Channel::load(Snapshot &snapshot)
+{
+	int tree[3];
+	snapshot.read_array(lock_time, table_size);
+	snapshot.read_array(unlock_time, table_size);
+	snapshot.read_array(prev_unlock_time, table_size);
+	snapshot.read_array(max_gap_time, table_size);
+	snapshot.read_array(left, table_size);
+	snapshot.read_array(right, table_size);
+	snapshot.read_array(priority, table_size);
+	snapshot.read_array(tree, 3);
+	snapshot.read(&table_entries, sizeof(table_entries));
+	root = tree[0];
+	free_entry = tree[1];
+	full_warned = tree[2] != 0;
 	return;
 }
@@ -113,7 +113,84 @@ double PAGE_WRITE_DELAY = 0.00001;
 /* Overprovisioning allowed */
 float OVERPROVISIONING = 5;
 
-/* Selected garbage collection policy; default = RANDOM */
+/* Consistency checker:
+ * 	1 to track every read, write and erase so Ssd::is_valid can verify FTL
+ * 		mappings and erase ordering
+ * 	0 to skip all tracking for throughput runs */
+unsigned int CONSISTENCY_CHECK = 1;
+
+/* Ssd class:
+ * 	max number of requests from Ssd::submit serviced at once
+ * 	later requests wait in arrival order for a completion */
+unsigned int QUEUE_DEPTH = 1;
+
+/* Background garbage collection for requests from Ssd::submit:
+ * 	1 to free log blocks ahead of the writes that need them, 0 to only clean
+ * 		inline on the write that finds its log block full
+ * 	free log blocks below which a cleaning step follows each request
+ * 	free log blocks restored by cleaning steps while the device is idle */
+unsigned int BACKGROUND_GC = 0;
+unsigned int GC_LOW_WATERMARK = 1;
+unsigned int GC_HIGH_WATERMARK = 4;
+
+/* FTL mapping scheme:
+ * 	0 to map logical blocks to data blocks with log blocks, 1 to map logical
+ * 		pages to any physical page (DFTL), 2 to share the log blocks among
+ * 		all data blocks (FAST)
+ * 	page mapping entries cached in RAM, 0 to keep the whole page map in RAM
+ * 	page mapping entries in each translation page on flash */
+unsigned int FTL_MODE = 0;
+unsigned int MAP_CACHE_SIZE = 0;
+unsigned int MAP_ENTRIES_PER_PAGE = 512;
+
+/* Write-back buffer in RAM for the Controller:
+ * 	logical pages it holds, 0 to pass every request to the FTL
+ * 	0 to evict the least recently used page, 1 for clean-first LRU (CFLRU)
+ * 	least recently used pages searched for a clean victim by CFLRU */
+unsigned int WRITE_BUFFER_SIZE = 0;
+unsigned int WRITE_BUFFER_POLICY = 0;
+unsigned int WRITE_BUFFER_WINDOW = 16;
+
+/* Hot/cold separation of logical blocks:
+ * 	host page writes after which the update count of a logical block is
+ * 		halved, 0 to ignore update frequency; block mapping mode puts
+ * 		the log blocks of hot logical blocks on the least worn free
+ * 		blocks and merges cold ones onto the most worn, page mapping
+ * 		mode writes hot and cold pages to separate frontier blocks
+ * 	decayed update count from which a logical block is hot */
+unsigned int HEAT_HALF_LIFE = 0;
+unsigned int HOT_THRESHOLD = 8;
+
+/* Parallelism:
+ * 	1 to stripe the FTL's physical blocks across packages, then dies, then
+ * 		planes, and place log blocks on another die than their data block,
+ * 		0 to number them package by package
+ * 	1 to run reads or programs on sibling planes of a die as one multi-plane
+ * 		operation, 0 to run one operation at a time on each die
+ * 	worker threads that run the flash operations of independent events,
+ * 		such as the copies and erases of a cleaning step, with each package
+ * 		on one of them; 0 runs every operation on the simulating thread.
+ * 		Results are the same for any number of threads */
+unsigned int BLOCK_STRIPING = 0;
+unsigned int MULTI_PLANE = 0;
+unsigned int PACKAGE_THREADS = 0;
+
+/* Instrumentation:
+ * 	FTL log file detail: 0 for nothing, 1 for garbage collection steps and
+ * 		failures, 2 for every request, 3 to also print the FTL tables after
+ * 		every request
+ * 	flash operations kept in the trace ring of the Ssd for Ssd::dump_trace,
+ * 		0 to keep none
+ * 	length of the time windows that Ssd::print_report gives latency
+ * 		percentiles for, 0 for one window over the whole run */
+unsigned int LOG_LEVEL = 0;
+unsigned int TRACE_RING_SIZE = 0;
+double REPORT_WINDOW = 0.0;
+
+/* Selected garbage collection policy: 0 FIFO, 1 LRU, 2 GREEDY, 3 COST_BENEFIT
+ * 	the block mapped FTL cleans the victim it chooses whenever a log block is
+ * 	needed and none is free, in the background and for
+ * 	Garbage_collector::collect; the other FTL modes ignore it */
 int SELECTED_GC_POLICY = 0;
 
 /* Log file path name */
@@ -160,6 +237,44 @@ void load_entry(char *name, double value, unsigned int line_number)
     OVERPROVISIONING = value;
   else if(!strcmp(name, "SELECTED_GC_POLICY"))
     SELECTED_GC_POLICY = value;
+  else if(!strcmp(name, "CONSISTENCY_CHECK"))
+    CONSISTENCY_CHECK = (unsigned int) value;
+  else if(!strcmp(name, "QUEUE_DEPTH"))
+    QUEUE_DEPTH = (unsigned int) value;
+  else if(!strcmp(name, "BACKGROUND_GC"))
+    BACKGROUND_GC = (unsigned int) value;
+  else if(!strcmp(name, "GC_LOW_WATERMARK"))
+    GC_LOW_WATERMARK = (unsigned int) value;
+  else if(!strcmp(name, "GC_HIGH_WATERMARK"))
+    GC_HIGH_WATERMARK = (unsigned int) value;
+  else if(!strcmp(name, "FTL_MODE"))
+    FTL_MODE = (unsigned int) value;
+  else if(!strcmp(name, "MAP_CACHE_SIZE"))
+    MAP_CACHE_SIZE = (unsigned int) value;
+  else if(!strcmp(name, "MAP_ENTRIES_PER_PAGE"))
+    MAP_ENTRIES_PER_PAGE = (unsigned int) value;
+  else if(!strcmp(name, "WRITE_BUFFER_SIZE"))
+    WRITE_BUFFER_SIZE = (unsigned int) value;
+  else if(!strcmp(name, "WRITE_BUFFER_POLICY"))
+    WRITE_BUFFER_POLICY = (unsigned int) value;
+  else if(!strcmp(name, "WRITE_BUFFER_WINDOW"))
+    WRITE_BUFFER_WINDOW = (unsigned int) value;
+  else if(!strcmp(name, "HEAT_HALF_LIFE"))
+    HEAT_HALF_LIFE = (unsigned int) value;
+  else if(!strcmp(name, "HOT_THRESHOLD"))
+    HOT_THRESHOLD = (unsigned int) value;
+  else if(!strcmp(name, "BLOCK_STRIPING"))
+    BLOCK_STRIPING = (unsigned int) value;
+  else if(!strcmp(name, "MULTI_PLANE"))
+    MULTI_PLANE = (unsigned int) value;
+  else if(!strcmp(name, "PACKAGE_THREADS"))
+    PACKAGE_THREADS = (unsigned int) value;
+  else if(!strcmp(name, "LOG_LEVEL"))
+    LOG_LEVEL = (unsigned int) value;
+  else if(!strcmp(name, "TRACE_RING_SIZE"))
+    TRACE_RING_SIZE = (unsigned int) value;
+  else if(!strcmp(name, "REPORT_WINDOW"))
+    REPORT_WINDOW = value;
   else
 		fprintf(stderr, "Config file parsing error on line %u\n", line_number);
 	return;
@@ -228,6 +343,25 @@ void print_config(FILE *stream)
 	fprintf(stream, "PAGE_WRITE_DELAY: %.16lf\n", PAGE_WRITE_DELAY);
   fprintf(stream, "OVERPROVISIONING: %f\n", OVERPROVISIONING);
   fprintf(stream, "SELECTED_GC_POLICY: %d\n", SELECTED_GC_POLICY);
+  fprintf(stream, "CONSISTENCY_CHECK: %u\n", CONSISTENCY_CHECK);
+  fprintf(stream, "QUEUE_DEPTH: %u\n", QUEUE_DEPTH);
+  fprintf(stream, "BACKGROUND_GC: %u\n", BACKGROUND_GC);
+  fprintf(stream, "GC_LOW_WATERMARK: %u\n", GC_LOW_WATERMARK);
+  fprintf(stream, "GC_HIGH_WATERMARK: %u\n", GC_HIGH_WATERMARK);
+  fprintf(stream, "FTL_MODE: %u\n", FTL_MODE);
+  fprintf(stream, "MAP_CACHE_SIZE: %u\n", MAP_CACHE_SIZE);
+  fprintf(stream, "MAP_ENTRIES_PER_PAGE: %u\n", MAP_ENTRIES_PER_PAGE);
+  fprintf(stream, "WRITE_BUFFER_SIZE: %u\n", WRITE_BUFFER_SIZE);
+  fprintf(stream, "WRITE_BUFFER_POLICY: %u\n", WRITE_BUFFER_POLICY);
+  fprintf(stream, "WRITE_BUFFER_WINDOW: %u\n", WRITE_BUFFER_WINDOW);
+  fprintf(stream, "HEAT_HALF_LIFE: %u\n", HEAT_HALF_LIFE);
+  fprintf(stream, "HOT_THRESHOLD: %u\n", HOT_THRESHOLD);
+  fprintf(stream, "BLOCK_STRIPING: %u\n", BLOCK_STRIPING);
+  fprintf(stream, "MULTI_PLANE: %u\n", MULTI_PLANE);
+  fprintf(stream, "PACKAGE_THREADS: %u\n", PACKAGE_THREADS);
+  fprintf(stream, "LOG_LEVEL: %u\n", LOG_LEVEL);
+  fprintf(stream, "TRACE_RING_SIZE: %u\n", TRACE_RING_SIZE);
+  fprintf(stream, "REPORT_WINDOW: %.16lf\n", REPORT_WINDOW);
   fprintf(stream, "------------------------------------------------------------\n");
 	return;
 }
@@ -41,77 +41,270 @@ using namespace ssd;
 Controller::Controller(Ssd &parent, FILE *log_file):
   log_file(log_file),
   ssd(parent),
-	ftl(*this, log_file)
+	ftl(*this, log_file),
+	dispatcher(*this, parent.get_geometry())
 {
 	return;
 }
 
 Controller::~Controller(void)
 {
+	ftl.exit_ftl_user();
 	return;
 }
 
 enum status Controller::event_arrive(Event &event)
 {
+	if(WRITE_BUFFER_SIZE > 0 && (event.get_event_type() == READ || event.get_event_type() == WRITE))
+		return buffer_arrive(event);
 	if(event.get_event_type() == READ)
 		return ftl.read(event);
 	else if(event.get_event_type() == WRITE)
 		return ftl.write(event);
+	else if(event.get_event_type() == TRIM)
+		return trim(event);
 	else
 		fprintf(stderr, "Controller: %s: Invalid event type\n", __func__);
 	return FAILURE;
 }
 
-enum status Controller::issue(Event &event_list)
+/* drop the trimmed pages from the write buffer, dirty or not, so they are
+ * 	never flushed, then let the FTL forget them
+ * the SSD stops tracking the pages first, since the FTL may erase the blocks
+ * 	that were left without live data right away */
+enum status Controller::trim(Event &event)
+{
+	unsigned int i;
+	if(WRITE_BUFFER_SIZE > 0)
+	{
+		for(i = 0; i < event.get_size(); i++)
+			ssd.ram.buffer_remove(event.get_logical_address() + i);
+	}
+	ssd.trim(event);
+	return ftl.trim(event);
+}
+
+/* serve a single-page request through the write-back buffer in RAM
+ * a read hit or a write is served by the RAM; a write only waits for the
+ * 	flash when its page has to be made room for
+ * a read miss goes to the FTL after room is made and then stays buffered as
+ * 	a clean page */
+enum status Controller::buffer_arrive(Event &event)
+{
+	unsigned long logical_address = event.get_logical_address();
+	if(event.get_event_type() == READ)
+	{
+		if(ssd.ram.buffer_lookup(logical_address, false))
+			return ssd.ram.read(event);
+		/* room is made first, since the flush may start garbage collection
+		 * 	that moves the page to be read */
+		bool room = (make_buffer_room(event, false) == SUCCESS);
+		if(ftl.read(event) == FAILURE)
+			return FAILURE;
+		if(room)
+			ssd.ram.buffer_insert(logical_address, false);
+		return SUCCESS;
+	}
+	if(!ssd.ram.buffer_lookup(logical_address, true))
+	{
+		if(make_buffer_room(event, true) == FAILURE)
+			return FAILURE;
+		ssd.ram.buffer_insert(logical_address, true);
+	}
+	return ssd.ram.write(event);
+}
+
+/* evict a page if the buffer is full
+ * a dirty victim is flushed together with every other dirty page of its
+ * 	logical block in page order, so the FTL writes them to flash as one batch
+ * 	starting when the event finishes so far; the flushed pages stay buffered
+ * 	as clean pages
+ * with wait the event finishes no earlier than the flush */
+enum status Controller::make_buffer_room(Event &event, bool wait)
+{
+	if(!ssd.ram.buffer_full())
+		return SUCCESS;
+	unsigned long victim = ssd.ram.buffer_victim();
+	if(ssd.ram.buffer_dirty(victim))
+	{
+		std::vector<unsigned long> pages;
+		unsigned int i;
+		double start = event.get_finish_time();
+		double finish = start;
+		enum status status = SUCCESS;
+
+		ssd.ram.buffer_dirty_pages(victim - victim % ssd.geometry.get_block_size(), ssd.geometry.get_block_size(), pages);
+		for(i = 0; i < pages.size(); i++)
+		{
+			Event *flush = new_event(WRITE, pages[i], 1, start);
+			if(ftl.write(*flush) == SUCCESS)
+				ssd.ram.buffer_clean(pages[i]);
+			else
+			{
+				fprintf(log_file, "Controller: %s: flush of logical page %lu failed\n", __func__, pages[i]);
+				status = FAILURE;
+			}
+			if(flush -> get_finish_time() > finish)
+				finish = flush -> get_finish_time();
+			free_events(*flush);
+		}
+		ssd.ram.buffer_flushed();
+		if(wait && finish > event.get_finish_time())
+			(void) event.incr_time_taken(finish - event.get_finish_time());
+		if(status == FAILURE && ssd.ram.buffer_dirty(victim))
+			return FAILURE;
+	}
+	ssd.ram.buffer_remove(victim);
+	return SUCCESS;
+}
+
+enum status Controller::issue(Event &event_list, bool stop_on_failure)
 {
 	Event *cur;
+	enum status status = SUCCESS;
+
+	/* independent events on the packages of more than one worker thread run
+	 * 	their flash operations in parallel */
+	if(!stop_on_failure && dispatcher.spans_workers(event_list))
+		return dispatch(event_list);
 
 	/* go through event list and issue each to the hardware
 	 * stop processing events and return failure status if any event in the 
-	 *    list fails */
+	 *    list fails, unless the events are independent like GC copies that 
+	 *    were previously issued one at a time */
 	for(cur = &event_list; cur != NULL; cur = cur -> get_next()){
-		if(cur -> get_size() != 1){
-			fprintf(stderr, "Controller: %s: Received non-single-page-sized event from FTL.\n", __func__);
-			return FAILURE;
-		}
-		else if(cur -> get_event_type() == READ)
-		{
-			assert(cur -> get_address().valid > NONE);
-			if(ssd.read(*cur) == FAILURE
-				|| ssd.ram.write(*cur) == FAILURE
-				|| ssd.ram.read(*cur) == FAILURE)
-				return FAILURE;
-		}
-		else if(cur -> get_event_type() == WRITE)
-		{
-			assert(cur -> get_address().valid > NONE);
-			if(ssd.ram.write(*cur) == FAILURE
-				|| ssd.ram.read(*cur) == FAILURE
-				|| ssd.write(*cur) == FAILURE)
-				return FAILURE;
-		}
-		else if(cur -> get_event_type() == ERASE)
+		enum status event_status = issue_event(*cur);
+		ssd.record_trace(*cur, event_status);
+		if(event_status == FAILURE)
 		{
-			assert(cur -> get_address().valid > NONE);
-			if(ssd.erase(*cur) == FAILURE)
-				return FAILURE;
-		}
-		else if(cur -> get_event_type() == MERGE)
-		{
-			assert(cur -> get_address().valid > NONE);
-			assert(cur -> get_merge_address().valid > NONE);
-			if(ssd.merge(*cur) == FAILURE)
+			if(stop_on_failure)
 				return FAILURE;
+			status = FAILURE;
 		}
+	}
+	return status;
+}
+
+/* issue an independent event list through the dispatcher
+ * every event is checked in list order on this thread, then its flash
+ * 	operations are posted to the worker of its package; once all are done
+ * 	the events are traced in list order, so the trace, the checker and the
+ * 	hardware end up as if the list was issued one event at a time */
+enum status Controller::dispatch(Event &event_list)
+{
+	Event *cur;
+	unsigned int i = 0;
+	enum status status = SUCCESS;
+
+	for(cur = &event_list; cur != NULL; cur = cur -> get_next())
+		i++;
+	statuses.resize(i);
+	for(cur = &event_list, i = 0; cur != NULL; cur = cur -> get_next(), i++)
+	{
+		if(prepare_event(*cur) == SUCCESS)
+			dispatcher.post(*cur, &statuses[i]);
 		else
-		{
-			fprintf(stderr, "Controller: %s: Invalid event type\n", __func__);
+			statuses[i] = FAILURE;
+	}
+	dispatcher.wait();
+	for(cur = &event_list, i = 0; cur != NULL; cur = cur -> get_next(), i++)
+	{
+		ssd.record_trace(*cur, statuses[i]);
+		if(statuses[i] == FAILURE)
+			status = FAILURE;
+	}
+	return status;
+}
+
+enum status Controller::issue_event(Event &event)
+{
+	if(prepare_event(event) == FAILURE)
+		return FAILURE;
+	return execute_event(event);
+}
+
+/* check an event from the FTL and record it with the SSD's consistency
+ * 	checker, see Ssd::prepare */
+enum status Controller::prepare_event(Event &event)
+{
+	if(event.get_size() != 1){
+		fprintf(stderr, "Controller: %s: Received non-single-page-sized event from FTL.\n", __func__);
+		return FAILURE;
+	}
+	else if(event.get_event_type() != READ && event.get_event_type() != WRITE && event.get_event_type() != ERASE && event.get_event_type() != MERGE)
+	{
+		fprintf(stderr, "Controller: %s: Invalid event type\n", __func__);
+		return FAILURE;
+	}
+	assert(event.get_address().valid > NONE);
+	assert(event.get_event_type() != MERGE || event.get_merge_address().valid > NONE);
+	return ssd.prepare(event);
+}
+
+/* run the flash operations of a prepared event, buffering the page in RAM
+ * 	on its way to or from the flash
+ * only the event's package is touched, see Dispatcher */
+enum status Controller::execute_event(Event &event)
+{
+	if(event.get_event_type() == READ)
+	{
+		if(ssd.read(event) == FAILURE
+			|| ssd.ram.write(event) == FAILURE
+			|| ssd.ram.read(event) == FAILURE)
+			return FAILURE;
+	}
+	else if(event.get_event_type() == WRITE)
+	{
+		if(ssd.ram.write(event) == FAILURE
+			|| ssd.ram.read(event) == FAILURE
+			|| ssd.write(event) == FAILURE)
+			return FAILURE;
+	}
+	else if(event.get_event_type() == ERASE)
+	{
+		if(ssd.erase(event) == FAILURE)
 			return FAILURE;
-		}
 	}
+	else if(ssd.merge(event) == FAILURE)
+		return FAILURE;
 	return SUCCESS;
 }
 
+enum status Controller::background_collect(double time, bool idle, double *finish_time)
+{
+	return ftl.background_collect(time, idle, finish_time);
+}
+
+/* Events from the ssd's pool for the FTL to build event lists with
+ * return the whole list with free_events once it has been issued */
+Event *Controller::new_event(enum event_type type, unsigned long logical_address, unsigned int size, double start_time)
+{
+	return ssd.events.alloc(type, logical_address, size, start_time);
+}
+
+void Controller::free_events(Event &event_list)
+{
+	ssd.events.free(event_list);
+	return;
+}
+
+/* the FTL for drivers that exercise it directly, such as the benchmarks */
+/* geometry of the ssd for the FTL to size its tables with */
+const Geometry &Controller::get_geometry(void) const
+{
+	return ssd.get_geometry();
+}
+
+Ftl &Controller::get_ftl(void)
+{
+	return ftl;
+}
+
+const struct ftl_stats &Controller::get_ftl_stats(void) const
+{
+	return ftl.get_stats();
+}
+
 unsigned long Controller::get_erases_remaining(const Address &address) const
 {
 	assert(address.valid > NONE);
@@ -30,7 +30,7 @@
 
 using namespace ssd;
 
-Die::Die(const Package &parent, Channel &channel, unsigned int die_size):
+Die::Die(const Package &parent, Channel &channel, Flash_store &store, unsigned long first_block, unsigned int die_size):
 	size(die_size),
 
 	/* use a const pointer (Plane * const data) to use as an array
@@ -38,17 +38,10 @@ Die::Die(const Package &parent, Channel &channel, unsigned int die_size):
 	data((Plane *) malloc(size * sizeof(Plane))),
 	parent(parent),
 	channel(channel),
-
-	/* assume all Planes are same so first one can start as least worn */
-	least_worn(0),
-
-	/* set erases remaining to BLOCK_ERASES to match Block constructor args 
-	 * in Plane class
-	 * this is the cheap implementation but can change to pass through classes */
-	erases_remaining(BLOCK_ERASES),
-
-	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0)
+	busy_until(0.0),
+	group_type(ERASE),
+	group_start(0.0),
+	group_planes(0)
 {
 	unsigned int i;
 
@@ -67,7 +60,7 @@ Die::Die(const Package &parent, Channel &channel, unsigned int die_size):
 		exit(MEM_ERR);
 	}
 	for(i = 0; i < size; i++)
-		(void) new (&data[i]) Plane(*this, PLANE_SIZE, PLANE_REG_READ_DELAY, PLANE_REG_WRITE_DELAY);
+		(void) new (&data[i]) Plane(*this, store, first_block + (unsigned long) i * store.get_geometry().get_plane_size(), store.get_geometry().get_plane_size(), PLANE_REG_READ_DELAY, PLANE_REG_WRITE_DELAY);
 
 	return;
 }
@@ -85,37 +78,93 @@ Die::~Die(void)
 	return;
 }
 
+/* the die runs one operation at a time on its planes
+ * delay the event until the operations already scheduled on the die finish */
+void Die::wait_idle(Event &event) const
+{
+	if(busy_until > event.get_finish_time())
+		(void) event.incr_time_taken(busy_until - event.get_finish_time());
+	return;
+}
+
+/* start the array operation of an event once the die is idle
+ * with MULTI_PLANE a read or program on a plane not yet taking part in the
+ * 	read or program running on the die joins it instead of waiting, if its
+ * 	command is ready before the die becomes idle, so the planes share one
+ * 	array delay
+ * the pages of a multi-plane operation may have any block and page offsets in
+ * 	their planes */
+void Die::schedule(Event &event)
+{
+	enum event_type type = event.get_event_type();
+	unsigned long plane_bit = (event.get_address().plane < sizeof(group_planes) * 8) ? 1UL << event.get_address().plane : 0;
+	if(MULTI_PLANE && (type == READ || type == WRITE) && type == group_type
+		&& plane_bit != 0 && (group_planes & plane_bit) == 0
+		&& event.get_finish_time() <= busy_until)
+	{
+		if(group_start > event.get_finish_time())
+			(void) event.incr_time_taken(group_start - event.get_finish_time());
+		group_planes |= plane_bit;
+		return;
+	}
+	wait_idle(event);
+	group_type = type;
+	group_start = event.get_finish_time();
+	group_planes = plane_bit;
+	return;
+}
+
+/* send the read command over the channel, read the page into the plane
+ * 	register once the die is idle, then send the data back over the channel
+ * the die stays busy until its register is emptied */
 enum status Die::read(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
-	return data[event.get_address().plane].read(event);
+	(void) channel.lock(event.get_finish_time(), BUS_CTRL_DELAY, event);
+	schedule(event);
+	enum status status = data[event.get_address().plane].read(event);
+	if(status == SUCCESS)
+		(void) channel.lock(event.get_finish_time(), BUS_DATA_DELAY, event);
+	if(event.get_finish_time() > busy_until)
+		busy_until = event.get_finish_time();
+	return status;
 }
 
+/* send the command and data over the channel, then program the page once the
+ * 	die is idle */
 enum status Die::write(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
-	return data[event.get_address().plane].write(event);
+	(void) channel.lock(event.get_finish_time(), BUS_CTRL_DELAY + BUS_DATA_DELAY, event);
+	schedule(event);
+	enum status status = data[event.get_address().plane].write(event);
+	if(event.get_finish_time() > busy_until)
+		busy_until = event.get_finish_time();
+	return status;
 }
 
-/* if no errors
- * 	updates last_erase_time if later time
- * 	updates erases_remaining if smaller value
+/* send the erase command over the channel, then erase once the die is idle
+ * wear statistics are updated by the flash store
  * returns 1 for success, 0 for failure */
 enum status Die::erase(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE);
+	(void) channel.lock(event.get_finish_time(), BUS_CTRL_DELAY, event);
+	schedule(event);
 	enum status status = data[event.get_address().plane].erase(event);
-
-	/* update values if no errors */
-	if(status == SUCCESS)
-		update_wear_stats(event.get_address());
+	if(event.get_finish_time() > busy_until)
+		busy_until = event.get_finish_time();
 	return status;
 }
 
-/* TODO: move Plane::_merge() to Die and make generic to handle merge across
+/* send the merge command over the channel, then move the pages inside the
+ * 	plane once the die is idle
+ * a merge of single pages is a copyback, a merge of whole blocks moves every
+ * 	valid page of the block
+ * TODO: move Plane::_merge() to Die and make generic to handle merge across
  * 	both cases: 2 separate planes or within 1 plane */
 enum status Die::merge(Event &event)
 {
@@ -123,17 +172,28 @@ enum status Die::merge(Event &event)
 	assert(event.get_address().plane < size && event.get_address().valid > DIE && event.get_merge_address().plane < size && event.get_merge_address().valid > DIE);
 	if(event.get_address().plane != event.get_merge_address().plane)
 		return _merge(event);
-	else return data[event.get_address().plane]._merge(event);
+	(void) channel.lock(event.get_finish_time(), BUS_CTRL_DELAY, event);
+	schedule(event);
+	enum status status;
+	if(event.get_address().valid == PAGE && event.get_merge_address().valid == PAGE)
+		status = data[event.get_address().plane].copyback(event);
+	else
+		status = data[event.get_address().plane]._merge(event);
+	if(event.get_finish_time() > busy_until)
+		busy_until = event.get_finish_time();
+	return status;
 }
 
 /* TODO: update stub as per Die::merge() comment above
- * to support Die-level merge operations */
+ * to support Die-level merge operations
+ * the data would have to cross the planes, so fail rather than lose it */
 enum status Die::_merge(Event &event)
 {
 	assert(data != NULL);
 	assert(event.get_address().plane < size && event.get_address().valid > DIE && event.get_merge_address().plane < size && event.get_merge_address().valid > DIE);
 	assert(event.get_address().plane != event.get_merge_address().plane);
-	return SUCCESS;
+	fprintf(stderr, "Die error: %s: merge across planes %u and %u is not supported\n", __func__, event.get_address().plane, event.get_merge_address().plane);
+	return FAILURE;
 }
 
 const Package &Die::get_parent(void) const
@@ -141,48 +201,46 @@ const Package &Die::get_parent(void) const
 	return parent;
 }
 
-/* if given a valid Block address, call the Block's method
- * else return local value */
+/* if given a valid Plane address, call the Plane's method
+ * else return the time of the latest erase in the die */
 double Die::get_last_erase_time(const Address &address) const
 {
 	assert(data != NULL);
+	unsigned int i;
+	double latest = 0.0;
 	if(address.valid > DIE && address.plane < size)
 		return data[address.plane].get_last_erase_time(address);
-	else
-		return last_erase_time;
+	for(i = 0; i < size; i++)
+		if(data[i].get_last_erase_time(address) > latest)
+			latest = data[i].get_last_erase_time(address);
+	return latest;
 }
 
 /* if given a valid Plane address, call the Plane's method
- * else return local value */
+ * else return the erases remaining of the least worn plane */
 unsigned long Die::get_erases_remaining(const Address &address) const
 {
 	assert(data != NULL);
+	unsigned int i;
+	unsigned long max = 0;
 	if(address.valid > DIE && address.plane < size)
 		return data[address.plane].get_erases_remaining(address);
-	else
-		return erases_remaining;
+	for(i = 0; i < size; i++)
+		if(data[i].get_erases_remaining(address) > max)
+			max = data[i].get_erases_remaining(address);
+	return max;
 }
 
-/* Plane with the most erases remaining is the least worn */
-void Die::update_wear_stats(const Address &address)
+/* update given address -> plane to least worn plane
+ * Plane with the most erases remaining is the least worn */
+void Die::get_least_worn(Address &address) const
 {
 	assert(data != NULL);
 	unsigned int i;
-	unsigned int max_index = 0;
-	unsigned long max = data[0].get_erases_remaining(address);
+	unsigned int least_worn = 0;
 	for(i = 1; i < size; i++)
-		if(data[i].get_erases_remaining(address) > max)
-			max_index = i;
-	least_worn = max_index;
-	erases_remaining = max;
-	last_erase_time = data[max_index].get_last_erase_time(address);
-	return;
-}
-
-/* update given address -> die to least worn die */
-void Die::get_least_worn(Address &address) const
-{
-	assert(data != NULL && least_worn < size);
+		if(data[i].get_wear_summary().min_erases < data[least_worn].get_wear_summary().min_erases)
+			least_worn = i;
 	address.plane = least_worn;
 	address.valid = PLANE;
 	data[least_worn].get_least_worn(address);
@@ -213,3 +271,32 @@ unsigned int Die::get_num_valid(const Address &address) const
 	assert(address.valid >= PLANE);
 	return data[address.plane].get_num_valid(address);
 }   
+
+/* the die timeline and the state of the planes, see Ssd::save_snapshot */
+void Die::save(Snapshot &snapshot) const
+{
+	unsigned int i;
+	double times[2] = {busy_until, group_start};
+	unsigned long group[2] = {(unsigned long) group_type, group_planes};
+	snapshot.write_array(times, 2);
+	snapshot.write_array(group, 2);
+	for(i = 0; i < size; i++)
+		data[i].save(snapshot);
+	return;
+}
+
+void Die::load(Snapshot &snapshot)
+{
+	unsigned int i;
+	double times[2];
+	unsigned long group[2];
+	snapshot.read_array(times, 2);
+	snapshot.read_array(group, 2);
+	busy_until = times[0];
+	group_start = times[1];
+	group_type = (enum event_type) group[0];
+	group_planes = group[1];
+	for(i = 0; i < size; i++)
+		data[i].load(snapshot);
+	return;
+}
@@ -0,0 +1,172 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_dispatcher.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Dispatcher class
+ *
+ * The dispatcher runs the flash operations of independent event lists on
+ * PACKAGE_THREADS worker threads, each owning the packages i with
+ * i % threads equal to its number.  The controller is the only producer of
+ * each worker's ring and the worker the only consumer, so the rings need no
+ * locks.  A worker that finds its ring empty yields for DISPATCH_SPINS tries
+ * and then sleeps until the controller posts again, so idle workers do not
+ * take processor time from the FTL.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* jobs in the ring of each worker, a power of 2 */
+#define DISPATCH_RING_SIZE 1024
+
+/* yields of a worker with an empty ring before it sleeps */
+#define DISPATCH_SPINS 256
+
+Dispatcher::Dispatcher(Controller &controller, const Geometry &geometry, unsigned int threads):
+	controller(controller),
+	threads((threads < geometry.get_ssd_size()) ? threads : geometry.get_ssd_size()),
+	stopping(false)
+{
+	unsigned int i;
+
+	/* neighbouring packages must not share bytes of the page states */
+	if(this -> threads > 0 && !Flash_store::packages_disjoint(geometry))
+	{
+		fprintf(stderr, "Dispatcher warning: %s: pages per package is not a multiple of the page states per byte, running on one thread\n", __func__);
+		this -> threads = 0;
+	}
+	for(i = 0; i < this -> threads; i++)
+	{
+		struct worker *worker = new struct worker;
+		worker -> ring = new struct job[DISPATCH_RING_SIZE];
+		worker -> head = 0;
+		worker -> tail = 0;
+		worker -> sleeping = false;
+		workers.push_back(worker);
+	}
+	for(i = 0; i < this -> threads; i++)
+		workers[i] -> thread = std::thread(&Dispatcher::work, this, std::ref(*workers[i]));
+	return;
+}
+
+Dispatcher::~Dispatcher(void)
+{
+	unsigned int i;
+
+	stopping = true;
+	for(i = 0; i < workers.size(); i++)
+	{
+		{
+			std::lock_guard<std::mutex> guard(workers[i] -> lock);
+			workers[i] -> wake.notify_one();
+		}
+		workers[i] -> thread.join();
+		delete[] workers[i] -> ring;
+		delete workers[i];
+	}
+	return;
+}
+
+/* true if the events of the list are on the packages of two or more workers
+ * 	and worth posting, otherwise the list is issued on the caller's thread */
+bool Dispatcher::spans_workers(const Event &event_list) const
+{
+	const Event *cur;
+
+	if(threads < 2)
+		return false;
+	unsigned int first = event_list.get_address().package % threads;
+	for(cur = event_list.get_next(); cur != NULL; cur = cur -> get_next())
+		if(cur -> get_address().package % threads != first)
+			return true;
+	return false;
+}
+
+/* give the flash operations of a prepared event to the worker of its package
+ * the worker leaves their status at status; neither may be looked at before
+ * 	Dispatcher::wait returns */
+void Dispatcher::post(Event &event, enum status *status)
+{
+	assert(threads > 0 && status != NULL);
+	struct worker &worker = *workers[event.get_address().package % threads];
+	unsigned long head = worker.head.load(std::memory_order_relaxed);
+
+	/* wait for room if the worker is a whole ring behind */
+	while(head - worker.tail.load(std::memory_order_acquire) >= DISPATCH_RING_SIZE)
+		std::this_thread::yield();
+	worker.ring[head & (DISPATCH_RING_SIZE - 1)].event = &event;
+	worker.ring[head & (DISPATCH_RING_SIZE - 1)].status = status;
+
+	/* the store publishes the job and everything the FTL changed before it;
+	 * 	it is sequentially consistent with the load of sleeping so either
+	 * 	the worker sees the job or this thread sees it asleep */
+	worker.head.store(head + 1);
+	if(worker.sleeping.load())
+	{
+		std::lock_guard<std::mutex> guard(worker.lock);
+		worker.wake.notify_one();
+	}
+	return;
+}
+
+/* wait until every posted job is done
+ * the acquire loads make the workers' changes to the events and the
+ * 	hardware visible to the caller */
+void Dispatcher::wait(void)
+{
+	unsigned int i;
+
+	for(i = 0; i < workers.size(); i++)
+		while(workers[i] -> tail.load(std::memory_order_acquire) != workers[i] -> head.load(std::memory_order_relaxed))
+			std::this_thread::yield();
+	return;
+}
+
+/* run the jobs of a worker's ring in order until the dispatcher is destroyed */
+void Dispatcher::work(struct worker &worker)
+{
+	unsigned long tail = worker.tail.load(std::memory_order_relaxed);
+	unsigned int spins = 0;
+
+	for(;;)
+	{
+		if(worker.head.load(std::memory_order_acquire) != tail)
+		{
+			struct job &job = worker.ring[tail & (DISPATCH_RING_SIZE - 1)];
+			*job.status = controller.execute_event(*job.event);
+			worker.tail.store(++tail, std::memory_order_release);
+			spins = 0;
+		}
+		else if(stopping.load())
+			return;
+		else if(++spins < DISPATCH_SPINS)
+			std::this_thread::yield();
+		else
+		{
+			std::unique_lock<std::mutex> guard(worker.lock);
+			worker.sleeping = true;
+			while(worker.head.load() == tail && !stopping.load())
+				worker.wake.wait(guard);
+			worker.sleeping = false;
+			spins = 0;
+		}
+	}
+}
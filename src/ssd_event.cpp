@@ -25,6 +25,7 @@
  * SSD class creates an instance for each I/O request it receives.
  */
 
+#include <new>
 #include <assert.h>
 #include <stdio.h>
 #include "ssd.h"
@@ -67,6 +68,7 @@ void Event::consolidate_metaevent(Event &list)
 
 	/* find max time taken with respect to this event's start_time */
 	max = start_time - list.start_time + list.time_taken;
+	bus_wait_time += list.get_bus_wait_time();
 	for(cur = list.next; cur != NULL; cur = cur -> next)
 	{
 		tmp = start_time - cur -> start_time + cur -> time_taken;
@@ -117,6 +119,12 @@ double Event::get_time_taken(void) const
 	return time_taken;
 }
 
+/* time the event finishes with the time taken so far */
+double Event::get_finish_time(void) const
+{
+	return start_time + time_taken;
+}
+
 double Event::get_bus_wait_time(void) const
 {
 	assert(bus_wait_time >= 0.0);
@@ -170,6 +178,8 @@ void Event::print(FILE *stream)
 		fprintf(stream, "Erase");
 	else if(type == MERGE)
 		fprintf(stream, "Merge");
+	else if(type == TRIM)
+		fprintf(stream, "Trim ");
 	else
 		fprintf(stream, "Unknown event type: ");
 	address.print(stream);
@@ -179,6 +189,69 @@ void Event::print(FILE *stream)
 	return;
 }
 
+Event_pool::Event_pool(void):
+	free_list(NULL)
+{
+	return;
+}
+
+/* Events still in use when the pool is destroyed are freed with it */
+Event_pool::~Event_pool(void)
+{
+	unsigned int i;
+	for(i = 0; i < chunks.size(); i++)
+		::free(chunks[i]);
+	return;
+}
+
+/* take an Event from the free list and construct it in place */
+Event *Event_pool::alloc(enum event_type type, unsigned long logical_address, unsigned int size, double start_time)
+{
+	Event *event;
+	if(free_list == NULL)
+		grow();
+	event = free_list;
+	free_list = event -> next;
+	return new (event) Event(type, logical_address, size, start_time);
+}
+
+/* return every Event in the list to the free list */
+void Event_pool::free(Event &event_list)
+{
+	Event *cur = &event_list;
+	Event *next;
+	while(cur != NULL)
+	{
+		next = cur -> next;
+		cur -> ~Event();
+		cur -> next = free_list;
+		free_list = cur;
+		cur = next;
+	}
+	return;
+}
+
+/* new cannot initialize an array with constructor args so
+ * 	malloc the chunk
+ * 	then use placement new to construct each Event as it is allocated */
+void Event_pool::grow(void)
+{
+	unsigned int i;
+	Event *chunk = (Event *) malloc(EVENT_POOL_CHUNK * sizeof(Event));
+	if(chunk == NULL)
+	{
+		fprintf(stderr, "Event pool error: %s: unable to allocate Events\n", __func__);
+		exit(MEM_ERR);
+	}
+	chunks.push_back(chunk);
+	for(i = 0; i < EVENT_POOL_CHUNK; i++)
+	{
+		chunk[i].next = free_list;
+		free_list = &chunk[i];
+	}
+	return;
+}
+
 #if 0
 /* may be useful for further integration with DiskSim */
 
@@ -0,0 +1,285 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_flash_store.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Flash_store class
+ *
+ * The flash store is the backing storage for all page and block state in the
+ * SSD.  Page states take 2 bits each and the per-block counters are kept in
+ * parallel arrays, so the hardware classes can be views over the store
+ * instead of allocating an object for every page and block. */
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* page states are packed 4 to a byte */
+#define PAGE_STATE_BITS 2
+#define PAGE_STATES_PER_BYTE 4
+#define PAGE_STATE_MASK 3
+
+Flash_store::Flash_store(const Geometry &geometry, unsigned long block_erases, double page_read_delay, double page_write_delay, double erase_delay):
+	geometry(geometry),
+	num_blocks(geometry.get_physical_blocks()),
+	plane_size(geometry.get_plane_size()),
+	block_size(geometry.get_block_size()),
+	block_erases(block_erases),
+
+	/* use const pointers (unsigned int * const pages_valid) to use as arrays
+	 * but like a reference, we cannot reseat the pointers */
+	page_states(new unsigned char[(num_blocks * block_size + PAGE_STATES_PER_BYTE - 1) / PAGE_STATES_PER_BYTE]),
+	pages_valid(new unsigned int[num_blocks]),
+	pages_invalid(new unsigned int[num_blocks]),
+	block_states(new unsigned char[num_blocks]),
+	erases_remaining(new unsigned long[num_blocks]),
+	last_erase_time(new double[num_blocks]),
+	page_read_delay(page_read_delay),
+	page_write_delay(page_write_delay),
+	erase_delay(erase_delay),
+	plane_wear(new struct wear_summary[num_blocks / plane_size])
+{
+	unsigned long i;
+
+	if(page_read_delay < 0.0)
+	{
+		fprintf(stderr, "Flash store warning: %s: constructor received negative read delay value\n\tsetting read delay to 0.0\n", __func__);
+		this -> page_read_delay = 0.0;
+	}
+	if(page_write_delay < 0.0)
+	{
+		fprintf(stderr, "Flash store warning: %s: constructor received negative write delay value\n\tsetting write delay to 0.0\n", __func__);
+		this -> page_write_delay = 0.0;
+	}
+	if(erase_delay < 0.0)
+	{
+		fprintf(stderr, "Flash store warning: %s: constructor received negative erase delay value\n\tsetting erase delay to 0.0\n", __func__);
+		this -> erase_delay = 0.0;
+	}
+
+	/* arrays allocated in initializer list */
+	if(page_states == NULL || pages_valid == NULL || pages_invalid == NULL || block_states == NULL || erases_remaining == NULL || last_erase_time == NULL || plane_wear == NULL)
+	{
+		fprintf(stderr, "Flash store error: %s: constructor unable to allocate page and block state\n", __func__);
+		exit(MEM_ERR);
+	}
+
+	/* every page starts EMPTY, which is state 0 */
+	memset(page_states, 0, (num_blocks * block_size + PAGE_STATES_PER_BYTE - 1) / PAGE_STATES_PER_BYTE);
+
+	/* assume hardware created at time 0 and had an implied free erasure */
+	for(i = 0; i < num_blocks; i++)
+	{
+		pages_valid[i] = 0;
+		pages_invalid[i] = 0;
+		block_states[i] = FREE;
+		erases_remaining[i] = block_erases;
+		last_erase_time[i] = 0.0;
+	}
+	init_wear(device_wear, num_blocks);
+	for(i = 0; i < num_blocks / plane_size; i++)
+		init_wear(plane_wear[i], plane_size);
+	return;
+}
+
+Flash_store::~Flash_store(void)
+{
+	delete[] page_states;
+	delete[] pages_valid;
+	delete[] pages_invalid;
+	delete[] block_states;
+	delete[] erases_remaining;
+	delete[] last_erase_time;
+	delete[] plane_wear;
+	return;
+}
+
+const Geometry &Flash_store::get_geometry(void) const
+{
+	return geometry;
+}
+
+/* physical block number of a block address */
+unsigned long Flash_store::get_block_index(const Address &address) const
+{
+	assert(address.valid >= BLOCK);
+	return geometry.get_block_index(address);
+}
+
+/* physical page number of a page address */
+unsigned long Flash_store::get_page_index(const Address &address) const
+{
+	assert(address.valid >= PAGE && address.page < block_size);
+	return get_block_index(address) * block_size + address.page;
+}
+
+unsigned long Flash_store::get_num_blocks(void) const
+{
+	return num_blocks;
+}
+
+unsigned int Flash_store::get_block_size(void) const
+{
+	return block_size;
+}
+
+unsigned long Flash_store::get_erases_remaining(unsigned long block) const
+{
+	assert(block < num_blocks);
+	return erases_remaining[block];
+}
+
+double Flash_store::get_last_erase_time(unsigned long block) const
+{
+	assert(block < num_blocks);
+	return last_erase_time[block];
+}
+
+const struct wear_summary &Flash_store::get_wear_summary(void) const
+{
+	return device_wear;
+}
+
+/* planes are numbered like blocks, see Geometry::get_plane_index */
+const struct wear_summary &Flash_store::get_wear_summary(unsigned long plane) const
+{
+	assert(plane < num_blocks / plane_size);
+	return plane_wear[plane];
+}
+
+enum page_state Flash_store::get_page_state(unsigned long page) const
+{
+	assert(page < num_blocks * block_size);
+	return (enum page_state) ((page_states[page / PAGE_STATES_PER_BYTE] >> ((page % PAGE_STATES_PER_BYTE) * PAGE_STATE_BITS)) & PAGE_STATE_MASK);
+}
+
+void Flash_store::set_page_state(unsigned long page, enum page_state state)
+{
+	assert(page < num_blocks * block_size);
+	unsigned int shift = (page % PAGE_STATES_PER_BYTE) * PAGE_STATE_BITS;
+	unsigned char &byte = page_states[page / PAGE_STATES_PER_BYTE];
+	byte = (byte & ~(PAGE_STATE_MASK << shift)) | ((unsigned char) state << shift);
+	return;
+}
+
+/* true if no byte of the packed page states holds pages of two packages, so
+ * 	different threads may change the pages of different packages */
+bool Flash_store::packages_disjoint(const Geometry &geometry)
+{
+	return (geometry.get_package_blocks() * geometry.get_block_size()) % PAGE_STATES_PER_BYTE == 0;
+}
+
+/* all blocks start with no erases */
+void Flash_store::init_wear(struct wear_summary &wear, unsigned long count)
+{
+	unsigned int i;
+	wear.min_erases = 0;
+	wear.max_erases = 0;
+	wear.blocks_at_min = count;
+	wear.total_erases = 0;
+	wear.last_erase_time = 0.0;
+	wear.bucket_width = block_erases / WEAR_HISTOGRAM_BUCKETS + 1;
+	for(i = 0; i < WEAR_HISTOGRAM_BUCKETS; i++)
+		wear.histogram[i] = 0;
+	wear.histogram[0] = count;
+	return;
+}
+
+/* count an erase of a block that finished at time and update the plane and
+ * 	device wear summaries
+ * called by Block::_erase
+ * the device summary rescans the erase counts of every block, so the whole
+ * 	update holds wear_lock for erases recorded by other threads */
+void Flash_store::record_erase(unsigned long block, double time)
+{
+	assert(block < num_blocks && erases_remaining[block] > 0);
+	std::lock_guard<std::mutex> guard(wear_lock);
+	last_erase_time[block] = time;
+	erases_remaining[block]--;
+	unsigned long erases = block_erases - erases_remaining[block];
+	unsigned long plane = block / plane_size;
+	add_erase(plane_wear[plane], erases, last_erase_time[block], plane * plane_size, plane_size);
+	add_erase(device_wear, erases, last_erase_time[block], 0, num_blocks);
+	return;
+}
+
+/* move one block of the summarized range [first, first + count) from
+ * erases - 1 to erases
+ * the minimum only needs a rescan of the range once its last block leaves it,
+ * and that cannot happen again until every block is erased once more, so
+ * the rescan costs O(1) amortized per erase */
+void Flash_store::add_erase(struct wear_summary &wear, unsigned long erases, double time, unsigned long first, unsigned long count)
+{
+	unsigned long i;
+	unsigned long block_erase_count;
+
+	wear.histogram[(erases - 1) / wear.bucket_width]--;
+	wear.histogram[erases / wear.bucket_width]++;
+	wear.total_erases++;
+	if(erases > wear.max_erases)
+		wear.max_erases = erases;
+	if(time > wear.last_erase_time)
+		wear.last_erase_time = time;
+
+	if(erases - 1 != wear.min_erases || --wear.blocks_at_min > 0)
+		return;
+
+	wear.min_erases = block_erases;
+	for(i = first; i < first + count; i++)
+	{
+		block_erase_count = block_erases - erases_remaining[i];
+		if(block_erase_count < wear.min_erases)
+		{
+			wear.min_erases = block_erase_count;
+			wear.blocks_at_min = 1;
+		}
+		else if(block_erase_count == wear.min_erases)
+			wear.blocks_at_min++;
+	}
+	return;
+}
+
+/* the page and block state and the wear summaries, see Ssd::save_snapshot */
+void Flash_store::save(Snapshot &snapshot) const
+{
+	snapshot.write_array(page_states, (num_blocks * block_size + PAGE_STATES_PER_BYTE - 1) / PAGE_STATES_PER_BYTE);
+	snapshot.write_array(pages_valid, num_blocks);
+	snapshot.write_array(pages_invalid, num_blocks);
+	snapshot.write_array(block_states, num_blocks);
+	snapshot.write_array(erases_remaining, num_blocks);
+	snapshot.write_array(last_erase_time, num_blocks);
+	snapshot.write(&device_wear, sizeof(device_wear));
+	snapshot.write_array(plane_wear, num_blocks / plane_size);
+	return;
+}
+
+void Flash_store::load(Snapshot &snapshot)
+{
+	snapshot.read_array(page_states, (num_blocks * block_size + PAGE_STATES_PER_BYTE - 1) / PAGE_STATES_PER_BYTE);
+	snapshot.read_array(pages_valid, num_blocks);
+	snapshot.read_array(pages_invalid, num_blocks);
+	snapshot.read_array(block_states, num_blocks);
+	snapshot.read_array(erases_remaining, num_blocks);
+	snapshot.read_array(last_erase_time, num_blocks);
+	snapshot.read(&device_wear, sizeof(device_wear));
+	snapshot.read_array(plane_wear, num_blocks / plane_size);
+	return;
+}
@@ -1,886 +1,3144 @@
-/* Copyright 2009, 2010 Brendan Tauras */
-
-/* ssd_ftl.cpp is part of FlashSim. */
-
-/* FlashSim is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
- * any later version. */
-
-/* FlashSim is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details. */
-
-/* You should have received a copy of the GNU General Public License
- * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
-
-/****************************************************************************/
-
-/* Ftl class
- * Brendan Tauras 2009-11-04
- *
- * This class is a stub class for the user to use as a template for implementing
- * his/her FTL scheme.  A few functions to gather information from lower-level
- * hardware are added to assist writing a FTL scheme.  The Ftl class should
- * rely on the Garbage_collector and Wear_leveler classes for modularity and
- * simplicity. */
-
-/*
- * @ssd_ftl.cpp
- * 
- * HingOn Miu (hmiu)
- * Carnegie Mellon University
- * 2015-10-15
- */
-
-
-#include <new>
-#include <assert.h>
-#include <stdio.h>
-#include "ssd.h"
-#include <string>
-#include <tuple>
-#include <unordered_map>
-#include <vector>
-
-using namespace ssd;
-
-// total number of pages in raw capacity
-#define RAW_SIZE (SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE)
-// total number of physical blocks
-#define NUM_OF_PHY_B (RAW_SIZE / BLOCK_SIZE)
-// total number of pages in overprovisioning
-#define OP_SIZE ((RAW_SIZE *  OVERPROVISIONING) / 100)
-// total number of blocks in overprovisioning
-#define NUM_OF_OP_B (OP_SIZE / BLOCK_SIZE)
-// total number of pages in usable capacity
-#define USABLE_SIZE (RAW_SIZE - OP_SIZE)
-// total number of logical blocks
-#define NUM_OF_LGC_B ((unsigned int)(USABLE_SIZE / BLOCK_SIZE))
-// total number of physical data blocks
-#define NUM_OF_DATA_B (NUM_OF_LGC_B)
-
-// track the emptiness of each logical page
-unsigned int *logical_to_emptiness;
-// track the number of erases for each log block
-unsigned int *erase_count;
-// track the mapping of logical blocks to physical blocks
-int *logical_to_physical;
-// track the mapping of physical data blocks to physical log blocks
-int *data_to_log;
-// track the pages in each physical log block
-std::unordered_map <unsigned long, std::string> log_to_pages;
-// store the start time of input event
-double start_time;
-// store the over-provisioning blocks
-std::vector<unsigned long> op_blocks;
-// record the current cleaning block
-unsigned long current_cln_address;
-
-/**
- * @brief Checks if the input logial address has been written
- */
-bool check_page_empty(unsigned long lba) {
-  // fetch the corresponding unsigned int
-  unsigned int flag = logical_to_emptiness[lba / sizeof (unsigned int)];
-  // check the corresponding bit
-  return (((flag >> (lba % sizeof(unsigned int))) & 1) == 0);
-}
-
-/**
- * @brief Flag the input logical address as written
- */
-void set_page_written(unsigned long lba) {
-  // fetch the corresponding unsigned int and set corresponding bit
-  logical_to_emptiness[lba / sizeof (unsigned int)] |= (1 << (lba % sizeof(unsigned int)));
-}
-
-unsigned long check_physical_address(unsigned long logical_address) {
-  unsigned page = logical_address % BLOCK_SIZE;
-  int nth_logical_block = (int)(logical_address / BLOCK_SIZE);
-  int offset = logical_to_physical[nth_logical_block];
-  int nth_physical_block = nth_logical_block + offset;
-  return page + ((unsigned long)nth_physical_block) * BLOCK_SIZE;
-}
-
-void set_physical_address(unsigned long logical_address, unsigned long physical_address) {
-  int nth_logical_block = (int)(logical_address / BLOCK_SIZE);
-  int nth_physical_block = (int)(physical_address / BLOCK_SIZE);
-  logical_to_physical[nth_logical_block] = (nth_physical_block - nth_logical_block);
-}
-
-bool check_log_block(unsigned long data_address, unsigned long *log_address) {
-  unsigned page = data_address % BLOCK_SIZE;
-  int nth_data_block = (int)(data_address / BLOCK_SIZE);
-  int offset = data_to_log[nth_data_block];
-  if (offset == 0) // data block to log block mapping cannot be 0
-    return false;
-  int nth_log_block = nth_data_block + offset;
-  *log_address = page + ((unsigned long)nth_log_block) * BLOCK_SIZE;
-  return true;
-}
-
-void set_log_block(unsigned long data_address, unsigned long log_address) {
-  int nth_data_block = (int)(data_address / BLOCK_SIZE);
-  int nth_log_block = (int)(log_address / BLOCK_SIZE);
-  data_to_log[nth_data_block] = (nth_log_block - nth_data_block);
-}
-
-void cancel_log_block(unsigned long data_address) {
-  unsigned long log_address;
-  if (check_log_block(data_address, &log_address)) {
-    if (log_to_pages.find(log_address) != log_to_pages.end()) {
-      log_to_pages.erase(log_address);
-    }
-  }
-  // this will clear the offset to 0
-  set_log_block(data_address, data_address);
-}
-
-/**
- * @brief Fetch the most recent copy of the page in log block
- *        corresponding to the page in data block
- */
-bool fetch_log_page(std::string offsets, 
-                    unsigned int data_page, 
-                    unsigned int *log_page) {
-  if (offsets == "") {
-    return false;
-  }
-  // find the position of the last occurance of data_page
-  // check locations beside the first page
-  size_t loc = offsets.rfind("," + std::to_string((long long)data_page) + ",");
-  // found nothing in locations beside the first page
-  if (loc == std::string::npos) {
-    // check the first page of overprovision block
-    loc = offsets.find(std::to_string((long long)data_page) + ",");
-    // found in the first page
-    if (loc == 0) {
-      *log_page = 0;
-      return true;
-    }
-    // found nothing in first page and rest of pages
-    return false;
-  }
-  // found the page (not the first page)
-  // count the index of this page
-  unsigned int count = 0;
-  size_t index = offsets.find(",");
-  while (index != loc) {
-    count++;
-    index++;
-    index = offsets.find(",", index);
-  }
-
-  *log_page = count + 1;
-  return true;
-}
-
-/**
- * @brief Find the next free page in log block
- */
-bool next_free_log_page(std::string offsets, unsigned int *page) {
-  unsigned int count = 0; 
-  size_t loc = offsets.find(",");
-  while (loc != std::string::npos) {
-    count++;
-    loc++;
-    loc = offsets.find(",", loc);
-  }
-
-  if (count >= BLOCK_SIZE) {
-    // no more empty pages in log block
-    return false;
-  }
-  
-  *page = count;
-  //fprintf(log_file, 
-  return true;
-}
-
-void Ftl::print_info(void) {
-  int count = 0;
-  for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
-    //unsigned long data_address = check_physical_address(i * BLOCK_SIZE);
-    bool non_empty = false;
-    for (unsigned int j = 0; j < BLOCK_SIZE; j++) {
-      if (!check_page_empty(i * BLOCK_SIZE + j)) {
-        non_empty = true;
-        break;
-      }
-    }
-    if (non_empty == false) {
-      count++;
-    }
-  }
-  fprintf(log_file, "%d empty data blocks\n", count);
-  for (unsigned int i = 0; i <= BLOCK_ERASES; i++) {
-    int sum = 0;
-    for (unsigned int logical_b = 0; logical_b < NUM_OF_LGC_B; logical_b++) {
-      unsigned long data_address = check_physical_address(logical_b * BLOCK_SIZE);
-      if (erase_count[data_address / BLOCK_SIZE] == i) {
-        sum++;
-      }
-    }
-    fprintf(log_file, "%d data blocks have %u erases\n", sum, i);
-  }
-  fprintf(log_file, "total # of op blocks %d\n", (int)NUM_OF_OP_B);
-  fprintf(log_file, "free op blocks left %d\n", op_blocks.size());
-  int big_sum = 0;
-  for (unsigned int i = 0; i <= BLOCK_ERASES; i++) {
-    int sum = 0;
-    for (unsigned int logical_b = 0; logical_b < NUM_OF_LGC_B; logical_b++) {
-      unsigned long data_address = check_physical_address(logical_b * BLOCK_SIZE);
-      unsigned long log_address;
-      if (check_log_block(data_address, &log_address)) {
-        if (erase_count[log_address / BLOCK_SIZE] == i) {
-          sum++;
-        }
-      }
-    }
-    fprintf(log_file, "%d log blocks have %u erases\n", sum, i);
-    big_sum += sum;
-  }
-  if ((unsigned int)big_sum != log_to_pages.size())
-    fprintf(log_file, "wrong\n");
-  fprintf(log_file, "log blocks used %d\n", big_sum);
-}
-
-/**
- * @brief Check if the block exceeds erase limit
- */
-bool over_erase_limit(unsigned long physical_address) {
-  return (erase_count[physical_address / BLOCK_SIZE] >= BLOCK_ERASES);
-}
-
-/**
- * @brief Update the erase count for a block
- */
-void update_erase_count(unsigned long physical_address) {
-  (erase_count[physical_address / BLOCK_SIZE]) += 1;
-}
-
-bool find_empty_data_block_for_cleaning(unsigned long *empty_data_address) {
-  unsigned int min_count = BLOCK_ERASES + 1;
-  for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
-    unsigned long data_address = check_physical_address(i * BLOCK_SIZE);
-    bool non_empty = false;
-    for (unsigned int j = 0; j < BLOCK_SIZE; j++) {
-      if (!check_page_empty(i * BLOCK_SIZE + j)) {
-        non_empty = true;
-        break;
-      }
-    }
-    unsigned int count = erase_count[data_address / BLOCK_SIZE];
-    if (non_empty == false && count < min_count && count < BLOCK_ERASES) {
-      min_count = count;
-      *empty_data_address = data_address;
-    }
-  }
-  return (min_count != BLOCK_ERASES + 1);
-}
-
-bool find_empty_data_block_for_remapping(unsigned long *empty_data_address,
-                                         unsigned long *empty_logical_block) {
-  unsigned int min_count = BLOCK_ERASES + 1;
-  for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
-    unsigned long data_address = check_physical_address(i * BLOCK_SIZE);
-    bool non_empty = false;
-    for (unsigned int j = 0; j < BLOCK_SIZE; j++) {
-      if (!check_page_empty(i * BLOCK_SIZE + j)) {
-        non_empty = true;
-        break;
-      }
-    }
-    unsigned int count = erase_count[data_address / BLOCK_SIZE];
-    if (non_empty == false && count < min_count && count < BLOCK_ERASES) {
-      min_count = count;
-      *empty_logical_block = i * BLOCK_SIZE;
-      *empty_data_address = data_address;
-    }
-  }
-  return (min_count != BLOCK_ERASES + 1);
-}
-
-/**
- * @brief Returns the numerical mapping from physical address to SSD address
- */
-void map_physical_to_SSD(unsigned long phy,
-                         unsigned int *package, unsigned int *die, 
-                         unsigned int *plane, unsigned int *block, unsigned int *page) {
-  *package = ((((phy / BLOCK_SIZE) / PLANE_SIZE ) / DIE_SIZE) / PACKAGE_SIZE) % SSD_SIZE;
-  *die = (((phy / BLOCK_SIZE) / PLANE_SIZE ) / DIE_SIZE) % PACKAGE_SIZE;
-  *plane = ((phy / BLOCK_SIZE) / PLANE_SIZE ) % DIE_SIZE;
-  *block = (phy / BLOCK_SIZE) % PLANE_SIZE;
-  *page = phy % BLOCK_SIZE;
-}
-
-bool Garbage_collector::shuffle_data_log(void) {
-  // find a log/data block pair with at most BLOCK_ERASES - 1 erases
-  unsigned int max_count = 0;
-  unsigned long max_erase_log = RAW_SIZE;
-  unsigned long max_erase_data = RAW_SIZE;
-  for (unsigned int i = 0; i < NUM_OF_PHY_B; i++) {
-    unsigned long log_address;
-    unsigned long data_address = i * BLOCK_SIZE;
-    if (check_log_block(data_address, &log_address)) {
-      unsigned int log_count = erase_count[log_address / BLOCK_SIZE];
-      unsigned int data_count = erase_count[data_address / BLOCK_SIZE];
-      if (log_count != BLOCK_ERASES &&
-          data_count != BLOCK_ERASES &&
-          (log_count + data_count) >= max_count) {
-        max_erase_log = log_address;
-        max_erase_data = data_address;
-        max_count = (log_count + data_count);
-      }
-    }
-  }
-  if (max_erase_data == RAW_SIZE || max_erase_log == RAW_SIZE) return false;
-  // find the corresponding logical block
-  unsigned long logical_block = RAW_SIZE;
-  for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
-    unsigned long logical_address = i * BLOCK_SIZE;
-    unsigned long to_match = check_physical_address(logical_address);
-    if (to_match == max_erase_data) {
-      logical_block = logical_address;
-      break;
-    }
-  }
-  if (logical_block == RAW_SIZE) return false;
-  
-  // find a data block (unmapped to log block) with the fewest erases
-  unsigned int min_count = BLOCK_ERASES + 1;
-  unsigned long min_erase_data = RAW_SIZE;
-  for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
-    unsigned long logical_address = i * BLOCK_SIZE;
-    unsigned long data_address = check_physical_address(logical_address);
-    unsigned long dummy;
-    // make sure the data block has no log block mapped
-    if (!check_log_block(data_address, &dummy)) {
-      unsigned int count = erase_count[data_address / BLOCK_SIZE];
-      if (count < min_count) {
-        min_erase_data = data_address;
-        min_count = count;
-      }
-    }
-  }
-  if (min_erase_data == RAW_SIZE) return false;
-  if (min_count >= BLOCK_ERASES - 1) return false;
-  
-  // free up the log block
-  if (clean(logical_block, max_erase_data, max_erase_log) == false) return false;
-  cancel_log_block(max_erase_data);
-  
-  // find the corresponding logical block
-  logical_block = RAW_SIZE;
-  for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
-    unsigned long logical_address = i * BLOCK_SIZE;
-    unsigned long to_match = check_physical_address(logical_address);
-    if (to_match == min_erase_data) {
-      logical_block = logical_address;
-      break;
-    }
-  }
-  if (logical_block == RAW_SIZE) return false;
-  
-  unsigned int package;
-  unsigned int die;
-  unsigned int plane;
-  unsigned int block;
-  unsigned int dummy;
-  // move pages from data block to log block
-  for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
-    // move the page if only it is a written page
-    if (!check_page_empty(logical_block + i)) {
-      map_physical_to_SSD(min_erase_data, &package, &die, &plane, &block, &dummy);
-      Address src_addr = Address(package, die, plane, block, i, PAGE);
-      Event read_event = Event(READ, logical_block + i, 1, start_time);
-      read_event.set_address(src_addr);
-      ftl.controller.issue(read_event);
-      map_physical_to_SSD(max_erase_log, &package, &die, &plane, &block, &dummy);
-      Event write_event = Event(WRITE, logical_block + i, 1, start_time);
-      Address des_addr = Address(package, die, plane, block, i, PAGE);
-      write_event.set_address(des_addr);
-      ftl.controller.issue(write_event);
-    }
-  }
-  
-  // erase data block
-  map_physical_to_SSD(min_erase_data, &package, &die, &plane, &block, &dummy);
-  Address data_addr = Address(package, die, plane, block, 0, BLOCK);
-  Event erase_data_event = Event(ERASE, logical_block, 1, start_time);
-  erase_data_event.set_address(data_addr);
-  ftl.controller.issue(erase_data_event);
-  
-  // now the data block becomes new unmapped log block, and the log
-  // block becomes the data block
-  set_physical_address(logical_block, max_erase_log);
-  op_blocks.push_back(min_erase_data);
-  
-  fprintf(log_file,
-    "[shuffle_data_log] log block %lu <-> data block %lu\n", max_erase_log, min_erase_data);
-  
-  return true;
-}
-
-/**
- * @brief Find next unmapped log block
- */
-bool Garbage_collector::next_unmapped_log_block(unsigned long *log_address,
-                                  unsigned int *package, unsigned int *die, 
-                                  unsigned int *plane, unsigned int *block) {
-  if (op_blocks.empty()) {
-    if (shuffle_data_log() == false)
-      return false;
-  }
-  
-  unsigned int i = 0;
-  while (i < op_blocks.size()) {
-    *log_address = op_blocks[op_blocks.size() - 1 - i];
-    unsigned int dummy;
-    map_physical_to_SSD(*log_address, package, die, plane, block, &dummy);
-    op_blocks.pop_back();
-    if (!over_erase_limit(*log_address))
-      return true;
-    i++;
-  }
-  return false;
-}
-
-/**
- * @brief Find the cleaning block to use
- */
-bool next_unmapped_cln_block(unsigned long *cln_address) {
-  return false;
-  /*
-  if (over_erase_limit(current_cln_address)) {
-    if (op_blocks.empty()) {
-      if (find_empty_data_block_for_cleaning(cln_address) == true)
-        return true;
-      return false;
-    }
-    *cln_address = op_blocks[op_blocks.size() - 1];
-    current_cln_address = *cln_address;
-    op_blocks.pop_back();
-    return true;
-  }
-  else {
-    *cln_address = current_cln_address;
-    return true;
-  }*/
-}
-
-unsigned long Garbage_collector::remap_data_block(unsigned long logical_block,
-                                                  unsigned long old_data_pba,
-                                                  unsigned long log_pba) {
-  unsigned int package;
-  unsigned int die;
-  unsigned int plane;
-  unsigned int block;
-  unsigned int dummy;
-  unsigned long new_data_pba;
-  unsigned long new_logical_block = RAW_SIZE;
-  
-  // check if a block available
-  if (find_empty_data_block_for_remapping(&new_data_pba, &new_logical_block) == false) {
-    fprintf(log_file, "[remap_data_block] no empty data block left\n");
-    if (next_unmapped_log_block(&new_data_pba, &package, &die, &plane, &block) == false) {
-      fprintf(log_file, "[remap_data_block] no log block left\n");
-      return log_pba;
-    }
-  }
-
-  // copy pages from old data block to new data block
-  std::unordered_map<unsigned long, std::string>::const_iterator log_pages =
-    log_to_pages.find(log_pba);
-  for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
-    // move the page if only it is a written page
-    if (!check_page_empty(logical_block + i)) {
-      // find if the latest copy
-      unsigned int log_page;
-      if (!fetch_log_page(log_pages->second, i, &log_page)) {
-        // read from latest copy of page in data block
-        map_physical_to_SSD(old_data_pba, &package, &die, &plane, &block, &dummy);
-        Address src_addr = Address(package, die, plane, block, i, PAGE);
-        Event read_event = Event(READ, logical_block + i, 1, start_time);
-        read_event.set_address(src_addr);
-        ftl.controller.issue(read_event);
-        map_physical_to_SSD(new_data_pba, &package, &die, &plane, &block, &dummy);
-        Event write_event = Event(WRITE, logical_block + i, 1, start_time);
-        Address des_addr = Address(package, die, plane, block, i, PAGE);
-        write_event.set_address(des_addr);
-        ftl.controller.issue(write_event);
-      }
-    }
-  }
-  
-  fprintf(log_file, "[remap_data_block] moved pages to new data block\n");
-  
-  if (new_logical_block != RAW_SIZE)
-    set_physical_address(new_logical_block, old_data_pba);
-  set_physical_address(logical_block, new_data_pba);
-  set_log_block(old_data_pba, old_data_pba);
-  set_log_block(new_data_pba, log_pba);
-  
-  return new_data_pba;
-}
-
-unsigned long Garbage_collector::remap_log_block(unsigned long logical_block,
-                                                 unsigned long data_pba,
-                                                 unsigned long old_log_pba) {
-  unsigned int package;
-  unsigned int die;
-  unsigned int plane;
-  unsigned int block;
-  unsigned int dummy;
-  unsigned long new_log_pba;
-  
-  // check if a unmapped log block available
-  if (next_unmapped_log_block(&new_log_pba, &package, &die, &plane, &block) == false) {
-    fprintf(log_file, "[remap_log_block] no log block left\n");
-    return data_pba;
-  }
-
-  // copy pages from old log block to new log block
-  std::unordered_map<unsigned long, std::string>::const_iterator log_pages =
-    log_to_pages.find(old_log_pba);
-  int j = 0;
-  std::string offsets = "";
-  for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
-    // move the page if only it is a written page
-    if (!check_page_empty(logical_block + i)) {
-      // find if the latest copy
-      unsigned int log_page;
-      if (fetch_log_page(log_pages->second, i, &log_page)) {
-        // read from latest copy of page in log block
-        map_physical_to_SSD(old_log_pba, &package, &die, &plane, &block, &dummy);
-        Address src_addr = Address(package, die, plane, block, log_page, PAGE);
-        Event read_event = Event(READ, logical_block + i, 1, start_time);
-        read_event.set_address(src_addr);
-        ftl.controller.issue(read_event);
-        map_physical_to_SSD(new_log_pba, &package, &die, &plane, &block, &dummy);
-        Event write_event = Event(WRITE, logical_block + i, 1, start_time);
-        Address des_addr = Address(package, die, plane, block, j, PAGE);
-        write_event.set_address(des_addr);
-        ftl.controller.issue(write_event);
-        j++;
-        offsets += (std::to_string((long long)i) + ",");
-      }
-    }
-  }
-  
-  fprintf(log_file, "[remap_log_block] moved pages to new log block\n");
-  
-  cancel_log_block(data_pba);
-  set_log_block(data_pba, new_log_pba);
-  log_to_pages[new_log_pba] = offsets;
-  
-  return new_log_pba;
-}
-
-/**
- * @brief Move data to cleaning black and move back
- */
-bool Garbage_collector::clean(unsigned long logical_block,
-                              unsigned long data_pba, unsigned long log_pba) {
-  unsigned int package;
-  unsigned int die;
-  unsigned int plane;
-  unsigned int block;
-  unsigned int dummy;
-  unsigned long cln_pba;
-  
-  // calculate log block 
-  map_physical_to_SSD(log_pba, &package, &die, &plane, &block, &dummy);
-  Address log_addr = Address(package, die, plane, block, 0, BLOCK);
- 
-  // calculate data block
-  map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
-  Address data_addr = Address(package, die, plane, block, 0, BLOCK);
-  
-  // check if a unmapped cleaning block available
-  if (find_empty_data_block_for_cleaning(&cln_pba) == false) {
-    fprintf(log_file, "[clean] no empty data block left\n");
-    //if (next_unmapped_cln_block(&cln_pba) == false) {
-      // no free cleaning block
-    //  fprintf(log_file, "[clean] no cleaning block left\n");
-      return false;
-    //}
-  }
-  
-  fprintf(log_file, "[clean] data block %lu, log block %lu\n", data_pba, log_pba);
-  
-  // calculate cleaning block 
-  map_physical_to_SSD(cln_pba, &package, &die, &plane, &block, &dummy);
-  Address cln_addr = Address(package, die, plane, block, 0, BLOCK);
-
-  // copy live pages from data block and log block to cleaning block
-  std::unordered_map<unsigned long, std::string>::const_iterator log_pages = log_to_pages.find(log_pba);
-  for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
-    // move the page if only it is a written page
-    if (!check_page_empty(logical_block + i)) {
-      // find if the latest copy
-      unsigned int log_page;
-      Address src_addr;
-      if (fetch_log_page(log_pages->second, i, &log_page)) {
-        // read from latest copy of page in log block
-        map_physical_to_SSD(log_pba, &package, &die, &plane, &block, &dummy);
-        src_addr = Address(package, die, plane, block, log_page, PAGE);
-      }
-      else {
-        // read from latest copy in data block
-        map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
-        src_addr = Address(package, die, plane, block, i, PAGE);
-      }
-      Event read_event = Event(READ, logical_block + i, 1, start_time);
-      read_event.set_address(src_addr);
-      ftl.controller.issue(read_event);
-      Event write_event = Event(WRITE, logical_block + i, 1, start_time);
-      map_physical_to_SSD(cln_pba, &package, &die, &plane, &block, &dummy);
-      Address des_addr = Address(package, die, plane, block, i, PAGE);
-      write_event.set_address(des_addr);
-      ftl.controller.issue(write_event);
-    }
-  }
-  
-  // erase data block
-  Event erase_data_event = Event(ERASE, logical_block, 1, start_time);
-  erase_data_event.set_address(data_addr);
-  ftl.controller.issue(erase_data_event);
-  // erase log block
-  Event erase_log_event = Event(ERASE, logical_block, 1, start_time);
-  erase_log_event.set_address(log_addr);
-  ftl.controller.issue(erase_log_event);
-  // copy live pages from cleaning block to data block
-  for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
-    // move the page if only it is a written page
-    if (!check_page_empty(logical_block + i)) {
-      Event read_event = Event(READ, logical_block + i, 1, start_time);
-      map_physical_to_SSD(cln_pba, &package, &die, &plane, &block, &dummy);
-      Address src_addr = Address(package, die, plane, block, i, PAGE);
-      read_event.set_address(src_addr);
-      ftl.controller.issue(read_event);
-      Event write_event = Event(WRITE, logical_block + i, 1, start_time);
-      map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
-      Address des_addr = Address(package, die, plane, block, i, PAGE);
-      write_event.set_address(des_addr);
-      ftl.controller.issue(write_event);
-    }
-  }
-  // erase cleaning block
-  Event erase_cln_event = Event(ERASE, logical_block, 1, start_time);
-  erase_cln_event.set_address(cln_addr);
-  ftl.controller.issue(erase_cln_event);
-  
-  // update erase counts
-  update_erase_count(data_pba);
-  update_erase_count(log_pba);
-  update_erase_count(cln_pba);
-  
-  return true;
-}
-
-void Ftl::init_ftl_user()
-{
-  // initialize the bit checking emptiness array
-  unsigned int emp_len = (USABLE_SIZE + sizeof(unsigned int) - 1) / sizeof(unsigned int);
-  // 0 bit for empty, 1 bit for written
-  logical_to_emptiness = new unsigned int [emp_len]();
-  
-  // initialize erases count for all physical blocks
-  erase_count = new unsigned int [NUM_OF_PHY_B]();
-  
-  // initialize offset mapping table from logical block to physical block
-  logical_to_physical = new int [NUM_OF_LGC_B]();
-  
-  // initialize offset mapping table from physical data block to physical log block
-  data_to_log = new int [NUM_OF_PHY_B]();
-
-  // initialize a cleaning block
-  //current_cln_address = USABLE_SIZE;
-  
-  // initialize the list of overprovisioning blocks
-  for (unsigned int i = USABLE_SIZE; i < RAW_SIZE; i += BLOCK_SIZE) {
-    op_blocks.push_back(i);
-  }
-}
-
-enum status Ftl::translate( Event &event ){
-  unsigned int package;
-  unsigned int die;
-  unsigned int plane;
-  unsigned int block;
-  unsigned int page;
-  unsigned long data_address;
-  unsigned long log_address;
-  unsigned long logical_address;
-  unsigned long physical_address;
-  logical_address = event.get_logical_address();
-  fprintf(log_file, "[translate] input LBA: %lu *******************************\n", logical_address);
-
-  //print_info();
-  
-  // legal logical address is only from 0 to USABLE_SIZE - 1 
-  if (logical_address >= USABLE_SIZE) {
-    fprintf(log_file, "[translate] LBA not assessible\n");
-    return FAILURE;
-  }
-
-  // set start time
-  start_time = event.get_start_time();
-  
-  // find the physical address
-  physical_address = check_physical_address(logical_address);
-  map_physical_to_SSD(physical_address, &package, &die, &plane, &block, &page);
-  fprintf(log_file, "[translate] original mapping is (%u,%u,%u,%u,%u)\n", 
-    package, die, plane, block, page);
-  // find the physical data block address
-  data_address = physical_address - page;
-  fprintf(log_file, "[translate] data block address is %lu\n", data_address);
-  
-  enum event_type operation = event.get_event_type();
-
-  if (operation == WRITE) {   
-    // check if page is empty
-    if (check_page_empty(logical_address)) {
-      set_page_written(logical_address);
-      // original translation
-      Address pba = Address(package, die, plane, block, page, PAGE);
-      event.set_address(pba);
-      fprintf(log_file, "[translate] wrote to an empty page\n");
-      return SUCCESS;
-    } 
-    
-    // check if log block mapped to data block
-    if (check_log_block(data_address, &log_address)) {
-      fprintf(log_file, "[translate] data block %lu maps to log block %lu\n",
-        data_address, log_address);
-      // check if there is a empty page in log block
-      std::unordered_map<unsigned long, std::string>::const_iterator log_pages =
-        log_to_pages.find(log_address);
-      unsigned int log_page;
-      if (next_free_log_page(log_pages->second, &log_page)) {
-        log_to_pages[log_address] = 
-          log_pages->second + std::to_string((long long)page) + ",";
-        fprintf(log_file, "[translate] log block pba %lu contains %s\n",
-          log_address, log_to_pages[log_address].c_str());
-        map_physical_to_SSD(log_address, &package, &die, &plane, &block, &page);
-        // logging translation
-        Address pba = Address(package, die, plane, block, log_page, PAGE);
-        event.set_address(pba);
-        return SUCCESS;
-      }
-      
-      fprintf(log_file, "[translate] mapped log block has no free page\n");
-      
-      // this data block needs cleaning
-      if (over_erase_limit(data_address) == true) {
-        data_address = garbage.remap_data_block(logical_address - page,
-                                                data_address, log_address);
-        if (log_address == data_address) {
-          fprintf(log_file, "[translate] data block remapping failed\n");
-          return FAILURE;
-        }
-      }
-      // this log block needs cleaning
-      if (over_erase_limit(log_address) == true) {
-        log_address = garbage.remap_log_block(logical_address - page,
-                                              data_address, log_address);
-        if (log_address == data_address) {
-          fprintf(log_file, "[translate] log block remapping failed\n");
-          return FAILURE;
-        }
-      }
-      if (garbage.clean(logical_address - page, data_address, log_address) == false) {
-        fprintf(log_file, "[translate] cleaning failed\n");
-        return FAILURE;
-      }
-      
-      // give the first page of this cleaned log block
-      std::string offsets = std::to_string((long long) page) + ",";
-      log_to_pages[log_address] = offsets;
-      fprintf(log_file, 
-        "[translate] after cleaning, log block %lu contains %s\n",
-        log_address, offsets.c_str());
-      map_physical_to_SSD(log_address, &package, &die, &plane, &block, &page);
-      // logging translation
-      Address pba = Address(package, die, plane, block, 0, PAGE);
-      event.set_address(pba);
-      return SUCCESS;
-    }
-    
-    // check if there is a free log block
-    if (garbage.next_unmapped_log_block(&log_address, &package, &die, &plane, &block)) {
-      fprintf(log_file, "[translate] found free log block (%u,%u,%u,%u,0)\n",
-        package, die, plane, block); 
-      // map log block to data block
-      set_log_block(data_address, log_address);
-      std::string offsets = std::to_string((long long) page) + ","; 
-      log_to_pages.insert({{log_address, offsets}});
-      fprintf(log_file, 
-        "[translate] log block pba %lu contains %s\n", log_address, offsets.c_str());
-      // logging translation
-      Address pba = Address(package, die, plane, block, 0, PAGE);
-      event.set_address(pba);
-      return SUCCESS;
-    }
-
-    fprintf(log_file, "[translate] fail to rotate log blocks\n");
-    return FAILURE;
-  }
-
-  if (operation == READ) {
-    // check if page is valid
-    if (check_page_empty(logical_address)) {
-      fprintf(log_file, "[translate] read a empty page\n");
-      return FAILURE; 
-    }
-    
-    // check if log block mapped to data block
-    if (check_log_block(data_address, &log_address)) {
-      fprintf(log_file, 
-        "[translate] data block %lu maps to log block %lu\n",
-        data_address, log_address);
-      // check if there is a corresponding page in log block
-      std::unordered_map<unsigned long, std::string>::const_iterator log_pages =
-        log_to_pages.find(log_address);
-      fprintf(log_file, "[translate] log block %lu contains %s\n",
-        log_address, log_pages->second.c_str());
-      unsigned int log_page;
-      if (fetch_log_page(log_pages->second, page, &log_page)) {
-        // read from recent copy of page in log block
-        map_physical_to_SSD(log_address, &package, &die, &plane, &block, &page);
-        Address pba = Address(package, die, plane, block, log_page, PAGE);
-        event.set_address(pba);
-        fprintf(log_file, "[translate] reading page %u in log block\n", log_page);
-        return SUCCESS;
-      }
-    }
-    
-    // read from original calculated page
-    Address pba = Address(package, die, plane, block, page, PAGE);
-    event.set_address(pba);
-    fprintf(log_file, "[translate] reading original data block page\n");
-    return SUCCESS;
-  }
-
-  fprintf(log_file, "[translate] unkown operation\n");
-  return FAILURE;
-}
-
-enum status Garbage_collector::collect(Event &event __attribute__((unused)), enum GC_POLICY policy __attribute__((unused)))
-{
-  /*
-   * No need to use this function
-   */
-  return FAILURE;
-}
-
-enum status Wear_leveler::level( Event &event __attribute__((unused)))
-{
-  /*
-   * No need to use this function
-   */
-  return FAILURE;
-}
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_ftl.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Ftl class
+ * Brendan Tauras 2009-11-04
+ *
+ * This class is a stub class for the user to use as a template for implementing
+ * his/her FTL scheme.  A few functions to gather information from lower-level
+ * hardware are added to assist writing a FTL scheme.  The Ftl class should
+ * rely on the Garbage_collector and Wear_leveler classes for modularity and
+ * simplicity. */
+
+/*
+ * @ssd_ftl.cpp
+ * 
+ * HingOn Miu (hmiu)
+ * Carnegie Mellon University
+ * 2015-10-15
+ */
+
+
+#include <new>
+#include <assert.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "ssd.h"
+#include <vector>
+#include <deque>
+
+using namespace ssd;
+
+// number of logical pages tracked by each word of the emptiness bitset
+#define EMPTINESS_WORD_BITS 64
+
+// write streams of page mapping mode, hot host writes and cold ones
+#define PAGE_STREAMS 2
+// stream of the cold host writes and of the collection copies, the only
+// stream used without hot/cold separation
+#define COLD_STREAM (HEAT_HALF_LIFE > 0 ? 1u : 0u)
+
+// fixed-size descriptor of the pages written in a physical log block
+struct log_block_desc {
+  // number of log pages written, which is also the next free log page
+  unsigned int cursor;
+  // latest log page holding each data page, NO_LOG_PAGE if none
+  unsigned int *latest;
+};
+
+// indexed binary heap of block numbers, ordered by a comparison function,
+// that remembers the slot of every block so any block can be reordered
+struct block_heap {
+  unsigned int *data;
+  // slot of each block in data, -1 if the block is not in the heap
+  int *pos;
+  unsigned int size;
+  // true if block a should be closer to the top than block b
+  bool (*before)(unsigned int a, unsigned int b);
+};
+
+// doubly linked list of physical data blocks threaded through prev/next
+// arrays indexed by block number, -1 ends the list
+struct block_list {
+  int head;
+  int tail;
+};
+
+// states of a page mapping entry in the cached mapping table
+enum map_entry_state {MAP_UNCACHED, MAP_CLEAN, MAP_DIRTY};
+
+/**
+ * @brief The tables of one Ftl instance
+ *
+ * Each Ftl allocates its own in init_ftl_user, so several SSDs can run in one
+ * process, each on its own thread.  The FTL functions reach the tables
+ * through current, see ftl_scope.
+ */
+struct ssd::ftl_state {
+  ftl_state(const Geometry &geometry);
+  ~ftl_state();
+
+  // geometry of the ssd the FTL was initialized for
+  const Geometry geometry;
+
+  // track the emptiness of each logical page
+  uint64_t *logical_to_emptiness;
+  // track the logical pages trimmed since their data block was last rebuilt,
+  // whose data block page may still be programmed
+  uint64_t *logical_to_trimmed;
+  // track the number of erases for each log block
+  unsigned int *erase_count;
+  // track the mapping of logical blocks to physical blocks
+  int *logical_to_physical;
+  // track the mapping of physical data blocks to physical log blocks
+  int *data_to_log;
+
+  // pool of log block descriptors, backed by one contiguous page table
+  unsigned int num_log_descs;
+  log_block_desc *log_descs;
+  unsigned int *log_desc_pages;
+  // the descriptors not bound to any log block
+  std::vector<unsigned int> free_log_descs;
+  // track the descriptor of each physical log block, -1 if none
+  int *log_to_desc;
+  // store the start time of input event
+  double start_time;
+  // store the latest finish time of the garbage collection events issued
+  double gc_finish_time;
+  // store the over-provisioning blocks
+  std::vector<unsigned long> op_blocks;
+  // block mapping mode with heat separation or striping: the slot of each
+  // free block in op_blocks, -1 if not free, NULL if not indexed, and the free
+  // blocks of each stripe, a die with BLOCK_STRIPING and the whole SSD
+  // otherwise, fewest erases first for hot logical blocks, most erases first
+  // for cold ones and latest freed first, worn out blocks last
+  int *free_slot;
+  unsigned int num_stripes;
+  block_heap *free_fewest;
+  block_heap *free_most;
+  block_heap *free_recent;
+  // record the current cleaning block
+  unsigned long current_cln_address;
+  // track the logical block of each physical data block, -1 if none
+  int *physical_to_logical;
+  // track the physical data block of each physical log block, -1 if none
+  int *log_to_data;
+
+  // fully empty logical blocks, fewest data block erases first
+  block_heap empty_heap;
+  // the same blocks, most data block erases first among those below the limit
+  block_heap worn_empty_heap;
+  // logical blocks whose data block has no log block, fewest erases first
+  block_heap unlogged_heap;
+  // physical data blocks mapped to a log block, most pair erases first
+  block_heap pair_heap;
+
+  // the victim candidates for cleaning are the physical data blocks mapped to
+  // a log block, kept in mapping order and in buckets by the number of live
+  // pages of their logical block, each bucket in order of last write
+  block_list fifo_pairs;
+  int *fifo_prev;
+  int *fifo_next;
+  block_list *live_pairs;
+  int *live_prev;
+  int *live_next;
+  // bucket of each data block in live_pairs, -1 if not a candidate
+  int *pair_live;
+  // time of the latest write to each candidate data block or its log block
+  double *pair_written;
+
+  // host update count of each logical block, halved every HEAT_HALF_LIFE host
+  // writes, and the half-life period it was last brought up to date in
+  unsigned int *update_heat;
+  unsigned long *heat_period;
+  // number of host page writes counted for the update heat
+  unsigned long host_writes;
+
+  // page mapping mode: physical page of each logical page, RAW_SIZE if none
+  unsigned long *page_map;
+  // logical page held by each physical page, RAW_SIZE if none or stale
+  unsigned long *page_owner;
+  // number of live pages in each physical block
+  unsigned int *block_live;
+  // the full blocks that can be collected, in buckets by their live pages,
+  // each bucket in order of the latest change
+  block_list *live_blocks;
+  int *block_prev;
+  int *block_next;
+  bool *block_sealed;
+  // blocks taking host writes and collection copies, and their next free
+  // pages, one per write stream, see page_stream
+  unsigned long frontier[PAGE_STREAMS];
+  unsigned int frontier_cursor[PAGE_STREAMS];
+  // set while a block is collected, which may take the last free block
+  bool collecting_pages;
+  // delay of the mapping table accesses made for the current event
+  double map_delay;
+
+  // cached mapping entries in order of use, most recent at the back
+  block_list map_lru;
+  int *map_prev;
+  int *map_next;
+  unsigned char *map_state;
+  unsigned int map_cached;
+  // cached mapping table statistics
+  unsigned long map_hits;
+  unsigned long map_misses;
+  unsigned long map_page_reads;
+  unsigned long map_page_writes;
+
+  // work done by the FTL, see Ftl::get_stats
+  struct ftl_stats counters;
+
+  // shared log mode: latest log copies are indexed through page_map and
+  // page_owner, and block_live counts the live pages of each log block
+  // the random log blocks, oldest first, and the next free page of the last
+  std::deque<unsigned long> random_logs;
+  unsigned int random_cursor;
+  // the sequential log block, RAW_SIZE if none, with its logical block and the
+  // next free page, which is also the next page of the logical block it takes
+  unsigned long seq_log;
+  unsigned long seq_logical;
+  unsigned int seq_cursor;
+};
+
+// the tables of the Ftl whose method is running on this thread
+static thread_local ftl_state *current;
+
+/**
+ * @brief Make the tables of an Ftl current for the extent of a call into the
+ *        FTL, restoring the previous ones so calls can nest
+ */
+struct ftl_scope {
+  ftl_state *saved;
+  ftl_scope(ftl_state *state) : saved(current) { current = state; }
+  ~ftl_scope() { current = saved; }
+};
+
+// number of pages in each block
+#define BLOCK_PAGES (current->geometry.get_block_size())
+// total number of pages in raw capacity
+#define RAW_SIZE (current->geometry.get_raw_pages())
+// total number of physical blocks
+#define NUM_OF_PHY_B (current->geometry.get_physical_blocks())
+// total number of pages in overprovisioning
+#define OP_SIZE (current->geometry.get_op_pages())
+// total number of blocks in overprovisioning
+#define NUM_OF_OP_B (current->geometry.get_op_blocks())
+// total number of pages in usable capacity
+#define USABLE_SIZE (current->geometry.get_usable_pages())
+// total number of logical blocks
+#define NUM_OF_LGC_B (current->geometry.get_logical_blocks())
+// total number of physical data blocks
+#define NUM_OF_DATA_B (NUM_OF_LGC_B)
+// marks a data page that has no copy in its log block
+#define NO_LOG_PAGE (BLOCK_PAGES)
+
+ftl_state::ftl_state(const Geometry &geometry)
+  : geometry(geometry), free_slot(NULL), num_stripes(0),
+    free_fewest(NULL), free_most(NULL), free_recent(NULL) {
+}
+
+ftl_state::~ftl_state() {
+  delete [] logical_to_emptiness;
+  delete [] logical_to_trimmed;
+  delete [] erase_count;
+  delete [] logical_to_physical;
+  delete [] data_to_log;
+  delete [] log_descs;
+  delete [] log_desc_pages;
+  delete [] log_to_desc;
+  delete [] physical_to_logical;
+  delete [] log_to_data;
+  delete [] empty_heap.data;
+  delete [] empty_heap.pos;
+  delete [] worn_empty_heap.data;
+  delete [] worn_empty_heap.pos;
+  delete [] unlogged_heap.data;
+  delete [] unlogged_heap.pos;
+  delete [] pair_heap.data;
+  delete [] pair_heap.pos;
+  if (free_slot != NULL) {
+    for (unsigned int i = 0; i < num_stripes; i++) {
+      delete [] free_fewest[i].data;
+      delete [] free_most[i].data;
+      delete [] free_recent[i].data;
+    }
+    delete [] free_fewest[0].pos;
+    delete [] free_most[0].pos;
+    delete [] free_recent[0].pos;
+  }
+  delete [] free_slot;
+  delete [] free_fewest;
+  delete [] free_most;
+  delete [] free_recent;
+  delete [] fifo_prev;
+  delete [] fifo_next;
+  delete [] live_pairs;
+  delete [] live_prev;
+  delete [] live_next;
+  delete [] pair_live;
+  delete [] pair_written;
+  delete [] update_heat;
+  delete [] heat_period;
+  delete [] page_map;
+  delete [] page_owner;
+  delete [] block_live;
+  delete [] live_blocks;
+  delete [] block_prev;
+  delete [] block_next;
+  delete [] block_sealed;
+  delete [] map_prev;
+  delete [] map_next;
+  delete [] map_state;
+}
+
+/**
+ * @brief Return the erase count of the data block of a logical block
+ */
+unsigned int logical_erase_count(unsigned int nth_logical_block) {
+  return current->erase_count[nth_logical_block + current->logical_to_physical[nth_logical_block]];
+}
+
+/**
+ * @brief Order logical blocks by data block erase count, then block number
+ */
+bool logical_fewer_erases(unsigned int a, unsigned int b) {
+  unsigned int count_a = logical_erase_count(a);
+  unsigned int count_b = logical_erase_count(b);
+  if (count_a != count_b)
+    return count_a < count_b;
+  return a < b;
+}
+
+/**
+ * @brief Order logical blocks by data block erase count, most first, blocks
+ *        at the erase limit last
+ */
+bool logical_more_erases(unsigned int a, unsigned int b) {
+  unsigned int count_a = logical_erase_count(a);
+  unsigned int count_b = logical_erase_count(b);
+  bool usable_a = (count_a < BLOCK_ERASES);
+  bool usable_b = (count_b < BLOCK_ERASES);
+  if (usable_a != usable_b)
+    return usable_a;
+  if (count_a != count_b)
+    return count_a > count_b;
+  return a < b;
+}
+
+/**
+ * @brief Order data blocks by combined erases with their log block,
+ *        pairs with a block at the erase limit last
+ */
+bool pair_more_erases(unsigned int a, unsigned int b) {
+  unsigned int log_a = current->erase_count[a + current->data_to_log[a]];
+  unsigned int log_b = current->erase_count[b + current->data_to_log[b]];
+  bool usable_a = (log_a != BLOCK_ERASES && current->erase_count[a] != BLOCK_ERASES);
+  bool usable_b = (log_b != BLOCK_ERASES && current->erase_count[b] != BLOCK_ERASES);
+  if (usable_a != usable_b)
+    return usable_a;
+  unsigned int count_a = log_a + current->erase_count[a];
+  unsigned int count_b = log_b + current->erase_count[b];
+  if (count_a != count_b)
+    return count_a > count_b;
+  return a > b;
+}
+
+/**
+ * @brief Return the update count of a logical block decayed to the current
+ *        half-life period
+ */
+unsigned int decayed_heat(unsigned int nth_logical_block) {
+  unsigned long halvings = current->host_writes / HEAT_HALF_LIFE - current->heat_period[nth_logical_block];
+  if (halvings >= 32)
+    return 0;
+  return current->update_heat[nth_logical_block] >> halvings;
+}
+
+/**
+ * @brief Count a host write to a logical block
+ */
+void record_update(unsigned int nth_logical_block) {
+  if (HEAT_HALF_LIFE == 0)
+    return;
+  current->update_heat[nth_logical_block] = decayed_heat(nth_logical_block) + 1;
+  current->heat_period[nth_logical_block] = current->host_writes / HEAT_HALF_LIFE;
+  current->host_writes++;
+}
+
+/**
+ * @brief Classify a logical block by its decayed update count
+ */
+enum temperature block_temperature(unsigned int nth_logical_block) {
+  if (HEAT_HALF_LIFE == 0)
+    return TEMP_UNKNOWN;
+  return decayed_heat(nth_logical_block) >= HOT_THRESHOLD ? TEMP_HOT : TEMP_COLD;
+}
+
+/**
+ * @brief Allocate an empty heap for blocks 0 to capacity - 1
+ */
+void heap_init(block_heap *heap, unsigned int capacity,
+               bool (*before)(unsigned int a, unsigned int b)) {
+  heap->data = new unsigned int [capacity];
+  heap->pos = new int [capacity];
+  heap->size = 0;
+  heap->before = before;
+  for (unsigned int i = 0; i < capacity; i++)
+    heap->pos[i] = -1;
+}
+
+/**
+ * @brief Set up an empty heap for at most capacity blocks whose slots are
+ *        kept in pos, shared by heaps that never hold the same block
+ */
+void heap_init_shared(block_heap *heap, unsigned int capacity, int *pos,
+                      bool (*before)(unsigned int a, unsigned int b)) {
+  heap->data = new unsigned int [capacity];
+  heap->pos = pos;
+  heap->size = 0;
+  heap->before = before;
+}
+
+/**
+ * @brief Swap two slots of the heap
+ */
+void heap_swap(block_heap *heap, unsigned int i, unsigned int j) {
+  unsigned int tmp = heap->data[i];
+  heap->data[i] = heap->data[j];
+  heap->data[j] = tmp;
+  heap->pos[heap->data[i]] = i;
+  heap->pos[heap->data[j]] = j;
+}
+
+/**
+ * @brief Restore the heap order around a slot whose key changed
+ */
+void heap_fix(block_heap *heap, unsigned int i) {
+  // move up while ahead of the parent
+  while (i > 0 && heap->before(heap->data[i], heap->data[(i - 1) / 2])) {
+    heap_swap(heap, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+  // move down while behind a child
+  while (true) {
+    unsigned int top = i;
+    unsigned int left = 2 * i + 1;
+    unsigned int right = 2 * i + 2;
+    if (left < heap->size && heap->before(heap->data[left], heap->data[top]))
+      top = left;
+    if (right < heap->size && heap->before(heap->data[right], heap->data[top]))
+      top = right;
+    if (top == i)
+      break;
+    heap_swap(heap, i, top);
+    i = top;
+  }
+}
+
+/**
+ * @brief Check if a block is in the heap
+ */
+bool heap_contains(const block_heap *heap, unsigned int block) {
+  return heap->pos[block] >= 0;
+}
+
+/**
+ * @brief Add a block to the heap if absent
+ */
+void heap_insert(block_heap *heap, unsigned int block) {
+  if (heap_contains(heap, block))
+    return;
+  heap->data[heap->size] = block;
+  heap->pos[block] = heap->size;
+  heap->size++;
+  heap_fix(heap, heap->size - 1);
+}
+
+/**
+ * @brief Drop a block from the heap if present
+ */
+void heap_remove(block_heap *heap, unsigned int block) {
+  int pos = heap->pos[block];
+  if (pos < 0)
+    return;
+  heap->size--;
+  if ((unsigned int)pos != heap->size) {
+    heap_swap(heap, pos, heap->size);
+    heap_fix(heap, pos);
+  }
+  heap->pos[block] = -1;
+}
+
+/**
+ * @brief Reorder a block after its key changed
+ */
+void heap_update(block_heap *heap, unsigned int block) {
+  if (heap_contains(heap, block))
+    heap_fix(heap, heap->pos[block]);
+}
+
+/**
+ * @brief Keep a logical block in unlogged_heap only while its data block
+ *        has no log block
+ */
+void refresh_unlogged(unsigned int nth_logical_block) {
+  int nth_physical_block = nth_logical_block + current->logical_to_physical[nth_logical_block];
+  if (current->data_to_log[nth_physical_block] == 0) {
+    heap_insert(&current->unlogged_heap, nth_logical_block);
+    heap_update(&current->unlogged_heap, nth_logical_block);
+  }
+  else {
+    heap_remove(&current->unlogged_heap, nth_logical_block);
+  }
+}
+
+/**
+ * @brief Checks if the input logial address has been written
+ */
+bool check_page_empty(unsigned long lba) {
+  // fetch the corresponding word
+  uint64_t flag = current->logical_to_emptiness[lba / EMPTINESS_WORD_BITS];
+  // check the corresponding bit
+  return (((flag >> (lba % EMPTINESS_WORD_BITS)) & 1) == 0);
+}
+
+void refresh_pair(unsigned int nth_logical_block);
+
+/**
+ * @brief Flag the input logical address as written
+ */
+void set_page_written(unsigned long lba) {
+  // fetch the corresponding word and set corresponding bit
+  current->logical_to_emptiness[lba / EMPTINESS_WORD_BITS] |=
+    ((uint64_t)1 << (lba % EMPTINESS_WORD_BITS));
+  // the logical block is no longer empty
+  heap_remove(&current->empty_heap, lba / BLOCK_PAGES);
+  heap_remove(&current->worn_empty_heap, lba / BLOCK_PAGES);
+  refresh_pair(lba / BLOCK_PAGES);
+}
+
+/**
+ * @brief Return the mask of span bits starting at bit within a word
+ */
+static inline uint64_t emptiness_mask(unsigned long bit, unsigned long span) {
+  if (span >= EMPTINESS_WORD_BITS)
+    return ~(uint64_t)0;
+  return (((uint64_t)1 << span) - 1) << bit;
+}
+
+/**
+ * @brief Count the written pages among count logical pages from lba
+ */
+unsigned int count_pages_written(unsigned long lba, unsigned long count) {
+  unsigned long end = lba + count;
+  unsigned int written = 0;
+  // partial word in front
+  if (lba % EMPTINESS_WORD_BITS != 0 && lba < end) {
+    unsigned long bit = lba % EMPTINESS_WORD_BITS;
+    unsigned long span = EMPTINESS_WORD_BITS - bit;
+    if (span > end - lba)
+      span = end - lba;
+    written += __builtin_popcountll(current->logical_to_emptiness[lba / EMPTINESS_WORD_BITS] &
+                                    emptiness_mask(bit, span));
+    lba += span;
+  }
+  // whole words
+  for (; lba + EMPTINESS_WORD_BITS <= end; lba += EMPTINESS_WORD_BITS)
+    written += __builtin_popcountll(current->logical_to_emptiness[lba / EMPTINESS_WORD_BITS]);
+  // partial word at the back
+  if (lba < end)
+    written += __builtin_popcountll(current->logical_to_emptiness[lba / EMPTINESS_WORD_BITS] &
+                                    emptiness_mask(0, end - lba));
+  return written;
+}
+
+/**
+ * @brief Check if none of count logical pages from lba has been written
+ */
+bool check_pages_empty(unsigned long lba, unsigned long count) {
+  unsigned long end = lba + count;
+  uint64_t flags = 0;
+  // partial word in front
+  if (lba % EMPTINESS_WORD_BITS != 0 && lba < end) {
+    unsigned long bit = lba % EMPTINESS_WORD_BITS;
+    unsigned long span = EMPTINESS_WORD_BITS - bit;
+    if (span > end - lba)
+      span = end - lba;
+    flags |= current->logical_to_emptiness[lba / EMPTINESS_WORD_BITS] & emptiness_mask(bit, span);
+    lba += span;
+  }
+  // whole words, or-ed together so the loop vectorizes
+  const uint64_t *words = &current->logical_to_emptiness[lba / EMPTINESS_WORD_BITS];
+  unsigned long num_words = (end - lba) / EMPTINESS_WORD_BITS;
+  for (unsigned long i = 0; i < num_words; i++)
+    flags |= words[i];
+  lba += num_words * EMPTINESS_WORD_BITS;
+  // partial word at the back
+  if (lba < end)
+    flags |= current->logical_to_emptiness[lba / EMPTINESS_WORD_BITS] & emptiness_mask(0, end - lba);
+  return flags == 0;
+}
+
+/**
+ * @brief Check if no page of the logical block has been written
+ */
+bool check_block_empty(unsigned int nth_logical_block) {
+  return check_pages_empty(((unsigned long)nth_logical_block) * BLOCK_PAGES, BLOCK_PAGES);
+}
+
+/**
+ * @brief Clear the bits of count logical pages from lba in a page bitset
+ */
+static void clear_page_bits(uint64_t *bits, unsigned long lba, unsigned long count) {
+  unsigned long end = lba + count;
+  // partial word in front
+  if (lba % EMPTINESS_WORD_BITS != 0 && lba < end) {
+    unsigned long bit = lba % EMPTINESS_WORD_BITS;
+    unsigned long span = EMPTINESS_WORD_BITS - bit;
+    if (span > end - lba)
+      span = end - lba;
+    bits[lba / EMPTINESS_WORD_BITS] &= ~emptiness_mask(bit, span);
+    lba += span;
+  }
+  // whole words
+  unsigned long num_words = (end - lba) / EMPTINESS_WORD_BITS;
+  memset(&bits[lba / EMPTINESS_WORD_BITS], 0, num_words * sizeof(uint64_t));
+  lba += num_words * EMPTINESS_WORD_BITS;
+  // partial word at the back
+  if (lba < end)
+    bits[lba / EMPTINESS_WORD_BITS] &= ~emptiness_mask(0, end - lba);
+}
+
+/**
+ * @brief Flag count logical pages from lba as empty again
+ */
+void clear_pages_written(unsigned long lba, unsigned long count) {
+  clear_page_bits(current->logical_to_emptiness, lba, count);
+}
+
+/**
+ * @brief Check if the data block page of a logical page may still hold a
+ *        trimmed copy, so the page must not be written in place
+ */
+bool check_page_trimmed(unsigned long lba) {
+  uint64_t flag = current->logical_to_trimmed[lba / EMPTINESS_WORD_BITS];
+  return (((flag >> (lba % EMPTINESS_WORD_BITS)) & 1) == 1);
+}
+
+/**
+ * @brief Flag the input logical address as trimmed
+ */
+void set_page_trimmed(unsigned long lba) {
+  current->logical_to_trimmed[lba / EMPTINESS_WORD_BITS] |=
+    ((uint64_t)1 << (lba % EMPTINESS_WORD_BITS));
+}
+
+/**
+ * @brief Forget the trimmed copies of count logical pages from lba once their
+ *        data block pages are free again
+ */
+void clear_pages_trimmed(unsigned long lba, unsigned long count) {
+  clear_page_bits(current->logical_to_trimmed, lba, count);
+}
+
+/**
+ * @brief Append a block to the back of a list
+ */
+void list_push_back(block_list *list, int *prev, int *next, unsigned int block) {
+  prev[block] = list->tail;
+  next[block] = -1;
+  if (list->tail >= 0)
+    next[list->tail] = block;
+  else
+    list->head = block;
+  list->tail = block;
+}
+
+/**
+ * @brief Unlink a block from a list
+ */
+void list_remove(block_list *list, int *prev, int *next, unsigned int block) {
+  if (prev[block] >= 0)
+    next[prev[block]] = next[block];
+  else
+    list->head = next[block];
+  if (next[block] >= 0)
+    prev[next[block]] = prev[block];
+  else
+    list->tail = prev[block];
+  prev[block] = next[block] = -1;
+}
+
+/**
+ * @brief Count the live pages of the logical block on a physical data block
+ */
+unsigned int pair_live_pages(unsigned int nth_data_block) {
+  int nth_logical_block = current->physical_to_logical[nth_data_block];
+  if (nth_logical_block < 0)
+    return 0;
+  return count_pages_written(((unsigned long)nth_logical_block) * BLOCK_PAGES, BLOCK_PAGES);
+}
+
+/**
+ * @brief Add a data block that was just mapped to a log block to the victim
+ *        candidates
+ */
+void track_pair(unsigned int nth_data_block) {
+  if (current->pair_live[nth_data_block] >= 0)
+    return;
+  list_push_back(&current->fifo_pairs, current->fifo_prev, current->fifo_next, nth_data_block);
+  current->pair_live[nth_data_block] = pair_live_pages(nth_data_block);
+  list_push_back(&current->live_pairs[current->pair_live[nth_data_block]], current->live_prev, current->live_next, nth_data_block);
+  current->pair_written[nth_data_block] = current->start_time;
+}
+
+/**
+ * @brief Drop a data block that lost its log block from the victim candidates
+ */
+void untrack_pair(unsigned int nth_data_block) {
+  if (current->pair_live[nth_data_block] < 0)
+    return;
+  list_remove(&current->fifo_pairs, current->fifo_prev, current->fifo_next, nth_data_block);
+  list_remove(&current->live_pairs[current->pair_live[nth_data_block]], current->live_prev, current->live_next, nth_data_block);
+  current->pair_live[nth_data_block] = -1;
+}
+
+/**
+ * @brief Record a write to a candidate data block or its log block, moving it
+ *        to the back of its live page bucket
+ */
+void touch_pair(unsigned int nth_data_block) {
+  if (current->pair_live[nth_data_block] < 0)
+    return;
+  list_remove(&current->live_pairs[current->pair_live[nth_data_block]], current->live_prev, current->live_next, nth_data_block);
+  current->pair_live[nth_data_block] = pair_live_pages(nth_data_block);
+  list_push_back(&current->live_pairs[current->pair_live[nth_data_block]], current->live_prev, current->live_next, nth_data_block);
+  current->pair_written[nth_data_block] = current->start_time;
+}
+
+/**
+ * @brief Recount the live pages of a logical block if it is a candidate
+ */
+void refresh_pair(unsigned int nth_logical_block) {
+  touch_pair(nth_logical_block + current->logical_to_physical[nth_logical_block]);
+}
+
+unsigned long check_physical_address(unsigned long logical_address) {
+  unsigned page = logical_address % BLOCK_PAGES;
+  int nth_logical_block = (int)(logical_address / BLOCK_PAGES);
+  int offset = current->logical_to_physical[nth_logical_block];
+  int nth_physical_block = nth_logical_block + offset;
+  return page + ((unsigned long)nth_physical_block) * BLOCK_PAGES;
+}
+
+void set_physical_address(unsigned long logical_address, unsigned long physical_address) {
+  int nth_logical_block = (int)(logical_address / BLOCK_PAGES);
+  int nth_physical_block = (int)(physical_address / BLOCK_PAGES);
+  // release the reverse mapping of the previous physical block
+  int old_physical_block = nth_logical_block + current->logical_to_physical[nth_logical_block];
+  if (current->physical_to_logical[old_physical_block] == nth_logical_block)
+    current->physical_to_logical[old_physical_block] = -1;
+  current->logical_to_physical[nth_logical_block] = (nth_physical_block - nth_logical_block);
+  current->physical_to_logical[nth_physical_block] = nth_logical_block;
+  heap_update(&current->empty_heap, nth_logical_block);
+  heap_update(&current->worn_empty_heap, nth_logical_block);
+  refresh_unlogged(nth_logical_block);
+  // the live pages moved with the logical block
+  touch_pair(old_physical_block);
+  touch_pair(nth_physical_block);
+}
+
+bool check_log_block(unsigned long data_address, unsigned long *log_address) {
+  unsigned page = data_address % BLOCK_PAGES;
+  int nth_data_block = (int)(data_address / BLOCK_PAGES);
+  int offset = current->data_to_log[nth_data_block];
+  if (offset == 0) // data block to log block mapping cannot be 0
+    return false;
+  int nth_log_block = nth_data_block + offset;
+  *log_address = page + ((unsigned long)nth_log_block) * BLOCK_PAGES;
+  return true;
+}
+
+void set_log_block(unsigned long data_address, unsigned long log_address) {
+  int nth_data_block = (int)(data_address / BLOCK_PAGES);
+  int nth_log_block = (int)(log_address / BLOCK_PAGES);
+  // release the reverse mapping of the previous log block
+  int old_log_block = nth_data_block + current->data_to_log[nth_data_block];
+  if (old_log_block != nth_data_block && current->log_to_data[old_log_block] == nth_data_block)
+    current->log_to_data[old_log_block] = -1;
+  current->data_to_log[nth_data_block] = (nth_log_block - nth_data_block);
+  // a data block mapped to itself has no log block
+  if (nth_log_block != nth_data_block) {
+    current->counters.log_block_allocations++;
+    current->log_to_data[nth_log_block] = nth_data_block;
+    heap_insert(&current->pair_heap, nth_data_block);
+    heap_update(&current->pair_heap, nth_data_block);
+    track_pair(nth_data_block);
+  }
+  else {
+    heap_remove(&current->pair_heap, nth_data_block);
+    untrack_pair(nth_data_block);
+  }
+  if (current->physical_to_logical[nth_data_block] >= 0)
+    refresh_unlogged(current->physical_to_logical[nth_data_block]);
+}
+
+/**
+ * @brief Return the descriptor bound to the log block, NULL if none
+ */
+log_block_desc *fetch_log_desc(unsigned long log_address) {
+  int desc = current->log_to_desc[log_address / BLOCK_PAGES];
+  if (desc < 0)
+    return NULL;
+  return &current->log_descs[desc];
+}
+
+/**
+ * @brief Bind an empty descriptor to the log block
+ */
+void open_log_desc(unsigned long log_address) {
+  unsigned long nth_log_block = log_address / BLOCK_PAGES;
+  if (current->log_to_desc[nth_log_block] < 0) {
+    assert(!current->free_log_descs.empty());
+    current->log_to_desc[nth_log_block] = current->free_log_descs.back();
+    current->free_log_descs.pop_back();
+  }
+  // forget every page previously written to the log block
+  log_block_desc *desc = &current->log_descs[current->log_to_desc[nth_log_block]];
+  desc->cursor = 0;
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++)
+    desc->latest[i] = NO_LOG_PAGE;
+}
+
+/**
+ * @brief Return the descriptor of the log block to the pool
+ */
+void close_log_desc(unsigned long log_address) {
+  unsigned long nth_log_block = log_address / BLOCK_PAGES;
+  if (current->log_to_desc[nth_log_block] < 0)
+    return;
+  current->free_log_descs.push_back(current->log_to_desc[nth_log_block]);
+  current->log_to_desc[nth_log_block] = -1;
+}
+
+/**
+ * @brief Record the data page as written to the next free log page
+ */
+void append_log_page(unsigned long log_address, unsigned int data_page) {
+  log_block_desc *desc = fetch_log_desc(log_address);
+  assert(desc != NULL && desc->cursor < BLOCK_PAGES);
+  desc->latest[data_page] = desc->cursor;
+  desc->cursor++;
+  if (current->log_to_data[log_address / BLOCK_PAGES] >= 0)
+    touch_pair(current->log_to_data[log_address / BLOCK_PAGES]);
+}
+
+/**
+ * @brief Forget the log copy of a trimmed data page
+ */
+void drop_log_page(unsigned long log_address, unsigned int data_page) {
+  log_block_desc *desc = fetch_log_desc(log_address);
+  if (desc != NULL)
+    desc->latest[data_page] = NO_LOG_PAGE;
+}
+
+/**
+ * @brief Return the number of log blocks bound to a descriptor
+ */
+unsigned int num_log_descs_used(void) {
+  return current->num_log_descs - (unsigned int)current->free_log_descs.size();
+}
+
+void cancel_log_block(unsigned long data_address) {
+  unsigned long log_address;
+  if (check_log_block(data_address, &log_address)) {
+    close_log_desc(log_address);
+  }
+  // this will clear the offset to 0
+  set_log_block(data_address, data_address);
+}
+
+/**
+ * @brief Fetch the most recent copy of the page in log block
+ *        corresponding to the page in data block
+ */
+bool fetch_log_page(unsigned long log_address,
+                    unsigned int data_page,
+                    unsigned int *log_page) {
+  log_block_desc *desc = fetch_log_desc(log_address);
+  if (desc == NULL || desc->latest[data_page] == NO_LOG_PAGE) {
+    return false;
+  }
+  *log_page = desc->latest[data_page];
+  return true;
+}
+
+/**
+ * @brief Find the next free page in log block
+ */
+bool next_free_log_page(unsigned long log_address, unsigned int *page) {
+  log_block_desc *desc = fetch_log_desc(log_address);
+  if (desc == NULL || desc->cursor >= BLOCK_PAGES) {
+    // no more empty pages in log block
+    return false;
+  }
+  *page = desc->cursor;
+  return true;
+}
+
+/**
+ * @brief Return the bytes of RAM taken by the mapping tables
+ */
+unsigned long mapping_ram_bytes(void) {
+  if (FTL_MODE == SHARED_LOGS) {
+    // the block map plus a logical and physical page for every log page
+    return (unsigned long)NUM_OF_LGC_B * sizeof(int)
+      + (unsigned long)NUM_OF_OP_B * BLOCK_PAGES * 2 * sizeof(unsigned int);
+  }
+  if (FTL_MODE == PAGE_MAPPED) {
+    // a cached entry keeps its logical page next to the physical page
+    if (MAP_CACHE_SIZE > 0)
+      return (unsigned long)MAP_CACHE_SIZE * 2 * sizeof(unsigned int);
+    return (unsigned long)USABLE_SIZE * sizeof(unsigned int);
+  }
+  return (unsigned long)NUM_OF_LGC_B * sizeof(int) + NUM_OF_PHY_B * sizeof(int)
+    + (unsigned long)current->num_log_descs * (BLOCK_PAGES + 1) * sizeof(unsigned int);
+}
+
+void Ftl::print_info(void) {
+  ftl_scope scope(state);
+  fprintf(log_file, "mapping tables take %lu bytes of RAM\n", mapping_ram_bytes());
+  fprintf(log_file, "%lu host reads, %lu writes, %lu pages trimmed\n",
+    current->counters.host_reads, current->counters.host_writes, current->counters.host_trims);
+  fprintf(log_file, "%lu gc page copies (%lu copybacks), %lu erases, %lu log blocks allocated\n",
+    current->counters.gc_page_copies, current->counters.copybacks, current->counters.erases, current->counters.log_block_allocations);
+  fprintf(log_file, "%lu switch merges, %lu partial merges, %lu full merges\n",
+    current->counters.switch_merges, current->counters.partial_merges, current->counters.full_merges);
+  if (FTL_MODE == PAGE_MAPPED) {
+    fprintf(log_file, "%lu mapping cache hits, %lu misses\n", current->map_hits, current->map_misses);
+    fprintf(log_file, "%lu translation page reads, %lu writes\n",
+      current->map_page_reads, current->map_page_writes);
+    fprintf(log_file, "free blocks left %lu\n", (unsigned long)current->op_blocks.size());
+    return;
+  }
+  if (FTL_MODE == SHARED_LOGS) {
+    fprintf(log_file, "%lu random log blocks, sequential log block %s\n",
+      (unsigned long)current->random_logs.size(), current->seq_log == RAW_SIZE ? "free" : "used");
+    fprintf(log_file, "free blocks left %lu\n", (unsigned long)current->op_blocks.size());
+    return;
+  }
+  unsigned int count = 0;
+  for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
+    if (check_block_empty(i))
+      count++;
+  }
+  if (count != current->empty_heap.size)
+    fprintf(log_file, "Ftl error: %s: %u empty data blocks but the empty block heap holds %u\n",
+      __func__, count, current->empty_heap.size);
+  fprintf(log_file, "%u empty data blocks\n", count);
+  if (HEAT_HALF_LIFE > 0) {
+    unsigned int hot = 0;
+    for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
+      if (block_temperature(i) == TEMP_HOT)
+        hot++;
+    }
+    fprintf(log_file, "%u hot logical blocks\n", hot);
+  }
+  // tally erase counts in one pass instead of one pass per possible count
+  std::map<unsigned long, unsigned int> data_erases;
+  std::map<unsigned long, unsigned int> log_erases;
+  std::map<unsigned long, unsigned int>::iterator it;
+  for (unsigned int logical_b = 0; logical_b < NUM_OF_LGC_B; logical_b++) {
+    unsigned long data_address = check_physical_address(logical_b * BLOCK_PAGES);
+    unsigned long log_address;
+    data_erases[current->erase_count[data_address / BLOCK_PAGES]]++;
+    if (check_log_block(data_address, &log_address))
+      log_erases[current->erase_count[log_address / BLOCK_PAGES]]++;
+  }
+  for (it = data_erases.begin(); it != data_erases.end(); it++)
+    fprintf(log_file, "%u data blocks have %lu erases\n", it->second, it->first);
+  fprintf(log_file, "total # of op blocks %d\n", (int)NUM_OF_OP_B);
+  fprintf(log_file, "free op blocks left %lu\n", (unsigned long)current->op_blocks.size());
+  int big_sum = 0;
+  for (it = log_erases.begin(); it != log_erases.end(); it++) {
+    fprintf(log_file, "%u log blocks have %lu erases\n", it->second, it->first);
+    big_sum += it->second;
+  }
+  if ((unsigned int)big_sum != num_log_descs_used())
+    fprintf(log_file, "wrong\n");
+  fprintf(log_file, "log blocks used %d\n", big_sum);
+}
+
+/**
+ * @brief Check if the block exceeds erase limit
+ */
+bool over_erase_limit(unsigned long physical_address) {
+  return (current->erase_count[physical_address / BLOCK_PAGES] >= BLOCK_ERASES);
+}
+
+unsigned int free_stripe(unsigned int nth_physical_block);
+
+/**
+ * @brief Update the erase count for a block
+ */
+void update_erase_count(unsigned long physical_address) {
+  unsigned long nth_physical_block = physical_address / BLOCK_PAGES;
+  (current->erase_count[nth_physical_block]) += 1;
+  // keep the block heaps ordered by erase count
+  int nth_logical_block = current->physical_to_logical[nth_physical_block];
+  if (nth_logical_block >= 0) {
+    heap_update(&current->empty_heap, nth_logical_block);
+    heap_update(&current->worn_empty_heap, nth_logical_block);
+    heap_update(&current->unlogged_heap, nth_logical_block);
+  }
+  heap_update(&current->pair_heap, nth_physical_block);
+  if (current->log_to_data[nth_physical_block] >= 0)
+    heap_update(&current->pair_heap, current->log_to_data[nth_physical_block]);
+  if (current->free_slot != NULL && current->free_slot[nth_physical_block] >= 0) {
+    unsigned int stripe = free_stripe(nth_physical_block);
+    heap_update(&current->free_fewest[stripe], nth_physical_block);
+    heap_update(&current->free_most[stripe], nth_physical_block);
+    heap_update(&current->free_recent[stripe], nth_physical_block);
+  }
+}
+
+/**
+ * @brief Find the empty logical block whose data block has the fewest erases
+ */
+bool find_empty_data_block_for_remapping(unsigned long *empty_data_address,
+                                         unsigned long *empty_logical_block) {
+  if (current->empty_heap.size == 0)
+    return false;
+  unsigned int nth_logical_block = current->empty_heap.data[0];
+  if (logical_erase_count(nth_logical_block) >= BLOCK_ERASES)
+    return false;
+  *empty_logical_block = nth_logical_block * BLOCK_PAGES;
+  *empty_data_address = check_physical_address(nth_logical_block * BLOCK_PAGES);
+  return true;
+}
+
+/**
+ * @brief Find the empty logical block whose data block has the most erases
+ *        below the limit, else the one with the fewest erases
+ */
+bool find_worn_empty_data_block(unsigned long *empty_data_address,
+                                unsigned long *empty_logical_block) {
+  if (current->worn_empty_heap.size == 0)
+    return false;
+  unsigned int nth_logical_block = current->worn_empty_heap.data[0];
+  if (logical_erase_count(nth_logical_block) >= BLOCK_ERASES)
+    return find_empty_data_block_for_remapping(empty_data_address, empty_logical_block);
+  *empty_logical_block = nth_logical_block * BLOCK_PAGES;
+  *empty_data_address = check_physical_address(nth_logical_block * BLOCK_PAGES);
+  return true;
+}
+
+bool find_empty_data_block_for_cleaning(unsigned long *empty_data_address) {
+  unsigned long empty_logical_block;
+  return find_empty_data_block_for_remapping(empty_data_address, &empty_logical_block);
+}
+
+/**
+ * @brief Returns the numerical mapping from physical address to SSD address
+ *
+ * With BLOCK_STRIPING consecutive physical blocks go round the packages, then
+ * the dies of each package, then the planes of each die.
+ */
+void map_physical_to_SSD(unsigned long phy,
+                         unsigned int *package, unsigned int *die, 
+                         unsigned int *plane, unsigned int *block, unsigned int *page) {
+  if (BLOCK_STRIPING)
+    current->geometry.split_striped(phy, package, die, plane, block, page);
+  else
+    current->geometry.split(phy, package, die, plane, block, page);
+}
+
+/**
+ * @brief Return the die of a physical block, numbered across the packages
+ */
+unsigned int block_die(unsigned long nth_physical_block) {
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int page;
+  map_physical_to_SSD(nth_physical_block * BLOCK_PAGES, &package, &die, &plane, &block, &page);
+  return package * current->geometry.get_package_size() + die;
+}
+
+/**
+ * @brief Check if a free block should be handed out before another one, for
+ *        a logical block of the given temperature whose data block is
+ *        data_block, -1 if none
+ */
+bool free_block_before(unsigned long a, unsigned long b,
+                       enum temperature temp, int data_block) {
+  if (BLOCK_STRIPING && data_block >= 0) {
+    bool apart_a = (block_die(a / BLOCK_PAGES) != block_die(data_block));
+    bool apart_b = (block_die(b / BLOCK_PAGES) != block_die(data_block));
+    if (apart_a != apart_b)
+      return apart_a;
+  }
+  if (temp == TEMP_HOT)
+    return current->erase_count[a / BLOCK_PAGES] < current->erase_count[b / BLOCK_PAGES];
+  if (temp == TEMP_COLD)
+    return current->erase_count[a / BLOCK_PAGES] > current->erase_count[b / BLOCK_PAGES];
+  return false;
+}
+
+/**
+ * @brief Order free blocks a and b the way free_block_before does for a
+ *        temperature, worn out blocks last and the latest freed first
+ */
+bool free_recent_before(unsigned int a, unsigned int b) {
+  bool worn_a = (current->erase_count[a] >= BLOCK_ERASES);
+  bool worn_b = (current->erase_count[b] >= BLOCK_ERASES);
+  if (worn_a != worn_b)
+    return worn_b;
+  return current->free_slot[a] > current->free_slot[b];
+}
+
+bool free_fewest_before(unsigned int a, unsigned int b) {
+  if ((current->erase_count[a] >= BLOCK_ERASES) == (current->erase_count[b] >= BLOCK_ERASES)
+      && current->erase_count[a] != current->erase_count[b])
+    return current->erase_count[a] < current->erase_count[b];
+  return free_recent_before(a, b);
+}
+
+bool free_most_before(unsigned int a, unsigned int b) {
+  if ((current->erase_count[a] >= BLOCK_ERASES) == (current->erase_count[b] >= BLOCK_ERASES)
+      && current->erase_count[a] != current->erase_count[b])
+    return current->erase_count[a] > current->erase_count[b];
+  return free_recent_before(a, b);
+}
+
+/**
+ * @brief Return the stripe of the free block heaps a physical block is in
+ */
+unsigned int free_stripe(unsigned int nth_physical_block) {
+  return BLOCK_STRIPING ? block_die(nth_physical_block) : 0;
+}
+
+/**
+ * @brief Add a free block to the heaps of its stripe
+ */
+void index_free_block(unsigned int nth_physical_block) {
+  unsigned int stripe = free_stripe(nth_physical_block);
+  heap_insert(&current->free_fewest[stripe], nth_physical_block);
+  heap_insert(&current->free_most[stripe], nth_physical_block);
+  heap_insert(&current->free_recent[stripe], nth_physical_block);
+}
+
+/**
+ * @brief Index every block of op_blocks in the free block heaps, if they are
+ *        kept
+ */
+void index_free_blocks(void) {
+  if (current->free_slot == NULL)
+    return;
+  for (unsigned int i = 0; i < NUM_OF_PHY_B; i++) {
+    current->free_slot[i] = -1;
+    current->free_fewest[0].pos[i] = current->free_most[0].pos[i] = current->free_recent[0].pos[i] = -1;
+  }
+  for (unsigned int i = 0; i < current->num_stripes; i++)
+    current->free_fewest[i].size = current->free_most[i].size = current->free_recent[i].size = 0;
+  for (unsigned int i = 0; i < current->op_blocks.size(); i++) {
+    current->free_slot[current->op_blocks[i] / BLOCK_PAGES] = i;
+    index_free_block(current->op_blocks[i] / BLOCK_PAGES);
+  }
+}
+
+/**
+ * @brief Return an erased block to op_blocks
+ */
+void push_free_block(unsigned long physical_address) {
+  current->op_blocks.push_back(physical_address);
+  if (current->free_slot == NULL)
+    return;
+  current->free_slot[physical_address / BLOCK_PAGES] = current->op_blocks.size() - 1;
+  index_free_block(physical_address / BLOCK_PAGES);
+}
+
+/**
+ * @brief Take the free block at a slot of op_blocks, the last block moves
+ *        into its slot
+ */
+unsigned long take_free_block(unsigned int slot) {
+  unsigned long taken = current->op_blocks[slot];
+  unsigned long last = current->op_blocks.back();
+  current->op_blocks[slot] = last;
+  current->op_blocks.pop_back();
+  if (current->free_slot == NULL)
+    return taken;
+  unsigned int stripe = free_stripe(taken / BLOCK_PAGES);
+  heap_remove(&current->free_fewest[stripe], taken / BLOCK_PAGES);
+  heap_remove(&current->free_most[stripe], taken / BLOCK_PAGES);
+  heap_remove(&current->free_recent[stripe], taken / BLOCK_PAGES);
+  current->free_slot[taken / BLOCK_PAGES] = -1;
+  if (last != taken) {
+    stripe = free_stripe(last / BLOCK_PAGES);
+    current->free_slot[last / BLOCK_PAGES] = slot;
+    heap_update(&current->free_fewest[stripe], last / BLOCK_PAGES);
+    heap_update(&current->free_most[stripe], last / BLOCK_PAGES);
+    heap_update(&current->free_recent[stripe], last / BLOCK_PAGES);
+  }
+  return taken;
+}
+
+/**
+ * @brief Take the latest freed block of op_blocks
+ */
+unsigned long pop_free_block(void) {
+  return take_free_block(current->op_blocks.size() - 1);
+}
+
+/**
+ * @brief Return the slot in op_blocks of the free block free_block_before
+ *        puts first, -1 if every free block is worn out
+ *
+ * Only the top of each stripe's heap is compared, so the cost grows with the
+ * number of dies rather than with the number of free blocks.
+ */
+int pick_free_block(enum temperature temp, int data_block) {
+  block_heap *heaps = current->free_recent;
+  if (temp == TEMP_HOT)
+    heaps = current->free_fewest;
+  else if (temp == TEMP_COLD)
+    heaps = current->free_most;
+  int data_stripe = (BLOCK_STRIPING && data_block >= 0) ? (int)block_die(data_block) : -1;
+  int best = -1;
+  bool best_apart = false;
+  for (unsigned int i = 0; i < current->num_stripes; i++) {
+    if (heaps[i].size == 0)
+      continue;
+    unsigned int block = heaps[i].data[0];
+    if (current->erase_count[block] >= BLOCK_ERASES)
+      continue;
+    bool apart = ((int)i != data_stripe);
+    if (best < 0 || (apart && !best_apart) ||
+        (apart == best_apart && heaps[i].before(block, best))) {
+      best = block;
+      best_apart = apart;
+    }
+  }
+  return (best < 0) ? -1 : current->free_slot[best];
+}
+
+/**
+ * @brief Garbage collection events waiting to be issued as one event list
+ */
+struct event_chain {
+  Event *head;
+  Event *tail;
+};
+
+/**
+ * @brief Append an event for the page or block at address to the chain
+ */
+void chain_event(Ftl &ftl, event_chain *chain, enum event_type type,
+                 unsigned long logical_address, const Address &address) {
+  Event *event = ftl.controller.new_event(type, logical_address, 1, current->start_time);
+  event->set_address(address);
+  if (type == ERASE)
+    current->counters.erases++;
+  if (chain->head == NULL)
+    chain->head = event;
+  else
+    chain->tail->set_next(*event);
+  chain->tail = event;
+}
+
+/**
+ * @brief Append a copy of the page at src to the page at des to the chain
+ *
+ * A copy within one plane is a single copyback (MERGE) event that moves the
+ * page through the plane register, otherwise the page is read out over the
+ * bus and written back.
+ */
+void chain_copy(Ftl &ftl, event_chain *chain, unsigned long logical_address,
+                const Address &src, const Address &des) {
+  current->counters.gc_page_copies++;
+  if (src.compare(des) >= PLANE) {
+    current->counters.copybacks++;
+    chain_event(ftl, chain, MERGE, logical_address, src);
+    chain->tail->set_merge_address(des);
+    return;
+  }
+  chain_event(ftl, chain, READ, logical_address, src);
+  chain_event(ftl, chain, WRITE, logical_address, des);
+}
+
+/**
+ * @brief Issue the chained events in one pass and return them to the pool
+ *
+ * The copies are independent, so a failed one does not stop the rest.
+ */
+void issue_chain(Ftl &ftl, event_chain *chain) {
+  if (chain->head == NULL)
+    return;
+  ftl.controller.issue(*chain->head, false);
+  for (Event *cur = chain->head; cur != NULL; cur = cur->get_next()) {
+    if (cur->get_finish_time() > current->gc_finish_time)
+      current->gc_finish_time = cur->get_finish_time();
+  }
+  ftl.controller.free_events(*chain->head);
+  chain->head = NULL;
+  chain->tail = NULL;
+}
+
+bool Garbage_collector::shuffle_data_log(void) {
+  ftl_scope scope(ftl.state);
+  // find a log/data block pair with at most BLOCK_ERASES - 1 erases
+  if (current->pair_heap.size == 0) return false;
+  unsigned int nth_data_block = current->pair_heap.data[0];
+  unsigned long max_erase_data = ((unsigned long)nth_data_block) * BLOCK_PAGES;
+  unsigned long max_erase_log;
+  check_log_block(max_erase_data, &max_erase_log);
+  if (current->erase_count[max_erase_log / BLOCK_PAGES] == BLOCK_ERASES ||
+      current->erase_count[nth_data_block] == BLOCK_ERASES) return false;
+  // find the corresponding logical block
+  if (current->physical_to_logical[nth_data_block] < 0) return false;
+  unsigned long logical_block = ((unsigned long)current->physical_to_logical[nth_data_block]) * BLOCK_PAGES;
+  
+  // find a data block (unmapped to log block) with the fewest erases
+  if (current->unlogged_heap.size == 0) return false;
+  unsigned int nth_logical_block = current->unlogged_heap.data[0];
+  unsigned long min_erase_data = check_physical_address(nth_logical_block * BLOCK_PAGES);
+  unsigned int min_count = current->erase_count[min_erase_data / BLOCK_PAGES];
+  if (min_count >= BLOCK_ERASES - 1) return false;
+  
+  // free up one block of the pair, the old data block after a switch
+  unsigned long freed = max_erase_log;
+  if (switch_merge(logical_block, max_erase_data, max_erase_log))
+    freed = max_erase_data;
+  else if (clean(logical_block, max_erase_data, max_erase_log) == false)
+    return false;
+  
+  // cleaning may have moved the least worn logical block to another data block
+  logical_block = ((unsigned long)nth_logical_block) * BLOCK_PAGES;
+  min_erase_data = check_physical_address(logical_block);
+  
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  event_chain chain = {NULL, NULL};
+  // move pages from data block to log block
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++) {
+    // move the page if only it is a written page
+    if (!check_page_empty(logical_block + i)) {
+      map_physical_to_SSD(min_erase_data, &package, &die, &plane, &block, &dummy);
+      Address src_addr = Address(package, die, plane, block, i, PAGE);
+      map_physical_to_SSD(freed, &package, &die, &plane, &block, &dummy);
+      Address des_addr = Address(package, die, plane, block, i, PAGE);
+      chain_copy(ftl, &chain, logical_block + i, src_addr, des_addr);
+    }
+  }
+  
+  // erase data block
+  map_physical_to_SSD(min_erase_data, &package, &die, &plane, &block, &dummy);
+  Address data_addr = Address(package, die, plane, block, 0, BLOCK);
+  chain_event(ftl, &chain, ERASE, logical_block, data_addr);
+  issue_chain(ftl, &chain);
+  clear_pages_trimmed(logical_block, BLOCK_PAGES);
+  
+  // now the data block becomes new unmapped log block, and the log
+  // block becomes the data block
+  set_physical_address(logical_block, freed);
+  push_free_block(min_erase_data);
+  
+  FTL_LOG(1, log_file,
+    "[shuffle_data_log] log block %lu <-> data block %lu\n", freed, min_erase_data);
+  
+  return true;
+}
+
+/**
+ * @brief Take a free block for a logical block of the given temperature
+ *        whose data block is data_block, -1 if unknown, leaving reserved
+ *        free blocks
+ *
+ * A block on another die than the data block lets cleaning copies overlap,
+ * a hot logical block takes the least worn block, since its log block is
+ * erased most often, and a cold one the most worn block still usable,
+ * otherwise the last freed block is taken.
+ */
+bool take_unmapped_block(unsigned long *physical_address, enum temperature temp,
+                         int data_block, unsigned int reserved) {
+  if ((temp != TEMP_UNKNOWN || (BLOCK_STRIPING && data_block >= 0)) && current->op_blocks.size() > reserved) {
+    int pick = pick_free_block(temp, data_block);
+    if (pick >= 0) {
+      *physical_address = take_free_block(pick);
+      return true;
+    }
+  }
+  
+  while (current->op_blocks.size() > reserved) {
+    *physical_address = pop_free_block();
+    if (!over_erase_limit(*physical_address))
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Find next unmapped log block
+ *
+ * The last free block is kept as the merge target of clean for when no empty
+ * data block is left, so a full device still makes room by cleaning.
+ */
+bool Garbage_collector::next_unmapped_log_block(unsigned long *log_address,
+                                  unsigned int *package, unsigned int *die, 
+                                  unsigned int *plane, unsigned int *block,
+                                  enum temperature temp, int data_block) {
+  ftl_scope scope(ftl.state);
+  if (current->op_blocks.size() <= 1) {
+    // clean the victim of the GC policy, fall back on a shuffle when no pair
+    // can be cleaned
+    if (reclaim_log_block((enum GC_POLICY)SELECTED_GC_POLICY) == false &&
+        shuffle_data_log() == false)
+      return false;
+  }
+  
+  unsigned int dummy;
+  if (take_unmapped_block(log_address, temp, data_block, 1) == false) {
+    FTL_LOG(1, log_file, "[next_unmapped_log_block] no free block left\n");
+    return false;
+  }
+  map_physical_to_SSD(*log_address, package, die, plane, block, &dummy);
+  return true;
+}
+
+unsigned long Garbage_collector::remap_data_block(unsigned long logical_block,
+                                                  unsigned long old_data_pba,
+                                                  unsigned long log_pba) {
+  ftl_scope scope(ftl.state);
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  unsigned long new_data_pba;
+  unsigned long new_logical_block = RAW_SIZE;
+  
+  // check if a block available
+  if (find_empty_data_block_for_remapping(&new_data_pba, &new_logical_block) == false) {
+    FTL_LOG(1, log_file, "[remap_data_block] no empty data block left\n");
+    if (next_unmapped_log_block(&new_data_pba, &package, &die, &plane, &block) == false) {
+      FTL_LOG(1, log_file, "[remap_data_block] no log block left\n");
+      return log_pba;
+    }
+  }
+
+  // copy pages from old data block to new data block
+  event_chain chain = {NULL, NULL};
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++) {
+    // move the page if only it is a written page
+    if (!check_page_empty(logical_block + i)) {
+      // find if the latest copy
+      unsigned int log_page;
+      if (!fetch_log_page(log_pba, i, &log_page)) {
+        // read from latest copy of page in data block
+        map_physical_to_SSD(old_data_pba, &package, &die, &plane, &block, &dummy);
+        Address src_addr = Address(package, die, plane, block, i, PAGE);
+        map_physical_to_SSD(new_data_pba, &package, &die, &plane, &block, &dummy);
+        Address des_addr = Address(package, die, plane, block, i, PAGE);
+        chain_copy(ftl, &chain, logical_block + i, src_addr, des_addr);
+      }
+    }
+  }
+  
+  issue_chain(ftl, &chain);
+  clear_pages_trimmed(logical_block, BLOCK_PAGES);
+  FTL_LOG(1, log_file, "[remap_data_block] moved pages to new data block\n");
+  
+  if (new_logical_block != RAW_SIZE)
+    set_physical_address(new_logical_block, old_data_pba);
+  set_physical_address(logical_block, new_data_pba);
+  set_log_block(old_data_pba, old_data_pba);
+  set_log_block(new_data_pba, log_pba);
+  
+  return new_data_pba;
+}
+
+unsigned long Garbage_collector::remap_log_block(unsigned long logical_block,
+                                                 unsigned long data_pba,
+                                                 unsigned long old_log_pba) {
+  ftl_scope scope(ftl.state);
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  unsigned long new_log_pba;
+  
+  // check if a unmapped log block available
+  if (next_unmapped_log_block(&new_log_pba, &package, &die, &plane, &block,
+                              block_temperature(logical_block / BLOCK_PAGES),
+                              data_pba / BLOCK_PAGES) == false) {
+    FTL_LOG(1, log_file, "[remap_log_block] no log block left\n");
+    return data_pba;
+  }
+
+  // copy pages from old log block to new log block
+  open_log_desc(new_log_pba);
+  event_chain chain = {NULL, NULL};
+  unsigned int j = 0;
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++) {
+    // move the page if only it is a written page
+    if (!check_page_empty(logical_block + i)) {
+      // find if the latest copy
+      unsigned int log_page;
+      if (fetch_log_page(old_log_pba, i, &log_page)) {
+        // read from latest copy of page in log block
+        map_physical_to_SSD(old_log_pba, &package, &die, &plane, &block, &dummy);
+        Address src_addr = Address(package, die, plane, block, log_page, PAGE);
+        map_physical_to_SSD(new_log_pba, &package, &die, &plane, &block, &dummy);
+        Address des_addr = Address(package, die, plane, block, j, PAGE);
+        chain_copy(ftl, &chain, logical_block + i, src_addr, des_addr);
+        j++;
+        append_log_page(new_log_pba, i);
+      }
+    }
+  }
+  
+  issue_chain(ftl, &chain);
+  FTL_LOG(1, log_file, "[remap_log_block] moved pages to new log block\n");
+  
+  cancel_log_block(data_pba);
+  set_log_block(data_pba, new_log_pba);
+  
+  return new_log_pba;
+}
+
+/**
+ * @brief Merge the data block and log block into an empty data block, or into
+ *        a free block once no empty data block is left
+ *
+ * The logical block is remapped to the merged block, and the erased data block
+ * takes the place of the empty data block, or goes back to the free blocks.
+ * The log block is erased and left unmapped for the caller to reuse.
+ */
+bool Garbage_collector::clean(unsigned long logical_block,
+                              unsigned long data_pba, unsigned long log_pba) {
+  ftl_scope scope(ftl.state);
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  unsigned long cln_pba;
+  unsigned long empty_logical_block;
+  
+  // calculate log block 
+  map_physical_to_SSD(log_pba, &package, &die, &plane, &block, &dummy);
+  Address log_addr = Address(package, die, plane, block, 0, BLOCK);
+ 
+  // calculate data block
+  map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
+  Address data_addr = Address(package, die, plane, block, 0, BLOCK);
+  
+  // check if a unmapped cleaning block available, cold data goes to a worn one
+  bool found;
+  enum temperature temp = block_temperature(logical_block / BLOCK_PAGES);
+  if (temp == TEMP_COLD)
+    found = find_worn_empty_data_block(&cln_pba, &empty_logical_block);
+  else
+    found = find_empty_data_block_for_remapping(&cln_pba, &empty_logical_block);
+  // a full device merges into a free block instead
+  if (found == false) {
+    empty_logical_block = RAW_SIZE;
+    if (take_unmapped_block(&cln_pba, temp, data_pba / BLOCK_PAGES, 0) == false) {
+      FTL_LOG(1, log_file, "[clean] no empty data block or free block left\n");
+      return false;
+    }
+  }
+  
+  FTL_LOG(1, log_file, "[clean] data block %lu, log block %lu into block %lu\n",
+    data_pba, log_pba, cln_pba);
+  
+  // copy live pages from data block and log block to cleaning block
+  event_chain chain = {NULL, NULL};
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++) {
+    // move the page if only it is a written page
+    if (!check_page_empty(logical_block + i)) {
+      // find if the latest copy
+      unsigned int log_page;
+      Address src_addr;
+      if (fetch_log_page(log_pba, i, &log_page)) {
+        // read from latest copy of page in log block
+        map_physical_to_SSD(log_pba, &package, &die, &plane, &block, &dummy);
+        src_addr = Address(package, die, plane, block, log_page, PAGE);
+      }
+      else {
+        // read from latest copy in data block
+        map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
+        src_addr = Address(package, die, plane, block, i, PAGE);
+      }
+      map_physical_to_SSD(cln_pba, &package, &die, &plane, &block, &dummy);
+      Address des_addr = Address(package, die, plane, block, i, PAGE);
+      chain_copy(ftl, &chain, logical_block + i, src_addr, des_addr);
+    }
+  }
+  
+  // erase data block
+  chain_event(ftl, &chain, ERASE, logical_block, data_addr);
+  // erase log block
+  chain_event(ftl, &chain, ERASE, logical_block, log_addr);
+  issue_chain(ftl, &chain);
+  clear_pages_trimmed(logical_block, BLOCK_PAGES);
+  
+  // the cleaning block becomes the data block, and the erased data block
+  // becomes the data block of the empty logical block or a free block
+  cancel_log_block(data_pba);
+  set_physical_address(logical_block, cln_pba);
+  if (empty_logical_block != RAW_SIZE)
+    set_physical_address(empty_logical_block, data_pba);
+  
+  // update erase counts
+  update_erase_count(data_pba);
+  update_erase_count(log_pba);
+  if (empty_logical_block == RAW_SIZE && !over_erase_limit(data_pba))
+    push_free_block(data_pba);
+  current->counters.full_merges++;
+  
+  return true;
+}
+
+/**
+ * @brief Check if a candidate data block and its log block can be cleaned
+ */
+bool pair_cleanable(unsigned int nth_data_block) {
+  unsigned long data_address = ((unsigned long)nth_data_block) * BLOCK_PAGES;
+  unsigned long log_address;
+  if (!check_log_block(data_address, &log_address))
+    return false;
+  return !over_erase_limit(data_address) && !over_erase_limit(log_address) &&
+         current->physical_to_logical[nth_data_block] >= 0;
+}
+
+/**
+ * @brief Return the first cleanable data block from a list position, -1 if
+ *        none
+ */
+int first_cleanable(int block, const int *next) {
+  while (block >= 0 && !pair_cleanable(block))
+    block = next[block];
+  return block;
+}
+
+/**
+ * @brief Choose the log block to clean among all mapped log blocks
+ *
+ * FIFO takes the pair mapped first and LRU the pair written least recently.
+ * GREEDY takes the pair with the fewest live pages to copy, the oldest
+ * first.  COST_BENEFIT weighs the age of the pair by the free space cleaning
+ * it wins over the pages it copies, (1 - u) / (1 + u) for utilization u.
+ * Within a live page bucket the oldest pair is the best for every policy but
+ * FIFO, so only the bucket heads are compared.
+ *
+ * Returns RAW_SIZE if no mapped log block can be cleaned.
+ */
+unsigned long Garbage_collector::next_log_block_to_clean(enum GC_POLICY policy) {
+  ftl_scope scope(ftl.state);
+  int victim = -1;
+  double best = -1.0;
+  if (policy == FIFO) {
+    victim = first_cleanable(current->fifo_pairs.head, current->fifo_next);
+  }
+  else {
+    for (unsigned int live = 0; live <= BLOCK_PAGES; live++) {
+      int block = first_cleanable(current->live_pairs[live].head, current->live_next);
+      if (block < 0)
+        continue;
+      double age = current->start_time - current->pair_written[block];
+      double score;
+      if (policy == GREEDY) {
+        victim = block;
+        break;
+      }
+      else if (policy == LRU)
+        score = age;
+      else
+        score = age * (BLOCK_PAGES - live) / (BLOCK_PAGES + live);
+      if (score > best) {
+        best = score;
+        victim = block;
+      }
+    }
+  }
+  if (victim < 0)
+    return RAW_SIZE;
+  unsigned long log_address;
+  check_log_block(((unsigned long)victim) * BLOCK_PAGES, &log_address);
+  return log_address;
+}
+
+/**
+ * @brief Clean a data/log block pair and return the log block to the
+ *        unmapped log blocks
+ */
+bool Garbage_collector::reclaim_log_block(enum GC_POLICY policy) {
+  ftl_scope scope(ftl.state);
+  unsigned long log_pba = next_log_block_to_clean(policy);
+  if (log_pba == RAW_SIZE)
+    return false;
+  unsigned long data_pba = ((unsigned long)current->log_to_data[log_pba / BLOCK_PAGES]) * BLOCK_PAGES;
+  int nth_logical_block = current->physical_to_logical[data_pba / BLOCK_PAGES];
+  if (nth_logical_block < 0)
+    return false;
+  unsigned long logical_block = ((unsigned long)nth_logical_block) * BLOCK_PAGES;
+  // the old data block is freed instead of the log block after a switch
+  if (switch_merge(logical_block, data_pba, log_pba)) {
+    push_free_block(data_pba);
+    return true;
+  }
+  if (clean(logical_block, data_pba, log_pba) == false)
+    return false;
+  push_free_block(log_pba);
+  FTL_LOG(1, log_file, "[reclaim_log_block] data block %lu freed log block %lu\n", data_pba, log_pba);
+  return true;
+}
+
+/**
+ * @brief Run one background cleaning step at time if the unmapped log blocks
+ *        are below the watermark for a busy or idle device
+ *
+ * A step cleans one data/log pair, so the engine can stop between steps when
+ * host requests arrive.
+ */
+enum status Ftl::background_collect(double time, bool idle, double *finish_time) {
+  ftl_scope scope(state);
+  unsigned long watermark = idle ? GC_HIGH_WATERMARK : GC_LOW_WATERMARK;
+  if (current->op_blocks.size() >= watermark)
+    return FAILURE;
+  current->start_time = time;
+  current->gc_finish_time = time;
+  FTL_LOG(1, log_file, "[background_collect] %lu free log blocks at %f\n",
+    (unsigned long)current->op_blocks.size(), time);
+  current->map_delay = 0.0;
+  if (FTL_MODE == PAGE_MAPPED) {
+    if (garbage.reclaim_page_block() == false)
+      return FAILURE;
+  }
+  else if (FTL_MODE == SHARED_LOGS) {
+    if (garbage.reclaim_random_log() == false)
+      return FAILURE;
+  }
+  else if (garbage.reclaim_log_block((enum GC_POLICY)SELECTED_GC_POLICY) == false)
+    return FAILURE;
+  *finish_time = current->gc_finish_time + current->map_delay;
+  return SUCCESS;
+}
+
+/**
+ * @brief Make a log block written in page order the data block
+ *
+ * If the log block holds pages 0 to n - 1 in order, the remaining written
+ * pages are copied from the data block behind them (a partial merge, none
+ * for a full log block) and the log block becomes the data block of the
+ * logical block (a switch merge).  Only the old data block is erased, and it
+ * is left unmapped for the caller to reuse.
+ *
+ * Returns false without any copies if the log block is out of order.
+ */
+bool Garbage_collector::switch_merge(unsigned long logical_block,
+                                     unsigned long data_pba, unsigned long log_pba) {
+  ftl_scope scope(ftl.state);
+  log_block_desc *desc = fetch_log_desc(log_pba);
+  if (desc == NULL || over_erase_limit(data_pba))
+    return false;
+  for (unsigned int i = 0; i < desc->cursor; i++) {
+    // a trimmed page has no copy left to keep
+    if (desc->latest[i] != i &&
+        !(check_page_empty(logical_block + i) && check_page_trimmed(logical_block + i)))
+      return false;
+  }
+
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  event_chain chain = {NULL, NULL};
+  unsigned int copied = 0;
+  // copy the written pages past the log block's prefix from the data block
+  for (unsigned int i = desc->cursor; i < BLOCK_PAGES; i++) {
+    if (!check_page_empty(logical_block + i)) {
+      map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
+      Address src_addr = Address(package, die, plane, block, i, PAGE);
+      map_physical_to_SSD(log_pba, &package, &die, &plane, &block, &dummy);
+      Address des_addr = Address(package, die, plane, block, i, PAGE);
+      chain_copy(ftl, &chain, logical_block + i, src_addr, des_addr);
+      copied++;
+    }
+  }
+
+  // erase data block
+  map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
+  Address data_addr = Address(package, die, plane, block, 0, BLOCK);
+  chain_event(ftl, &chain, ERASE, logical_block, data_addr);
+  issue_chain(ftl, &chain);
+  update_erase_count(data_pba);
+  // only the trimmed pages of the log block's prefix are still programmed
+  clear_pages_trimmed(logical_block + desc->cursor, BLOCK_PAGES - desc->cursor);
+
+  // the log block becomes the data block
+  cancel_log_block(data_pba);
+  set_physical_address(logical_block, log_pba);
+
+  current->counters.switch_merges++;
+  FTL_LOG(1, log_file, "[switch_merge] log block %lu replaced data block %lu, %u pages copied\n",
+    log_pba, data_pba, copied);
+  return true;
+}
+
+/**
+ * @brief Move a block to the bucket of its new live page count
+ */
+void set_block_live(unsigned int nth_block, unsigned int live) {
+  if (current->block_sealed[nth_block])
+    list_remove(&current->live_blocks[current->block_live[nth_block]], current->block_prev, current->block_next, nth_block);
+  current->block_live[nth_block] = live;
+  if (current->block_sealed[nth_block])
+    list_push_back(&current->live_blocks[live], current->block_prev, current->block_next, nth_block);
+}
+
+/**
+ * @brief Let a full block be collected, or withdraw it
+ */
+void seal_block(unsigned int nth_block, bool sealed) {
+  if (current->block_sealed[nth_block] == sealed)
+    return;
+  if (sealed)
+    list_push_back(&current->live_blocks[current->block_live[nth_block]], current->block_prev, current->block_next, nth_block);
+  else
+    list_remove(&current->live_blocks[current->block_live[nth_block]], current->block_prev, current->block_next, nth_block);
+  current->block_sealed[nth_block] = sealed;
+}
+
+/**
+ * @brief Point a logical page at a physical page, the old copy goes stale
+ */
+void map_page(unsigned long logical_address, unsigned long physical_address) {
+  unsigned long old_address = current->page_map[logical_address];
+  if (old_address != RAW_SIZE) {
+    current->page_owner[old_address] = RAW_SIZE;
+    set_block_live(old_address / BLOCK_PAGES, current->block_live[old_address / BLOCK_PAGES] - 1);
+  }
+  current->page_map[logical_address] = physical_address;
+  current->page_owner[physical_address] = logical_address;
+  set_block_live(physical_address / BLOCK_PAGES, current->block_live[physical_address / BLOCK_PAGES] + 1);
+}
+
+/**
+ * @brief Drop the least recently used entry from the cached mapping table
+ *
+ * A dirty entry is written back with its translation page, which also cleans
+ * the other dirty entries cached from the same translation page.
+ */
+void evict_map_entry(void) {
+  unsigned long victim = (unsigned long)current->map_lru.head;
+  list_remove(&current->map_lru, current->map_prev, current->map_next, victim);
+  if (current->map_state[victim] == MAP_DIRTY) {
+    unsigned long first = victim - victim % MAP_ENTRIES_PER_PAGE;
+    for (unsigned long i = first; i < first + MAP_ENTRIES_PER_PAGE && i < USABLE_SIZE; i++) {
+      if (current->map_state[i] == MAP_DIRTY)
+        current->map_state[i] = MAP_CLEAN;
+    }
+    // read, modify and write the translation page
+    current->map_page_reads++;
+    current->map_page_writes++;
+    current->map_delay += PAGE_READ_DELAY + PAGE_WRITE_DELAY;
+  }
+  current->map_state[victim] = MAP_UNCACHED;
+  current->map_cached--;
+}
+
+/**
+ * @brief Look up or update the mapping entry of a logical page for a host
+ *        request, loading it from its translation page on a miss
+ */
+void cache_map_entry(unsigned long logical_address, bool update) {
+  if (MAP_CACHE_SIZE > 0) {
+    if (current->map_state[logical_address] != MAP_UNCACHED) {
+      current->map_hits++;
+      list_remove(&current->map_lru, current->map_prev, current->map_next, logical_address);
+    }
+    else {
+      current->map_misses++;
+      if (current->map_cached == MAP_CACHE_SIZE)
+        evict_map_entry();
+      current->map_page_reads++;
+      current->map_delay += PAGE_READ_DELAY + RAM_WRITE_DELAY;
+      current->map_state[logical_address] = MAP_CLEAN;
+      current->map_cached++;
+    }
+    list_push_back(&current->map_lru, current->map_prev, current->map_next, logical_address);
+    if (update)
+      current->map_state[logical_address] = MAP_DIRTY;
+  }
+  current->map_delay += update ? RAM_WRITE_DELAY : RAM_READ_DELAY;
+}
+
+/**
+ * @brief Update the mapping entry of a page moved by collection, straight in
+ *        its translation page unless it is cached
+ *
+ * Returns the translation page written, so consecutive moves covered by one
+ * translation page write it once.
+ */
+unsigned long move_map_entry(unsigned long logical_address, unsigned long last_map_page) {
+  unsigned long map_page_number = logical_address / MAP_ENTRIES_PER_PAGE;
+  if (MAP_CACHE_SIZE == 0 || current->map_state[logical_address] != MAP_UNCACHED) {
+    if (MAP_CACHE_SIZE > 0)
+      current->map_state[logical_address] = MAP_DIRTY;
+    current->map_delay += RAM_WRITE_DELAY;
+    return last_map_page;
+  }
+  if (map_page_number != last_map_page) {
+    current->map_page_reads++;
+    current->map_page_writes++;
+    current->map_delay += PAGE_READ_DELAY + PAGE_WRITE_DELAY;
+  }
+  return map_page_number;
+}
+
+/**
+ * @brief Return the write stream of a host write to a logical page in page
+ *        mapping mode
+ *
+ * With HEAT_HALF_LIFE set, pages of cold logical blocks go to the cold stream
+ * along with every collection copy, so the hot stream fills blocks whose
+ * pages are overwritten together and are collected with few copies.
+ * Otherwise every write shares stream 0.
+ */
+unsigned int page_stream(unsigned long logical_address) {
+  return (block_temperature(logical_address / BLOCK_PAGES) == TEMP_COLD) ? COLD_STREAM : 0;
+}
+
+/**
+ * @brief Take the next free page of the frontier block of a write stream in
+ *        page mapping mode
+ *
+ * When the frontier block is full it joins the collectable blocks and a free
+ * block replaces it.  The last free block is kept for collection copies, so
+ * host writes collect blocks until another one is free.  Collection copies
+ * all go to one stream, so a collection takes at most that free block.
+ */
+bool Garbage_collector::next_free_page(unsigned long *physical_address, unsigned int stream) {
+  ftl_scope scope(ftl.state);
+  unsigned long *frontier = &current->frontier[stream];
+  unsigned int *cursor = &current->frontier_cursor[stream];
+  if (*cursor == BLOCK_PAGES && !current->collecting_pages) {
+    if (*frontier != RAW_SIZE)
+      seal_block(*frontier / BLOCK_PAGES, true);
+    *frontier = RAW_SIZE;
+    while (current->op_blocks.size() <= 1) {
+      if (reclaim_page_block() == false)
+        break;
+    }
+  }
+  // collection may have left a frontier block with free pages
+  if (*cursor == BLOCK_PAGES) {
+    if (current->op_blocks.empty() || (!current->collecting_pages && current->op_blocks.size() <= 1)) {
+      FTL_LOG(1, log_file, "[next_free_page] no free block left\n");
+      return false;
+    }
+    if (*frontier != RAW_SIZE)
+      seal_block(*frontier / BLOCK_PAGES, true);
+    *frontier = pop_free_block();
+    *cursor = 0;
+  }
+  *physical_address = *frontier + *cursor;
+  (*cursor)++;
+  return true;
+}
+
+/**
+ * @brief Collect the full block with the fewest live pages in page mapping
+ *        mode, copying its live pages to the frontier block
+ */
+bool Garbage_collector::reclaim_page_block(void) {
+  ftl_scope scope(ftl.state);
+  int victim = -1;
+  for (unsigned int live = 0; live < BLOCK_PAGES && victim < 0; live++)
+    victim = current->live_blocks[live].head;
+  if (victim < 0)
+    return false;
+  unsigned long victim_pba = ((unsigned long)victim) * BLOCK_PAGES;
+  unsigned long copied = current->block_live[victim];
+
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int page;
+  event_chain chain = {NULL, NULL};
+  unsigned long last_map_page = RAW_SIZE;
+  bool moved = true;
+  current->collecting_pages = true;
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++) {
+    unsigned long logical_address = current->page_owner[victim_pba + i];
+    if (logical_address == RAW_SIZE)
+      continue;
+    unsigned long des_pba;
+    if (next_free_page(&des_pba, COLD_STREAM) == false) {
+      moved = false;
+      break;
+    }
+    map_physical_to_SSD(victim_pba + i, &package, &die, &plane, &block, &page);
+    Address src_addr = Address(package, die, plane, block, page, PAGE);
+    map_physical_to_SSD(des_pba, &package, &die, &plane, &block, &page);
+    Address des_addr = Address(package, die, plane, block, page, PAGE);
+    chain_copy(ftl, &chain, logical_address, src_addr, des_addr);
+    map_page(logical_address, des_pba);
+    last_map_page = move_map_entry(logical_address, last_map_page);
+  }
+  current->collecting_pages = false;
+  if (moved) {
+    map_physical_to_SSD(victim_pba, &package, &die, &plane, &block, &page);
+    Address victim_addr = Address(package, die, plane, block, 0, BLOCK);
+    chain_event(ftl, &chain, ERASE, 0, victim_addr);
+  }
+  issue_chain(ftl, &chain);
+  if (moved == false)
+    return false;
+
+  seal_block(victim, false);
+  update_erase_count(victim_pba);
+  // a worn out block is retired
+  if (!over_erase_limit(victim_pba))
+    push_free_block(victim_pba);
+  FTL_LOG(1, log_file, "[reclaim_page_block] block %lu freed, %lu pages copied\n",
+    victim_pba, copied);
+  return true;
+}
+
+/**
+ * @brief Translate a request in page mapping mode
+ */
+enum status Ftl::translate_page( Event &event ){
+  ftl_scope scope(state);
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int page;
+  unsigned long logical_address = event.get_logical_address();
+  unsigned long physical_address;
+  enum event_type operation = event.get_event_type();
+  current->map_delay = 0.0;
+
+  if (operation == READ) {
+    if (check_page_empty(logical_address)) {
+      FTL_LOG(2, log_file, "[translate_page] read a empty page\n");
+      return FAILURE;
+    }
+    cache_map_entry(logical_address, false);
+    physical_address = current->page_map[logical_address];
+  }
+  else if (operation == WRITE) {
+    cache_map_entry(logical_address, true);
+    record_update(logical_address / BLOCK_PAGES);
+    if (garbage.next_free_page(&physical_address, page_stream(logical_address)) == false) {
+      (void) event.incr_time_taken(current->map_delay);
+      return FAILURE;
+    }
+    map_page(logical_address, physical_address);
+    set_page_written(logical_address);
+  }
+  else {
+    FTL_LOG(1, log_file, "[translate_page] unkown operation\n");
+    return FAILURE;
+  }
+
+  // charge the mapping table accesses before the flash access
+  (void) event.incr_time_taken(current->map_delay);
+  map_physical_to_SSD(physical_address, &package, &die, &plane, &block, &page);
+  Address pba = Address(package, die, plane, block, page, PAGE);
+  event.set_address(pba);
+  FTL_LOG(2, log_file, "[translate_page] LBA %lu is at physical page %lu\n",
+    logical_address, physical_address);
+  return SUCCESS;
+}
+
+/**
+ * @brief Drop the mapped copy of a logical page, its log copy in shared log
+ *        mode
+ */
+void unmap_log_page(unsigned long logical_address) {
+  unsigned long log_address = current->page_map[logical_address];
+  if (log_address == RAW_SIZE)
+    return;
+  current->page_owner[log_address] = RAW_SIZE;
+  set_block_live(log_address / BLOCK_PAGES, current->block_live[log_address / BLOCK_PAGES] - 1);
+  current->page_map[logical_address] = RAW_SIZE;
+}
+
+/**
+ * @brief Return an erased block to the free blocks unless it is worn out
+ */
+void release_block(unsigned long physical_address) {
+  update_erase_count(physical_address);
+  if (!over_erase_limit(physical_address))
+    push_free_block(physical_address);
+}
+
+/**
+ * @brief Take a free block in shared log mode
+ *
+ * The last free block is kept as the target of merges, so log blocks are
+ * taken only after reclaiming random log blocks frees another one.
+ */
+bool Garbage_collector::next_shared_block(unsigned long *physical_address, bool merging) {
+  ftl_scope scope(ftl.state);
+  while (!merging && current->op_blocks.size() <= 1) {
+    if (reclaim_random_log() == false)
+      break;
+  }
+  if (current->op_blocks.empty() || (!merging && current->op_blocks.size() <= 1)) {
+    FTL_LOG(1, log_file, "[next_shared_block] no free block left\n");
+    return false;
+  }
+  *physical_address = pop_free_block();
+  if (!merging)
+    current->counters.log_block_allocations++;
+  return true;
+}
+
+/**
+ * @brief Merge a logical block with its latest copies in any log block into a
+ *        free block, which becomes its data block
+ *
+ * The sequential log block is freed as well if it belongs to the logical
+ * block, since all its pages are then stale.
+ */
+bool Garbage_collector::merge_shared_logs(unsigned long logical_block) {
+  ftl_scope scope(ftl.state);
+  unsigned long data_pba = check_physical_address(logical_block);
+  unsigned long new_pba;
+  if (next_shared_block(&new_pba, true) == false)
+    return false;
+
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  event_chain chain = {NULL, NULL};
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++) {
+    if (check_page_empty(logical_block + i))
+      continue;
+    unsigned long src_pba = current->page_map[logical_block + i];
+    // a trimmed page without a log copy has no live data to copy
+    if (src_pba == RAW_SIZE && check_page_trimmed(logical_block + i))
+      continue;
+    if (src_pba == RAW_SIZE)
+      src_pba = data_pba + i;
+    map_physical_to_SSD(src_pba, &package, &die, &plane, &block, &dummy);
+    Address src_addr = Address(package, die, plane, block, src_pba % BLOCK_PAGES, PAGE);
+    map_physical_to_SSD(new_pba, &package, &die, &plane, &block, &dummy);
+    Address des_addr = Address(package, die, plane, block, i, PAGE);
+    chain_copy(ftl, &chain, logical_block + i, src_addr, des_addr);
+    unmap_log_page(logical_block + i);
+  }
+
+  // erase data block
+  map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
+  Address data_addr = Address(package, die, plane, block, 0, BLOCK);
+  chain_event(ftl, &chain, ERASE, logical_block, data_addr);
+  bool seq_merged = (current->seq_log != RAW_SIZE && current->seq_logical == logical_block);
+  if (seq_merged) {
+    map_physical_to_SSD(current->seq_log, &package, &die, &plane, &block, &dummy);
+    Address seq_addr = Address(package, die, plane, block, 0, BLOCK);
+    chain_event(ftl, &chain, ERASE, logical_block, seq_addr);
+  }
+  issue_chain(ftl, &chain);
+  clear_pages_trimmed(logical_block, BLOCK_PAGES);
+
+  set_physical_address(logical_block, new_pba);
+  release_block(data_pba);
+  if (seq_merged) {
+    release_block(current->seq_log);
+    current->seq_log = RAW_SIZE;
+  }
+  current->counters.full_merges++;
+  FTL_LOG(1, log_file, "[merge_shared_logs] logical block %lu merged into block %lu\n",
+    logical_block, new_pba);
+  return true;
+}
+
+/**
+ * @brief Switch or partial merge the sequential log block into the data
+ *        block of its logical block
+ *
+ * Pages of the logical block past the sequential log block are copied from
+ * the data block unless a random log block holds their latest copy.
+ */
+bool Garbage_collector::merge_sequential_log(void) {
+  ftl_scope scope(ftl.state);
+  if (current->seq_log == RAW_SIZE)
+    return true;
+  unsigned long data_pba = check_physical_address(current->seq_logical);
+
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  event_chain chain = {NULL, NULL};
+  unsigned int copied = 0;
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++) {
+    unsigned long logical_address = current->seq_logical + i;
+    if (i < current->seq_cursor) {
+      // the latest copy of the page becomes the data block copy, which is
+      // live even if an earlier copy was trimmed
+      if (current->page_map[logical_address] == current->seq_log + i) {
+        unmap_log_page(logical_address);
+        clear_pages_trimmed(logical_address, 1);
+      }
+    }
+    else if (!check_page_empty(logical_address) && current->page_map[logical_address] == RAW_SIZE) {
+      map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
+      Address src_addr = Address(package, die, plane, block, i, PAGE);
+      map_physical_to_SSD(current->seq_log, &package, &die, &plane, &block, &dummy);
+      Address des_addr = Address(package, die, plane, block, i, PAGE);
+      chain_copy(ftl, &chain, logical_address, src_addr, des_addr);
+      copied++;
+    }
+  }
+
+  // erase data block
+  map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
+  Address data_addr = Address(package, die, plane, block, 0, BLOCK);
+  chain_event(ftl, &chain, ERASE, current->seq_logical, data_addr);
+  issue_chain(ftl, &chain);
+  clear_pages_trimmed(current->seq_logical + current->seq_cursor, BLOCK_PAGES - current->seq_cursor);
+
+  set_physical_address(current->seq_logical, current->seq_log);
+  release_block(data_pba);
+  if (copied == 0)
+    current->counters.switch_merges++;
+  else
+    current->counters.partial_merges++;
+  FTL_LOG(1, log_file, "[merge_sequential_log] log block %lu replaced data block %lu, %u pages copied\n",
+    current->seq_log, data_pba, copied);
+  current->seq_log = RAW_SIZE;
+  return true;
+}
+
+/**
+ * @brief Free the oldest random log block by merging every logical block
+ *        with a live page in it
+ */
+bool Garbage_collector::reclaim_random_log(void) {
+  ftl_scope scope(ftl.state);
+  // the only random log block is not reclaimed while it still has free pages
+  if (current->random_logs.empty() || (current->random_logs.size() == 1 && current->random_cursor < BLOCK_PAGES))
+    return false;
+  unsigned long victim_pba = current->random_logs.front();
+  for (unsigned int i = 0; i < BLOCK_PAGES; i++) {
+    unsigned long logical_address = current->page_owner[victim_pba + i];
+    if (logical_address == RAW_SIZE)
+      continue;
+    if (merge_shared_logs(logical_address - logical_address % BLOCK_PAGES) == false)
+      return false;
+  }
+
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  event_chain chain = {NULL, NULL};
+  map_physical_to_SSD(victim_pba, &package, &die, &plane, &block, &dummy);
+  Address victim_addr = Address(package, die, plane, block, 0, BLOCK);
+  chain_event(ftl, &chain, ERASE, 0, victim_addr);
+  issue_chain(ftl, &chain);
+
+  current->random_logs.pop_front();
+  if (current->random_logs.empty())
+    current->random_cursor = BLOCK_PAGES;
+  release_block(victim_pba);
+  FTL_LOG(1, log_file, "[reclaim_random_log] log block %lu freed\n", victim_pba);
+  return true;
+}
+
+/**
+ * @brief Erase the data block of a logical block left without live pages by
+ *        trims, along with its log block, which goes back to the free blocks
+ *
+ * The logical block is empty again, so in place writes can use its data
+ * block.  A worn out block is not erased.
+ */
+void Garbage_collector::free_trimmed_block(unsigned long logical_block) {
+  ftl_scope scope(ftl.state);
+  unsigned long data_pba = check_physical_address(logical_block);
+  unsigned long log_pba = RAW_SIZE;
+  if (FTL_MODE == BLOCK_MAPPED)
+    check_log_block(data_pba, &log_pba);
+  else if (current->seq_log != RAW_SIZE && current->seq_logical == logical_block)
+    log_pba = current->seq_log;
+
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  event_chain chain = {NULL, NULL};
+  bool erase_data = !over_erase_limit(data_pba);
+  bool erase_log = (log_pba != RAW_SIZE && !over_erase_limit(log_pba));
+  if (erase_data) {
+    map_physical_to_SSD(data_pba, &package, &die, &plane, &block, &dummy);
+    Address data_addr = Address(package, die, plane, block, 0, BLOCK);
+    chain_event(ftl, &chain, ERASE, logical_block, data_addr);
+  }
+  if (erase_log) {
+    map_physical_to_SSD(log_pba, &package, &die, &plane, &block, &dummy);
+    Address log_addr = Address(package, die, plane, block, 0, BLOCK);
+    chain_event(ftl, &chain, ERASE, logical_block, log_addr);
+  }
+  issue_chain(ftl, &chain);
+
+  if (erase_data) {
+    update_erase_count(data_pba);
+    clear_pages_trimmed(logical_block, BLOCK_PAGES);
+  }
+  if (log_pba != RAW_SIZE) {
+    if (FTL_MODE == BLOCK_MAPPED)
+      cancel_log_block(data_pba);
+    else
+      current->seq_log = RAW_SIZE;
+    if (erase_log)
+      release_block(log_pba);
+  }
+  heap_insert(&current->empty_heap, logical_block / BLOCK_PAGES);
+  heap_insert(&current->worn_empty_heap, logical_block / BLOCK_PAGES);
+  FTL_LOG(1, log_file, "[free_trimmed_block] logical block %lu freed\n", logical_block);
+}
+
+/**
+ * @brief Erase a full block left without live pages by trims, a sealed block
+ *        in page mapping mode or a random log block in shared log mode, and
+ *        return it to the free blocks
+ */
+void Garbage_collector::free_dead_block(unsigned long physical_address) {
+  ftl_scope scope(ftl.state);
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int dummy;
+  event_chain chain = {NULL, NULL};
+  map_physical_to_SSD(physical_address, &package, &die, &plane, &block, &dummy);
+  Address dead_addr = Address(package, die, plane, block, 0, BLOCK);
+  chain_event(ftl, &chain, ERASE, 0, dead_addr);
+  issue_chain(ftl, &chain);
+
+  if (FTL_MODE == PAGE_MAPPED)
+    seal_block(physical_address / BLOCK_PAGES, false);
+  else {
+    for (std::deque<unsigned long>::iterator it = current->random_logs.begin(); it != current->random_logs.end(); it++) {
+      if (*it == physical_address) {
+        current->random_logs.erase(it);
+        break;
+      }
+    }
+    if (current->random_logs.empty())
+      current->random_cursor = BLOCK_PAGES;
+  }
+  release_block(physical_address);
+  FTL_LOG(1, log_file, "[free_dead_block] block %lu freed\n", physical_address);
+}
+
+/**
+ * @brief Translate a request in shared log mode
+ *
+ * The first write of a page goes to the data block.  A rewrite of the first
+ * page of a logical block starts the sequential log block, and rewrites that
+ * continue it in page order are appended to it.  Other rewrites are appended
+ * to the random log blocks.
+ */
+enum status Ftl::translate_shared( Event &event ){
+  ftl_scope scope(state);
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int page;
+  unsigned long logical_address = event.get_logical_address();
+  unsigned long logical_block = logical_address - logical_address % BLOCK_PAGES;
+  unsigned long physical_address;
+  enum event_type operation = event.get_event_type();
+
+  if (operation == READ) {
+    if (check_page_empty(logical_address)) {
+      FTL_LOG(2, log_file, "[translate_shared] read a empty page\n");
+      return FAILURE;
+    }
+    physical_address = current->page_map[logical_address];
+    if (physical_address == RAW_SIZE)
+      physical_address = check_physical_address(logical_address);
+  }
+  else if (operation == WRITE) {
+    // the data block may still hold a trimmed copy, so the page is rewritten,
+    // but it is marked written only once its log page is taken, since taking
+    // one may merge this logical block
+    if (check_page_empty(logical_address) && !check_page_trimmed(logical_address)) {
+      physical_address = check_physical_address(logical_address);
+      set_page_written(logical_address);
+    }
+    else if (logical_address == logical_block) {
+      if (garbage.merge_sequential_log() == false
+          || garbage.next_shared_block(&physical_address, false) == false)
+        return FAILURE;
+      current->seq_log = physical_address;
+      current->seq_logical = logical_block;
+      current->seq_cursor = 1;
+      set_page_written(logical_address);
+      map_page(logical_address, physical_address);
+    }
+    else if (current->seq_log != RAW_SIZE && current->seq_logical == logical_block
+             && current->seq_cursor == logical_address - logical_block) {
+      physical_address = current->seq_log + current->seq_cursor;
+      current->seq_cursor++;
+      set_page_written(logical_address);
+      map_page(logical_address, physical_address);
+    }
+    else {
+      if (current->random_cursor == BLOCK_PAGES) {
+        unsigned long log_pba;
+        if (garbage.next_shared_block(&log_pba, false) == false)
+          return FAILURE;
+        current->random_logs.push_back(log_pba);
+        current->random_cursor = 0;
+      }
+      physical_address = current->random_logs.back() + current->random_cursor;
+      current->random_cursor++;
+      set_page_written(logical_address);
+      map_page(logical_address, physical_address);
+    }
+  }
+  else {
+    FTL_LOG(1, log_file, "[translate_shared] unkown operation\n");
+    return FAILURE;
+  }
+
+  map_physical_to_SSD(physical_address, &package, &die, &plane, &block, &page);
+  Address pba = Address(package, die, plane, block, page, PAGE);
+  event.set_address(pba);
+  FTL_LOG(2, log_file, "[translate_shared] LBA %lu is at physical page %lu\n",
+    logical_address, physical_address);
+  return SUCCESS;
+}
+
+/**
+ * @brief Drop the data of the trimmed logical pages
+ *
+ * A trimmed page reads as empty and is skipped by cleaning, since its
+ * emptiness bit and its log copy are cleared.  A block left without live
+ * pages is erased and freed at once.  Pages never written are ignored.
+ */
+enum status Ftl::trim( Event &event ){
+  ftl_scope scope(state);
+  unsigned long first = event.get_logical_address();
+  unsigned long end = first + event.get_size();
+  FTL_LOG(2, log_file, "[trim] LBA %lu, %u pages\n", first, event.get_size());
+  if (end > USABLE_SIZE) {
+    FTL_LOG(1, log_file, "[trim] LBA not assessible\n");
+    return FAILURE;
+  }
+  current->start_time = event.get_start_time();
+  current->map_delay = 0.0;
+  current->counters.host_trims += event.get_size();
+
+  for (unsigned long logical_address = first; logical_address < end; logical_address++) {
+    if (check_page_empty(logical_address))
+      continue;
+    clear_pages_written(logical_address, 1);
+    unsigned long nth_logical_block = logical_address / BLOCK_PAGES;
+
+    if (FTL_MODE == PAGE_MAPPED) {
+      cache_map_entry(logical_address, true);
+      unsigned long nth_block = current->page_map[logical_address] / BLOCK_PAGES;
+      unmap_log_page(logical_address);
+      // the frontier block is not sealed, it is collected once full
+      if (current->block_live[nth_block] == 0 && current->block_sealed[nth_block])
+        garbage.free_dead_block(nth_block * BLOCK_PAGES);
+      continue;
+    }
+
+    // the data block page keeps its trimmed copy until the block is rebuilt
+    set_page_trimmed(logical_address);
+    if (FTL_MODE == SHARED_LOGS) {
+      unsigned long log_address = current->page_map[logical_address];
+      unmap_log_page(logical_address);
+      if (log_address != RAW_SIZE) {
+        unsigned long log_pba = log_address - log_address % BLOCK_PAGES;
+        // the random log block taking writes is kept until it is full
+        if (current->block_live[log_pba / BLOCK_PAGES] == 0 && log_pba != current->seq_log
+            && (log_pba != current->random_logs.back() || current->random_cursor == BLOCK_PAGES))
+          garbage.free_dead_block(log_pba);
+      }
+    }
+    else {
+      unsigned long log_address;
+      if (check_log_block(check_physical_address(logical_address), &log_address))
+        drop_log_page(log_address, logical_address % BLOCK_PAGES);
+      refresh_pair(nth_logical_block);
+    }
+    if (check_block_empty(nth_logical_block))
+      garbage.free_trimmed_block(nth_logical_block * BLOCK_PAGES);
+  }
+
+  // charge the mapping table updates
+  (void) event.incr_time_taken(current->map_delay);
+  return SUCCESS;
+}
+
+Ftl::Ftl(Controller &controller, FILE *log_file)
+  : log_file(log_file), controller(controller), garbage(*this, log_file), wear(*this, log_file) {
+  init_ftl_user();
+}
+
+// the tables are freed by exit_ftl_user when the controller goes away
+Ftl::~Ftl(void) {
+}
+
+/**
+ * @brief Translate a read and issue it to the flash
+ */
+enum status Ftl::read( Event &event ){
+  if (translate(event) != SUCCESS)
+    return FAILURE;
+  return controller.issue(event);
+}
+
+/**
+ * @brief Translate a write, cleaning first if it needs room, and issue it to
+ *        the flash
+ */
+enum status Ftl::write( Event &event ){
+  if (translate(event) != SUCCESS)
+    return FAILURE;
+  return controller.issue(event);
+}
+
+void Ftl::init_ftl_user()
+{
+  state = new ftl_state(controller.get_geometry());
+  ftl_scope scope(state);
+
+  // initialize the bit checking emptiness array
+  unsigned long emp_len = ((unsigned long)USABLE_SIZE + EMPTINESS_WORD_BITS) / EMPTINESS_WORD_BITS;
+  // 0 bit for empty, 1 bit for written
+  current->logical_to_emptiness = new uint64_t [emp_len]();
+  // no page has been trimmed
+  current->logical_to_trimmed = new uint64_t [emp_len]();
+  
+  // initialize erases count for all physical blocks
+  current->erase_count = new unsigned int [NUM_OF_PHY_B]();
+  
+  // initialize offset mapping table from logical block to physical block
+  current->logical_to_physical = new int [NUM_OF_LGC_B]();
+  
+  // initialize offset mapping table from physical data block to physical log block
+  current->data_to_log = new int [NUM_OF_PHY_B]();
+
+  // initialize reverse mapping table, every logical block starts on its own
+  // physical block
+  current->physical_to_logical = new int [NUM_OF_PHY_B];
+  for (unsigned int i = 0; i < NUM_OF_PHY_B; i++) {
+    current->physical_to_logical[i] = (i < NUM_OF_LGC_B) ? (int)i : -1;
+  }
+
+  // initialize reverse mapping table from physical log block to physical
+  // data block
+  current->log_to_data = new int [NUM_OF_PHY_B];
+  for (unsigned int i = 0; i < NUM_OF_PHY_B; i++) {
+    current->log_to_data[i] = -1;
+  }
+
+  // initialize the block heaps, every logical block starts empty and
+  // without a log block
+  heap_init(&current->empty_heap, NUM_OF_LGC_B, logical_fewer_erases);
+  heap_init(&current->worn_empty_heap, NUM_OF_LGC_B, logical_more_erases);
+  heap_init(&current->unlogged_heap, NUM_OF_LGC_B, logical_fewer_erases);
+  heap_init(&current->pair_heap, NUM_OF_PHY_B, pair_more_erases);
+  for (unsigned int i = 0; i < NUM_OF_LGC_B; i++) {
+    heap_insert(&current->empty_heap, i);
+    heap_insert(&current->worn_empty_heap, i);
+    heap_insert(&current->unlogged_heap, i);
+  }
+
+  // initialize the cleaning victim candidates, no data block has a log block
+  current->fifo_pairs.head = current->fifo_pairs.tail = -1;
+  current->fifo_prev = new int [NUM_OF_PHY_B];
+  current->fifo_next = new int [NUM_OF_PHY_B];
+  current->live_pairs = new block_list [BLOCK_PAGES + 1];
+  for (unsigned int i = 0; i <= BLOCK_PAGES; i++)
+    current->live_pairs[i].head = current->live_pairs[i].tail = -1;
+  current->live_prev = new int [NUM_OF_PHY_B];
+  current->live_next = new int [NUM_OF_PHY_B];
+  current->pair_live = new int [NUM_OF_PHY_B];
+  current->pair_written = new double [NUM_OF_PHY_B];
+  for (unsigned int i = 0; i < NUM_OF_PHY_B; i++) {
+    current->fifo_prev[i] = current->fifo_next[i] = current->live_prev[i] = current->live_next[i] = -1;
+    current->pair_live[i] = -1;
+    current->pair_written[i] = 0.0;
+  }
+
+  // initialize the update heat, no logical block has been updated
+  current->update_heat = new unsigned int [NUM_OF_LGC_B]();
+  current->heat_period = new unsigned long [NUM_OF_LGC_B]();
+  current->host_writes = 0;
+
+  // initialize a cleaning block
+  //current_cln_address = USABLE_SIZE;
+  
+  // initialize the list of overprovisioning blocks, every whole block past
+  // the last logical block, so shared log pages stay inside their block
+  for (unsigned long i = (unsigned long)NUM_OF_LGC_B * BLOCK_PAGES; i + BLOCK_PAGES <= RAW_SIZE; i += BLOCK_PAGES) {
+    current->op_blocks.push_back(i);
+  }
+
+  // initialize a log block descriptor per overprovisioning block, plus a
+  // spare so a log block can be copied before its old one is released
+  current->num_log_descs = current->op_blocks.size() + 1;
+  current->log_descs = new log_block_desc [current->num_log_descs];
+  current->log_desc_pages = new unsigned int [current->num_log_descs * BLOCK_PAGES];
+  for (unsigned int i = 0; i < current->num_log_descs; i++) {
+    current->log_descs[i].cursor = 0;
+    current->log_descs[i].latest = &current->log_desc_pages[i * BLOCK_PAGES];
+    current->free_log_descs.push_back(current->num_log_descs - 1 - i);
+  }
+
+  // initialize descriptor table of physical log blocks
+  current->log_to_desc = new int [NUM_OF_PHY_B];
+  for (unsigned int i = 0; i < NUM_OF_PHY_B; i++) {
+    current->log_to_desc[i] = -1;
+  }
+
+  // page mapping mode writes any block, so every block starts free
+  current->page_map = new unsigned long [(unsigned long)USABLE_SIZE];
+  current->page_owner = new unsigned long [RAW_SIZE];
+  for (unsigned long i = 0; i < USABLE_SIZE; i++)
+    current->page_map[i] = RAW_SIZE;
+  for (unsigned long i = 0; i < RAW_SIZE; i++)
+    current->page_owner[i] = RAW_SIZE;
+  current->block_live = new unsigned int [NUM_OF_PHY_B]();
+  current->live_blocks = new block_list [BLOCK_PAGES + 1];
+  for (unsigned int i = 0; i <= BLOCK_PAGES; i++)
+    current->live_blocks[i].head = current->live_blocks[i].tail = -1;
+  current->block_prev = new int [NUM_OF_PHY_B];
+  current->block_next = new int [NUM_OF_PHY_B];
+  current->block_sealed = new bool [NUM_OF_PHY_B]();
+  for (unsigned int i = 0; i < NUM_OF_PHY_B; i++)
+    current->block_prev[i] = current->block_next[i] = -1;
+  for (unsigned int i = 0; i < PAGE_STREAMS; i++) {
+    current->frontier[i] = RAW_SIZE;
+    current->frontier_cursor[i] = BLOCK_PAGES;
+  }
+  current->collecting_pages = false;
+  if (FTL_MODE == PAGE_MAPPED) {
+    current->op_blocks.clear();
+    for (unsigned long i = RAW_SIZE; i > 0; i -= BLOCK_PAGES)
+      current->op_blocks.push_back(i - BLOCK_PAGES);
+  }
+
+  // index the free blocks when log block allocation orders them
+  if (FTL_MODE == BLOCK_MAPPED && (HEAT_HALF_LIFE > 0 || BLOCK_STRIPING)) {
+    current->num_stripes = BLOCK_STRIPING ? current->geometry.get_ssd_size() * current->geometry.get_package_size() : 1;
+    unsigned long capacity = BLOCK_STRIPING ? current->geometry.get_die_blocks() : NUM_OF_PHY_B;
+    current->free_slot = new int [NUM_OF_PHY_B];
+    current->free_fewest = new block_heap [current->num_stripes];
+    current->free_most = new block_heap [current->num_stripes];
+    current->free_recent = new block_heap [current->num_stripes];
+    int *fewest_pos = new int [NUM_OF_PHY_B];
+    int *most_pos = new int [NUM_OF_PHY_B];
+    int *recent_pos = new int [NUM_OF_PHY_B];
+    for (unsigned int i = 0; i < current->num_stripes; i++) {
+      heap_init_shared(&current->free_fewest[i], capacity, fewest_pos, free_fewest_before);
+      heap_init_shared(&current->free_most[i], capacity, most_pos, free_most_before);
+      heap_init_shared(&current->free_recent[i], capacity, recent_pos, free_recent_before);
+    }
+    index_free_blocks();
+  }
+
+  // initialize the shared log blocks, none taken
+  current->random_cursor = BLOCK_PAGES;
+  current->seq_log = RAW_SIZE;
+  current->seq_logical = 0;
+  current->seq_cursor = 0;
+
+  // initialize the cached mapping table, empty
+  current->map_lru.head = current->map_lru.tail = -1;
+  current->map_prev = new int [(unsigned long)USABLE_SIZE];
+  current->map_next = new int [(unsigned long)USABLE_SIZE];
+  current->map_state = new unsigned char [(unsigned long)USABLE_SIZE];
+  for (unsigned long i = 0; i < USABLE_SIZE; i++) {
+    current->map_prev[i] = current->map_next[i] = -1;
+    current->map_state[i] = MAP_UNCACHED;
+  }
+  current->map_cached = 0;
+  current->map_hits = current->map_misses = current->map_page_reads = current->map_page_writes = 0;
+  memset(&current->counters, 0, sizeof(current->counters));
+
+  FTL_LOG(1, log_file, "[init_ftl_user] mapping tables take %lu bytes of RAM\n",
+    mapping_ram_bytes());
+}
+
+/**
+ * @brief Free the tables allocated by init_ftl_user
+ */
+void Ftl::exit_ftl_user()
+{
+  delete state;
+  state = NULL;
+}
+
+// the scalars of the tables, saved as one section
+struct ftl_snapshot {
+  double start_time;
+  double gc_finish_time;
+  double map_delay;
+  uint64_t current_cln_address;
+  uint64_t host_writes;
+  uint64_t frontier[PAGE_STREAMS];
+  uint64_t map_stats[4];
+  uint64_t seq_log;
+  uint64_t seq_logical;
+  uint32_t frontier_cursor[PAGE_STREAMS];
+  uint32_t random_cursor;
+  uint32_t seq_cursor;
+  uint32_t map_cached;
+  uint32_t collecting_pages;
+  uint32_t heap_sizes[4];
+  int32_t lists[4];
+};
+
+/**
+ * @brief Save every table to a snapshot, see Ssd::save_snapshot
+ *
+ * The work counters and the mapping cache statistics are saved too, so that
+ * they stay lifetime totals like the flash writes of the Ssd.
+ */
+void Ftl::save_ftl_user(Snapshot &snapshot)
+{
+  ftl_scope scope(state);
+  unsigned long emp_len = ((unsigned long)USABLE_SIZE + EMPTINESS_WORD_BITS) / EMPTINESS_WORD_BITS;
+  ftl_snapshot scalars;
+  memset(&scalars, 0, sizeof(scalars));
+  scalars.start_time = current->start_time;
+  scalars.gc_finish_time = current->gc_finish_time;
+  scalars.map_delay = current->map_delay;
+  scalars.current_cln_address = current->current_cln_address;
+  scalars.host_writes = current->host_writes;
+  for (unsigned int i = 0; i < PAGE_STREAMS; i++) {
+    scalars.frontier[i] = current->frontier[i];
+    scalars.frontier_cursor[i] = current->frontier_cursor[i];
+  }
+  scalars.map_stats[0] = current->map_hits;
+  scalars.map_stats[1] = current->map_misses;
+  scalars.map_stats[2] = current->map_page_reads;
+  scalars.map_stats[3] = current->map_page_writes;
+  scalars.seq_log = current->seq_log;
+  scalars.seq_logical = current->seq_logical;
+  scalars.random_cursor = current->random_cursor;
+  scalars.seq_cursor = current->seq_cursor;
+  scalars.map_cached = current->map_cached;
+  scalars.collecting_pages = current->collecting_pages;
+  scalars.heap_sizes[0] = current->empty_heap.size;
+  scalars.heap_sizes[1] = current->worn_empty_heap.size;
+  scalars.heap_sizes[2] = current->unlogged_heap.size;
+  scalars.heap_sizes[3] = current->pair_heap.size;
+  scalars.lists[0] = current->fifo_pairs.head;
+  scalars.lists[1] = current->fifo_pairs.tail;
+  scalars.lists[2] = current->map_lru.head;
+  scalars.lists[3] = current->map_lru.tail;
+  snapshot.write(&scalars, sizeof(scalars));
+  snapshot.write(&current->counters, sizeof(current->counters));
+
+  snapshot.write_array(current->logical_to_emptiness, emp_len);
+  snapshot.write_array(current->logical_to_trimmed, emp_len);
+  snapshot.write_array(current->erase_count, NUM_OF_PHY_B);
+  snapshot.write_array(current->logical_to_physical, NUM_OF_LGC_B);
+  snapshot.write_array(current->data_to_log, NUM_OF_PHY_B);
+  snapshot.write_array(current->physical_to_logical, NUM_OF_PHY_B);
+  snapshot.write_array(current->log_to_data, NUM_OF_PHY_B);
+
+  // log block descriptors: the cursors, then the shared page table
+  std::vector<unsigned int> cursors(current->num_log_descs);
+  for (unsigned int i = 0; i < current->num_log_descs; i++)
+    cursors[i] = current->log_descs[i].cursor;
+  snapshot.write_vector(cursors);
+  snapshot.write_array(current->log_desc_pages, (unsigned long)current->num_log_descs * BLOCK_PAGES);
+  snapshot.write_vector(current->free_log_descs);
+  snapshot.write_array(current->log_to_desc, NUM_OF_PHY_B);
+  snapshot.write_vector(current->op_blocks);
+
+  snapshot.write_array(current->empty_heap.data, NUM_OF_LGC_B);
+  snapshot.write_array(current->empty_heap.pos, NUM_OF_LGC_B);
+  snapshot.write_array(current->worn_empty_heap.data, NUM_OF_LGC_B);
+  snapshot.write_array(current->worn_empty_heap.pos, NUM_OF_LGC_B);
+  snapshot.write_array(current->unlogged_heap.data, NUM_OF_LGC_B);
+  snapshot.write_array(current->unlogged_heap.pos, NUM_OF_LGC_B);
+  snapshot.write_array(current->pair_heap.data, NUM_OF_PHY_B);
+  snapshot.write_array(current->pair_heap.pos, NUM_OF_PHY_B);
+
+  snapshot.write_array(current->fifo_prev, NUM_OF_PHY_B);
+  snapshot.write_array(current->fifo_next, NUM_OF_PHY_B);
+  snapshot.write_array(current->live_pairs, BLOCK_PAGES + 1);
+  snapshot.write_array(current->live_prev, NUM_OF_PHY_B);
+  snapshot.write_array(current->live_next, NUM_OF_PHY_B);
+  snapshot.write_array(current->pair_live, NUM_OF_PHY_B);
+  snapshot.write_array(current->pair_written, NUM_OF_PHY_B);
+  snapshot.write_array(current->update_heat, NUM_OF_LGC_B);
+  snapshot.write_array(current->heat_period, NUM_OF_LGC_B);
+
+  snapshot.write_array(current->page_map, USABLE_SIZE);
+  snapshot.write_array(current->page_owner, RAW_SIZE);
+  snapshot.write_array(current->block_live, NUM_OF_PHY_B);
+  snapshot.write_array(current->live_blocks, BLOCK_PAGES + 1);
+  snapshot.write_array(current->block_prev, NUM_OF_PHY_B);
+  snapshot.write_array(current->block_next, NUM_OF_PHY_B);
+  snapshot.write_array(current->block_sealed, NUM_OF_PHY_B);
+  snapshot.write_array(current->map_prev, USABLE_SIZE);
+  snapshot.write_array(current->map_next, USABLE_SIZE);
+  snapshot.write_array(current->map_state, USABLE_SIZE);
+
+  std::vector<unsigned long> random_logs(current->random_logs.begin(), current->random_logs.end());
+  snapshot.write_vector(random_logs);
+}
+
+/**
+ * @brief Replace the tables set up by init_ftl_user with a saved snapshot
+ */
+void Ftl::load_ftl_user(Snapshot &snapshot)
+{
+  ftl_scope scope(state);
+  unsigned long emp_len = ((unsigned long)USABLE_SIZE + EMPTINESS_WORD_BITS) / EMPTINESS_WORD_BITS;
+  ftl_snapshot scalars;
+  snapshot.read(&scalars, sizeof(scalars));
+  snapshot.read(&current->counters, sizeof(current->counters));
+  current->start_time = scalars.start_time;
+  current->gc_finish_time = scalars.gc_finish_time;
+  current->map_delay = scalars.map_delay;
+  current->current_cln_address = scalars.current_cln_address;
+  current->host_writes = scalars.host_writes;
+  for (unsigned int i = 0; i < PAGE_STREAMS; i++) {
+    current->frontier[i] = scalars.frontier[i];
+    current->frontier_cursor[i] = scalars.frontier_cursor[i];
+  }
+  current->map_hits = scalars.map_stats[0];
+  current->map_misses = scalars.map_stats[1];
+  current->map_page_reads = scalars.map_stats[2];
+  current->map_page_writes = scalars.map_stats[3];
+  current->seq_log = scalars.seq_log;
+  current->seq_logical = scalars.seq_logical;
+  current->random_cursor = scalars.random_cursor;
+  current->seq_cursor = scalars.seq_cursor;
+  current->map_cached = scalars.map_cached;
+  current->collecting_pages = scalars.collecting_pages != 0;
+  current->empty_heap.size = scalars.heap_sizes[0];
+  current->worn_empty_heap.size = scalars.heap_sizes[1];
+  current->unlogged_heap.size = scalars.heap_sizes[2];
+  current->pair_heap.size = scalars.heap_sizes[3];
+  current->fifo_pairs.head = scalars.lists[0];
+  current->fifo_pairs.tail = scalars.lists[1];
+  current->map_lru.head = scalars.lists[2];
+  current->map_lru.tail = scalars.lists[3];
+
+  snapshot.read_array(current->logical_to_emptiness, emp_len);
+  snapshot.read_array(current->logical_to_trimmed, emp_len);
+  snapshot.read_array(current->erase_count, NUM_OF_PHY_B);
+  snapshot.read_array(current->logical_to_physical, NUM_OF_LGC_B);
+  snapshot.read_array(current->data_to_log, NUM_OF_PHY_B);
+  snapshot.read_array(current->physical_to_logical, NUM_OF_PHY_B);
+  snapshot.read_array(current->log_to_data, NUM_OF_PHY_B);
+
+  std::vector<unsigned int> cursors;
+  snapshot.read_vector(cursors);
+  if (cursors.size() != current->num_log_descs) {
+    fprintf(stderr, "Ftl error: %s: snapshot has %lu log block descriptors, not %u\n",
+      __func__, (unsigned long)cursors.size(), current->num_log_descs);
+    exit(FILE_ERR);
+  }
+  for (unsigned int i = 0; i < current->num_log_descs; i++)
+    current->log_descs[i].cursor = cursors[i];
+  snapshot.read_array(current->log_desc_pages, (unsigned long)current->num_log_descs * BLOCK_PAGES);
+  snapshot.read_vector(current->free_log_descs);
+  snapshot.read_array(current->log_to_desc, NUM_OF_PHY_B);
+  snapshot.read_vector(current->op_blocks);
+  index_free_blocks();
+
+  snapshot.read_array(current->empty_heap.data, NUM_OF_LGC_B);
+  snapshot.read_array(current->empty_heap.pos, NUM_OF_LGC_B);
+  snapshot.read_array(current->worn_empty_heap.data, NUM_OF_LGC_B);
+  snapshot.read_array(current->worn_empty_heap.pos, NUM_OF_LGC_B);
+  snapshot.read_array(current->unlogged_heap.data, NUM_OF_LGC_B);
+  snapshot.read_array(current->unlogged_heap.pos, NUM_OF_LGC_B);
+  snapshot.read_array(current->pair_heap.data, NUM_OF_PHY_B);
+  snapshot.read_array(current->pair_heap.pos, NUM_OF_PHY_B);
+
+  snapshot.read_array(current->fifo_prev, NUM_OF_PHY_B);
+  snapshot.read_array(current->fifo_next, NUM_OF_PHY_B);
+  snapshot.read_array(current->live_pairs, BLOCK_PAGES + 1);
+  snapshot.read_array(current->live_prev, NUM_OF_PHY_B);
+  snapshot.read_array(current->live_next, NUM_OF_PHY_B);
+  snapshot.read_array(current->pair_live, NUM_OF_PHY_B);
+  snapshot.read_array(current->pair_written, NUM_OF_PHY_B);
+  snapshot.read_array(current->update_heat, NUM_OF_LGC_B);
+  snapshot.read_array(current->heat_period, NUM_OF_LGC_B);
+
+  snapshot.read_array(current->page_map, USABLE_SIZE);
+  snapshot.read_array(current->page_owner, RAW_SIZE);
+  snapshot.read_array(current->block_live, NUM_OF_PHY_B);
+  snapshot.read_array(current->live_blocks, BLOCK_PAGES + 1);
+  snapshot.read_array(current->block_prev, NUM_OF_PHY_B);
+  snapshot.read_array(current->block_next, NUM_OF_PHY_B);
+  snapshot.read_array(current->block_sealed, NUM_OF_PHY_B);
+  snapshot.read_array(current->map_prev, USABLE_SIZE);
+  snapshot.read_array(current->map_next, USABLE_SIZE);
+  snapshot.read_array(current->map_state, USABLE_SIZE);
+
+  std::vector<unsigned long> random_logs;
+  snapshot.read_vector(random_logs);
+  current->random_logs.assign(random_logs.begin(), random_logs.end());
+}
+
+const struct ftl_stats &Ftl::get_stats(void) const {
+  return state->counters;
+}
+
+enum status Ftl::translate( Event &event ){
+  ftl_scope scope(state);
+  unsigned int package;
+  unsigned int die;
+  unsigned int plane;
+  unsigned int block;
+  unsigned int page;
+  unsigned long data_address;
+  unsigned long log_address;
+  unsigned long logical_address;
+  unsigned long physical_address;
+  logical_address = event.get_logical_address();
+  FTL_LOG(2, log_file, "[translate] input LBA: %lu *******************************\n", logical_address);
+
+  if (LOG_ENABLED(3))
+    print_info();
+  
+  // legal logical address is only from 0 to USABLE_SIZE - 1 
+  if (logical_address >= USABLE_SIZE) {
+    FTL_LOG(1, log_file, "[translate] LBA not assessible\n");
+    return FAILURE;
+  }
+  if (event.get_event_type() == WRITE)
+    current->counters.host_writes++;
+  else if (event.get_event_type() == READ)
+    current->counters.host_reads++;
+
+  // set start time
+  current->start_time = event.get_start_time();
+
+  if (FTL_MODE == PAGE_MAPPED)
+    return translate_page(event);
+  if (FTL_MODE == SHARED_LOGS)
+    return translate_shared(event);
+  
+  // find the physical address
+  physical_address = check_physical_address(logical_address);
+  map_physical_to_SSD(physical_address, &package, &die, &plane, &block, &page);
+  FTL_LOG(2, log_file, "[translate] original mapping is (%u,%u,%u,%u,%u)\n", 
+    package, die, plane, block, page);
+  // find the physical data block address
+  data_address = physical_address - page;
+  FTL_LOG(2, log_file, "[translate] data block address is %lu\n", data_address);
+  
+  enum event_type operation = event.get_event_type();
+
+  if (operation == WRITE) {   
+    record_update(logical_address / BLOCK_PAGES);
+    // the data block may still hold a trimmed copy, so the page is logged
+    if (check_page_empty(logical_address) && check_page_trimmed(logical_address))
+      set_page_written(logical_address);
+    // check if page is empty
+    if (check_page_empty(logical_address)) {
+      set_page_written(logical_address);
+      // original translation
+      Address pba = Address(package, die, plane, block, page, PAGE);
+      event.set_address(pba);
+      FTL_LOG(2, log_file, "[translate] wrote to an empty page\n");
+      return SUCCESS;
+    } 
+    
+    // check if log block mapped to data block
+    if (check_log_block(data_address, &log_address)) {
+      FTL_LOG(2, log_file, "[translate] data block %lu maps to log block %lu\n",
+        data_address, log_address);
+      // check if there is a empty page in log block
+      unsigned int log_page;
+      if (next_free_log_page(log_address, &log_page)) {
+        append_log_page(log_address, page);
+        FTL_LOG(2, log_file, "[translate] log block pba %lu wrote page %u to log page %u\n",
+          log_address, page, log_page);
+        map_physical_to_SSD(log_address, &package, &die, &plane, &block, &page);
+        // logging translation
+        Address pba = Address(package, die, plane, block, log_page, PAGE);
+        event.set_address(pba);
+        return SUCCESS;
+      }
+      
+      FTL_LOG(1, log_file, "[translate] mapped log block has no free page\n");
+      
+      // this data block needs cleaning
+      if (over_erase_limit(data_address) == true) {
+        data_address = garbage.remap_data_block(logical_address - page,
+                                                data_address, log_address);
+        if (log_address == data_address) {
+          FTL_LOG(1, log_file, "[translate] data block remapping failed\n");
+          return FAILURE;
+        }
+      }
+      // this log block needs cleaning
+      if (over_erase_limit(log_address) == true) {
+        log_address = garbage.remap_log_block(logical_address - page,
+                                              data_address, log_address);
+        if (log_address == data_address) {
+          FTL_LOG(1, log_file, "[translate] log block remapping failed\n");
+          return FAILURE;
+        }
+      }
+      if (garbage.switch_merge(logical_address - page, data_address, log_address)) {
+        // the log block is the data block now, log to the old data block
+        unsigned long old_data_address = data_address;
+        data_address = log_address;
+        log_address = old_data_address;
+        set_log_block(data_address, log_address);
+      }
+      else if (garbage.clean(logical_address - page, data_address, log_address) == false) {
+        FTL_LOG(1, log_file, "[translate] cleaning failed\n");
+        return FAILURE;
+      }
+      else {
+        // the logical block was merged into another data block
+        data_address = check_physical_address(logical_address) - page;
+        set_log_block(data_address, log_address);
+      }
+      
+      // give the first page of this cleaned log block
+      open_log_desc(log_address);
+      append_log_page(log_address, page);
+      FTL_LOG(2, log_file, 
+        "[translate] after cleaning, log block %lu wrote page %u to log page 0\n",
+        log_address, page);
+      map_physical_to_SSD(log_address, &package, &die, &plane, &block, &page);
+      // logging translation
+      Address pba = Address(package, die, plane, block, 0, PAGE);
+      event.set_address(pba);
+      return SUCCESS;
+    }
+    
+    // check if there is a free log block
+    if (garbage.next_unmapped_log_block(&log_address, &package, &die, &plane, &block,
+                                        block_temperature(logical_address / BLOCK_PAGES),
+                                        data_address / BLOCK_PAGES)) {
+      FTL_LOG(2, log_file, "[translate] found free log block (%u,%u,%u,%u,0)\n",
+        package, die, plane, block);
+      // a shuffle to free the log block may have moved this logical block
+      data_address = check_physical_address(logical_address) - page;
+      // map log block to data block
+      set_log_block(data_address, log_address);
+      open_log_desc(log_address);
+      append_log_page(log_address, page);
+      FTL_LOG(2, log_file, 
+        "[translate] log block pba %lu wrote page %u to log page 0\n", log_address, page);
+      // logging translation
+      Address pba = Address(package, die, plane, block, 0, PAGE);
+      event.set_address(pba);
+      return SUCCESS;
+    }
+
+    FTL_LOG(1, log_file, "[translate] fail to rotate log blocks\n");
+    return FAILURE;
+  }
+
+  if (operation == READ) {
+    // check if page is valid
+    if (check_page_empty(logical_address)) {
+      FTL_LOG(2, log_file, "[translate] read a empty page\n");
+      return FAILURE; 
+    }
+    
+    // check if log block mapped to data block
+    if (check_log_block(data_address, &log_address)) {
+      FTL_LOG(2, log_file, 
+        "[translate] data block %lu maps to log block %lu\n",
+        data_address, log_address);
+      // check if there is a corresponding page in log block
+      unsigned int log_page;
+      if (fetch_log_page(log_address, page, &log_page)) {
+        // read from recent copy of page in log block
+        map_physical_to_SSD(log_address, &package, &die, &plane, &block, &page);
+        Address pba = Address(package, die, plane, block, log_page, PAGE);
+        event.set_address(pba);
+        FTL_LOG(2, log_file, "[translate] reading page %u in log block\n", log_page);
+        return SUCCESS;
+      }
+    }
+    
+    // read from original calculated page
+    Address pba = Address(package, die, plane, block, page, PAGE);
+    event.set_address(pba);
+    FTL_LOG(2, log_file, "[translate] reading original data block page\n");
+    return SUCCESS;
+  }
+
+  FTL_LOG(1, log_file, "[translate] unkown operation\n");
+  return FAILURE;
+}
+
+/**
+ * @brief Clean the log block chosen by the policy at the time of the event
+ */
+enum status Garbage_collector::collect(Event &event, enum GC_POLICY policy)
+{
+  ftl_scope scope(ftl.state);
+  current->start_time = event.get_start_time();
+  if (FTL_MODE == PAGE_MAPPED)
+    return reclaim_page_block() ? SUCCESS : FAILURE;
+  if (FTL_MODE == SHARED_LOGS)
+    return reclaim_random_log() ? SUCCESS : FAILURE;
+  if (reclaim_log_block(policy) == false)
+    return FAILURE;
+  return SUCCESS;
+}
+
+enum status Wear_leveler::level( Event &event __attribute__((unused)))
+{
+  /*
+   * No need to use this function
+   */
+  return FAILURE;
+}
@@ -0,0 +1,77 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_geometry.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Geometry class
+ *
+ * The geometry holds the sizes of one SSD and everything derived from them,
+ * so the hardware classes and the FTL do not recompute them from the config
+ * globals on every use.  The address split and join functions are inline in
+ * ssd.h.
+ */
+
+#include <stdio.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+Geometry::Geometry(unsigned int ssd_size, unsigned int package_size, unsigned int die_size, unsigned int plane_size, unsigned int block_size, double overprovisioning)
+{
+	unsigned int level;
+
+	if(ssd_size == 0 || package_size == 0 || die_size == 0 || plane_size == 0 || block_size == 0)
+	{
+		fprintf(stderr, "Geometry error: %s: constructor received a size of 0\n", __func__);
+		exit(FILE_ERR);
+	}
+#ifdef FIXED_GEOMETRY
+	/* the config file must describe the geometry the build was fixed to */
+	if(ssd_size != FIXED_SSD_SIZE || package_size != FIXED_PACKAGE_SIZE || die_size != FIXED_DIE_SIZE || plane_size != FIXED_PLANE_SIZE || block_size != FIXED_BLOCK_SIZE)
+	{
+		fprintf(stderr, "Geometry error: %s: sizes %u %u %u %u %u do not match the FIXED_GEOMETRY build\n", __func__, ssd_size, package_size, die_size, plane_size, block_size);
+		exit(FILE_ERR);
+	}
+#endif
+
+	sizes[NONE] = 1;
+	sizes[PACKAGE] = ssd_size;
+	sizes[DIE] = package_size;
+	sizes[PLANE] = die_size;
+	sizes[BLOCK] = plane_size;
+	sizes[PAGE] = block_size;
+	for(level = NONE; level <= PAGE; level++)
+	{
+		shifts[level] = -1;
+		if((sizes[level] & (sizes[level] - 1)) == 0)
+			for(shifts[level] = 0; (1u << shifts[level]) < sizes[level]; shifts[level]++);
+	}
+
+	die_blocks = (unsigned long) die_size * plane_size;
+	package_blocks = die_blocks * package_size;
+	physical_blocks = package_blocks * ssd_size;
+	raw_pages = physical_blocks * block_size;
+
+	/* the logical blocks are the whole blocks left past the
+	 * 	overprovisioning; a partial block left over joins the
+	 * 	overprovisioning, so the usable pages are always whole blocks */
+	logical_blocks = (unsigned int) ((raw_pages - (unsigned long) ((raw_pages * overprovisioning) / 100)) / block_size);
+	usable_pages = (unsigned long) logical_blocks * block_size;
+	op_pages = raw_pages - usable_pages;
+	op_blocks = op_pages / block_size;
+	return;
+}
@@ -32,24 +32,13 @@
 
 using namespace ssd;
 
-Package::Package(const ssd::Ssd &parent, Channel &channel, unsigned int package_size):
+Package::Package(const ssd::Ssd &parent, Channel &channel, Flash_store &store, unsigned long first_block, unsigned int package_size):
 	size(package_size),
 
 	/* use a const pointer (Die * const data) to use as an array
 	 * but like a reference, we cannot reseat the pointer */
 	data((Die *) malloc(package_size * sizeof(Die))),
-	parent(parent),
-
-	/* assume all Dies are same so first one can start as least worn */
-	least_worn(0),
-
-	/* set erases remaining to BLOCK_ERASES to match Block constructor args 
-	 * in Plane class
-	 * this is the cheap implementation but can change to pass through classes */
-	erases_remaining(BLOCK_ERASES),
-
-	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0)
+	parent(parent)
 {
 	unsigned int i;
 
@@ -66,7 +55,7 @@ Package::Package(const ssd::Ssd &parent, Channel &channel, unsigned int package_
 	}
 
 	for(i = 0; i < size; i++)
-		(void) new (&data[i]) Die(*this, channel, DIE_SIZE);
+		(void) new (&data[i]) Die(*this, channel, store, first_block + i * store.get_geometry().get_die_blocks(), store.get_geometry().get_die_size());
 	return;
 }
 
@@ -97,10 +86,7 @@ enum status Package::write(Event &event)
 enum status Package::erase(Event &event)
 {
 	assert(data != NULL && event.get_address().die < size && event.get_address().valid > PACKAGE);
-	enum status status = data[event.get_address().die].erase(event);
-	if(status == SUCCESS)
-		update_wear_stats(event.get_address());
-	return status;
+	return data[event.get_address().die].erase(event);
 }
 
 enum status Package::merge(Event &event)
@@ -114,47 +100,47 @@ const Ssd &Package::get_parent(void)
 	return parent;
 }
 
-/* if given a valid Block address, call the Block's method
- * else return local value */
+/* if given a valid Die address, call the Die's method
+ * else return the time of the latest erase in the package */
 double Package::get_last_erase_time(const Address &address) const
 {
 	assert(data != NULL);
+	unsigned int i;
+	double latest = 0.0;
 	if(address.valid > PACKAGE && address.die < size)
 		return data[address.die].get_last_erase_time(address);
-	else
-		return last_erase_time;
+	for(i = 0; i < size; i++)
+		if(data[i].get_last_erase_time(address) > latest)
+			latest = data[i].get_last_erase_time(address);
+	return latest;
 }
 
 /* if given a valid Die address, call the Die's method
- * else return local value */
+ * else return the erases remaining of the least worn die */
 unsigned long Package::get_erases_remaining(const Address &address) const
 {
 	assert(data != NULL);
+	unsigned int i;
+	unsigned long max = 0;
 	if(address.valid > PACKAGE && address.die < size)
 		return data[address.die].get_erases_remaining(address);
-	else
-		return erases_remaining;
-}
-
-/* Plane with the most erases remaining is the least worn */
-void Package::update_wear_stats(const Address &address)
-{
-	unsigned int i;
-	unsigned int max_index = 0;
-	unsigned long max = data[0].get_erases_remaining(address);
-	for(i = 1; i < size; i++)
+	for(i = 0; i < size; i++)
 		if(data[i].get_erases_remaining(address) > max)
-			max_index = i;
-	least_worn = max_index;
-	erases_remaining = max;
-	last_erase_time = data[max_index].get_last_erase_time(address);
-	return;
+			max = data[i].get_erases_remaining(address);
+	return max;
 }
 
-/* update given address -> package to least worn package */
+/* update given address -> die to least worn die
+ * Die with the most erases remaining is the least worn */
 void Package::get_least_worn(Address &address) const
 {
-	assert(least_worn < size);
+	unsigned int i;
+	unsigned int least_worn = 0;
+	Address package_address(address);
+	package_address.valid = PACKAGE;
+	for(i = 1; i < size; i++)
+		if(data[i].get_erases_remaining(package_address) > data[least_worn].get_erases_remaining(package_address))
+			least_worn = i;
 	address.die = least_worn;
 	address.valid = DIE;
 	data[least_worn].get_least_worn(address);
@@ -184,3 +170,20 @@ unsigned int Package::get_num_valid(const Address &address) const
 	assert(address.valid >= DIE);
 	return data[address.die].get_num_valid(address);
 }
+
+/* the state of the dies, see Ssd::save_snapshot */
+void Package::save(Snapshot &snapshot) const
+{
+	unsigned int i;
+	for(i = 0; i < size; i++)
+		data[i].save(snapshot);
+	return;
+}
+
+void Package::load(Snapshot &snapshot)
+{
+	unsigned int i;
+	for(i = 0; i < size; i++)
+		data[i].load(snapshot);
+	return;
+}
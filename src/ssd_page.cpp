@@ -21,7 +21,9 @@
  * Brendan Tauras 2009-04-06
  *
  * The page is the lowest level data storage unit that is the size unit of
- * requests (events).  Pages maintain their state as events modify them. */
+ * requests (events).  Pages maintain their state as events modify them.
+ * The state itself lives in the Flash_store, so a Page is only a view that
+ * is created as needed. */
 
 #include <assert.h>
 #include <stdio.h>
@@ -29,36 +31,18 @@
 
 using namespace ssd;
 
-Page::Page(const Block &parent, double read_delay, double write_delay):
-	state(EMPTY),
-	parent(parent),
-	read_delay(read_delay),
-	write_delay(write_delay)
-{
-	state = EMPTY;
-
-	if(read_delay < 0.0){
-		fprintf(stderr, "Page warning: %s: constructor received negative read delay value\n\tsetting read delay to 0.0\n", __func__);
-		this -> read_delay = 0.0;
-	}
-
-	if(write_delay < 0.0){
-		fprintf(stderr, "Page warning: %s: constructor received negative write delay value\n\tsetting write delay to 0.0\n", __func__);
-		this -> write_delay = 0.0;
-	}
-	return;
-}
-
-Page::~Page(void)
+Page::Page(Flash_store &store, unsigned long index):
+	store(store),
+	index(index)
 {
 	return;
 }
 
 enum status Page::_read(Event &event)
 {
-	assert(read_delay >= 0.0);
-	if(state == VALID){
-		event.incr_time_taken(read_delay);
+	assert(store.page_read_delay >= 0.0);
+	if(store.get_page_state(index) == VALID){
+		event.incr_time_taken(store.page_read_delay);
 		return SUCCESS;
 	} else {
     fprintf(stderr, "Trying to read invalid page\n");
@@ -68,10 +52,10 @@ enum status Page::_read(Event &event)
 
 enum status Page::_write(Event &event)
 {
-	assert(write_delay >= 0.0);
-	if(state == EMPTY){
-		event.incr_time_taken(write_delay);
-		state = VALID;
+	assert(store.page_write_delay >= 0.0);
+	if(store.get_page_state(index) == EMPTY){
+		event.incr_time_taken(store.page_write_delay);
+		store.set_page_state(index, VALID);
 		return SUCCESS;
 	} else {
     fprintf(stderr, "Trying to write invalid page\n");
@@ -79,18 +63,13 @@ enum status Page::_write(Event &event)
   }
 }
 
-const Block &Page::get_parent(void) const
-{
-	return parent;
-}
-
 enum page_state Page::get_state(void) const
 {
-	return state;
+	return store.get_page_state(index);
 }
 
 void Page::set_state(enum page_state state)
 {
-	this -> state = state;
+	store.set_page_state(index, state);
 	return;
 }
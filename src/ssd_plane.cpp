@@ -21,8 +21,10 @@
  * Brendan Tauras 2009-11-03
  *
  * The plane is the data storage hardware unit that contains blocks.
- * Plane-level merges are implemented in the plane.  Planes maintain wear
- * statistics for the FTL. */
+ * Plane-level merges and page copybacks are implemented in the plane.  Planes
+ * maintain wear
+ * statistics for the FTL.  Block state lives in the Flash_store and the plane
+ * views its blocks through it. */
 
 #include <new>
 #include <assert.h>
@@ -31,28 +33,18 @@
 
 using namespace ssd;
 
-Plane::Plane(const Die &parent, unsigned int plane_size, double reg_read_delay, double reg_write_delay):
+Plane::Plane(const Die &parent, Flash_store &store, unsigned long first_block, unsigned int plane_size, double reg_read_delay, double reg_write_delay):
 	size(plane_size),
 
-	/* use a const pointer (Block * const data) to use as an array
-	 * but like a reference, we cannot reseat the pointer */
-	data((Block *) malloc(size * sizeof(Block))),
+	/* the blocks of this plane are the store's blocks starting at first_block */
+	store(store),
+	first_block(first_block),
 
 	parent(parent),
 
-	/* assume all Blocks are same so first one can start as least worn */
-	least_worn(0),
-
-	/* set erases remaining to BLOCK_ERASES to match Block constructor args */
-	erases_remaining(BLOCK_ERASES),
-
-	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0),
-
-	free_blocks(size)
+	free_blocks(size),
+	busy_until(0.0)
 {
-	unsigned int i;
-
 	if(reg_read_delay < 0.0)
 	{  
 		fprintf(stderr, "Plane error: %s: constructor received negative register read delay value\n\tsetting register read delay to 0.0\n", __func__);
@@ -77,53 +69,53 @@ Plane::Plane(const Die &parent, unsigned int plane_size, double reg_read_delay,
 	next_page.page = 0;
 	next_page.valid = PAGE;
 
-	/* new cannot initialize an array with constructor args so
-	 * 	malloc the array
-	 * 	then use placement new to call the constructor for each element
-	 * chose an array over container class so we don't have to rely on anything
-	 * 	i.e. STL's std::vector */
-	/* array allocated in initializer list:
- 	 * data = (Block *) malloc(size * sizeof(Block)); */
-	if(data == NULL){
-		fprintf(stderr, "Plane error: %s: constructor unable to allocate Block data\n", __func__);
-		exit(MEM_ERR);
-	}
-
-	for(i = 0; i < size; i++)
-		(void) new (&data[i]) Block(*this, BLOCK_SIZE, BLOCK_ERASES, BLOCK_ERASE_DELAY);
-
 	return;
 }
 
 Plane::~Plane(void)
 {
-	assert(data != NULL);
-	unsigned int i;
-	/* call destructor for each Block array element
-	 * since we used malloc and placement new */
-	for(i = 0; i < size; i++)
-		data[i].~Block();
-	free(data);
+	return;
+}
+
+/* view of a block in this plane */
+Block Plane::get_block(unsigned int block) const
+{
+	assert(block < size);
+	return Block(store, first_block + block);
+}
+
+/* the plane runs one array operation at a time
+ * delay the event until the operations already scheduled on the plane finish */
+void Plane::wait_idle(Event &event) const
+{
+	if(busy_until > event.get_finish_time())
+		(void) event.incr_time_taken(busy_until - event.get_finish_time());
 	return;
 }
 
 enum status Plane::read(Event &event)
 {
 	assert(event.get_address().block < size && event.get_address().valid > PLANE);
-	return data[event.get_address().block].read(event);
+	wait_idle(event);
+	enum status status = get_block(event.get_address().block).read(event);
+	busy_until = event.get_finish_time();
+	return status;
 }
 
 enum status Plane::write(Event &event)
 {
 	assert(event.get_address().block < size && event.get_address().valid > PLANE && next_page.valid >= BLOCK);
-	enum block_state prev = data[event.get_address().block].get_state();
+	enum block_state prev = get_block(event.get_address().block).get_state();
 	if(event.get_address().block == next_page.block)
 		/* if all blocks in the plane are full and this function fails,
 		 * the next_page address valid field will be set to PLANE */
 		(void) get_next_page();
-	if(prev == FREE && data[event.get_address().block].get_state() != FREE)
+	if(prev == FREE && get_block(event.get_address().block).get_state() != FREE)
 		free_blocks--;
-	return data[event.get_address().block].write(event);
+	wait_idle(event);
+	enum status status = get_block(event.get_address().block).write(event);
+	busy_until = event.get_finish_time();
+	return status;
 }
 
 /* if no errors
@@ -133,12 +125,14 @@ enum status Plane::write(Event &event)
 enum status Plane::erase(Event &event)
 {
 	assert(event.get_address().block < size && event.get_address().valid > PLANE);
-	enum status status = data[event.get_address().block]._erase(event);
+	wait_idle(event);
+	enum status status = get_block(event.get_address().block)._erase(event);
+	busy_until = event.get_finish_time();
 
-	/* update values if no errors */
+	/* update values if no errors
+	 * the wear summary is updated by the flash store */
 	if(status == 1)
 	{
-		update_wear_stats();
 		free_blocks++;
 
 		/* set next free page if plane was completely full */
@@ -148,6 +142,45 @@ enum status Plane::erase(Event &event)
 	return status;
 }
 
+/* copyback: read the page at event::address into the plane register and
+ * 	program it to the empty page at event::merge_address without using the
+ * 	bus
+ * the source page is left valid until its block is erased, as with a read
+ * 	followed by a write */
+enum status Plane::copyback(Event &event)
+{
+	assert(event.get_address().block < size && event.get_address().valid == PAGE);
+	assert(event.get_merge_address().block < size && event.get_merge_address().valid == PAGE);
+	assert(reg_read_delay >= 0.0 && reg_write_delay >= 0.0);
+	const Address &merge_address = event.get_merge_address();
+	Event read_event(READ, event.get_logical_address(), 1, event.get_start_time());
+	Event write_event(WRITE, event.get_logical_address(), 1, event.get_start_time());
+	read_event.set_address(event.get_address());
+	write_event.set_address(merge_address);
+
+	wait_idle(event);
+	if(get_block(event.get_address().block).read(read_event) == FAILURE)
+	{
+		fprintf(stderr, "Plane error: %s: Read for copyback of block %d page %d failed\n", __func__, event.get_address().block, event.get_address().page);
+		return FAILURE;
+	}
+
+	/* same bookkeeping as Plane::write */
+	enum block_state prev = get_block(merge_address.block).get_state();
+	if(merge_address.block == next_page.block)
+		(void) get_next_page();
+	if(prev == FREE && get_block(merge_address.block).get_state() != FREE)
+		free_blocks--;
+	if(get_block(merge_address.block).write(write_event) == FAILURE)
+	{
+		fprintf(stderr, "Plane error: %s: Write for copyback into block %d page %d failed\n", __func__, merge_address.block, merge_address.page);
+		return FAILURE;
+	}
+	(void) event.incr_time_taken(read_event.get_time_taken() + reg_write_delay + reg_read_delay + write_event.get_time_taken());
+	busy_until = event.get_finish_time();
+	return SUCCESS;
+}
+
 /* handle everything for a merge operation
  * 	address.block and address_merge.block must be valid
  * 	move event::address valid pages to event::address_merge empty pages
@@ -168,17 +201,17 @@ enum status Plane::_merge(Event &event)
 	const Address &merge_address = event.get_merge_address();
 	assert(address.compare(merge_address) >= BLOCK);
 	assert(address.block < size && merge_address.block < size);
-	unsigned int block_size = data[address.block].get_size();
-	unsigned int merge_block_size = data[merge_address.block].get_size();
+	unsigned int block_size = get_block(address.block).get_size();
+	unsigned int merge_block_size = get_block(merge_address.block).get_size();
 
 	/* how many pages must be moved */
 	for(i = 0; i < block_size; i++)
-		if(data[address.block].get_state(i) == VALID)
+		if(get_block(address.block).get_state(i) == VALID)
 			merge_count++;
 	
 	/* how many pages are available */
 	for(i = 0; i < merge_block_size; i++)
-		if(data[merge_address.block].get_state(i) == EMPTY)
+		if(get_block(merge_address.block).get_state(i) == EMPTY)
 			merge_avail++;
 
 	/* fail if not enough space to do the merge */
@@ -205,15 +238,15 @@ enum status Plane::_merge(Event &event)
 	for(i = 0; num_merged < merge_count && read.page < block_size; read.page++)
 	{
 		/* find next page to read from */
-		if(data[read.block].get_state(read.page) == VALID)
+		if(get_block(read.block).get_state(read.page) == VALID)
 		{
 			/* read from page and set status to invalid */
-			if(data[read.block].read(read_event) == 0)
+			if(get_block(read.block).read(read_event) == 0)
 			{
 				fprintf(stderr, "Plane error: %s: Read for merge block %d into %d failed\n", __func__, read.block, write.block);
 				i++;
 			}
-			data[read.block].invalidate_page(read.page);
+			get_block(read.block).invalidate_page(read.page);
 
 			/* get time taken for read and plane register write
 			 * read event time will accumulate and be added at end */
@@ -223,10 +256,10 @@ enum status Plane::_merge(Event &event)
 			for(; write.page < merge_block_size; write.page++)
 			{
 				/* find next page to write to */
-				if(data[write.block].get_state(write.page) == EMPTY)
+				if(get_block(write.block).get_state(write.page) == EMPTY)
 				{
 					/* write to page (page::_write() sets status to valid) */
-					if(data[merge_address.block].write(write_event) == 0)
+					if(get_block(merge_address.block).write(write_event) == 0)
 					{
 						fprintf(stderr, "Plane error: %s: Write for merge block %d into %d failed\n", __func__, address.block, merge_address.block);
 						i++;
@@ -268,55 +301,49 @@ const Die &Plane::get_parent(void) const
 }
 
 /* if given a valid Block address, call the Block's method
- * else return local value */
+ * else return the time of the latest erase in the plane */
 double Plane::get_last_erase_time(const Address &address) const
 {
-	assert(data != NULL);
 	if(address.valid > PLANE && address.block < size)
-		return data[address.block].get_last_erase_time();
+		return get_block(address.block).get_last_erase_time();
 	else
-		return last_erase_time;
+		return get_wear_summary().last_erase_time;
 }
 
 /* if given a valid Block address, call the Block's method
- * else return local value */
+ * else return the erases remaining of the least worn block */
 unsigned long Plane::get_erases_remaining(const Address &address) const
 {
-	assert(data != NULL);
 	if(address.valid > PLANE && address.block < size)
-		return data[address.block].get_erases_remaining();
+		return get_block(address.block).get_erases_remaining();
 	else
-		return erases_remaining;
+		return BLOCK_ERASES - get_wear_summary().min_erases;
 }
 
-/* Block with the most erases remaining is the least worn */
-void Plane::update_wear_stats(void)
+/* update given address.block to least worn block
+ * Block with the most erases remaining is the least worn */
+void Plane::get_least_worn(Address &address) const
 {
 	unsigned int i;
-	unsigned int max_index = 0;
-	unsigned long max = data[0].get_erases_remaining();
-	for(i = 1; i < size; i++)
-		if(data[i].get_erases_remaining() > max)
-			max_index = i;
-	least_worn = max_index;
-	erases_remaining = max;
-	last_erase_time = data[max_index].get_last_erase_time();
+	unsigned long min_erases = get_wear_summary().min_erases;
+	for(i = 0; i < size - 1; i++)
+		if(BLOCK_ERASES - get_block(i).get_erases_remaining() == min_erases)
+			break;
+	address.block = i;
+	address.valid = BLOCK;
 	return;
 }
 
-/* update given address.block to least worn block */
-void Plane::get_least_worn(Address &address) const
+/* wear summary of the blocks in this plane, kept by the flash store */
+const struct wear_summary &Plane::get_wear_summary(void) const
 {
-	assert(least_worn < size);
-	address.block = least_worn;
-	address.valid = BLOCK;
-	return;
+	return store.get_wear_summary(first_block / size);
 }
 
 enum page_state Plane::get_state(const Address &address) const
 {  
-	assert(data != NULL && address.block < size && address.valid >= PLANE);
-	return data[address.block].get_state(address);
+	assert(address.block < size && address.valid >= PLANE);
+	return get_block(address.block).get_state(address);
 }
 
 /* update address to next free page in plane
@@ -340,10 +367,10 @@ enum status Plane::get_next_page(void)
 
 	for(i = 0; i < size; i++)
 	{
-		if(data[i].get_state() != INACTIVE)
+		if(get_block(i).get_state() != INACTIVE)
 		{
 			next_page.valid = BLOCK;
-			if(data[i].get_next_page(next_page) == SUCCESS)
+			if(get_block(i).get_next_page(next_page) == SUCCESS)
 			{
 				next_page.block = i;
 				return SUCCESS;
@@ -363,5 +390,27 @@ unsigned int Plane::get_num_free(const Address &address) const
 unsigned int Plane::get_num_valid(const Address &address) const
 {
 	assert(address.valid >= PLANE);
-	return data[address.block].get_pages_valid();
+	return get_block(address.block).get_pages_valid();
+}
+
+/* the plane timeline and the cached next page and free block count, see
+ * 	Ssd::save_snapshot */
+void Plane::save(Snapshot &snapshot) const
+{
+	unsigned int state[4] = {next_page.block, next_page.page, (unsigned int) next_page.valid, free_blocks};
+	snapshot.write_array(state, 4);
+	snapshot.write(&busy_until, sizeof(busy_until));
+	return;
+}
+
+void Plane::load(Snapshot &snapshot)
+{
+	unsigned int state[4];
+	snapshot.read_array(state, 4);
+	snapshot.read(&busy_until, sizeof(busy_until));
+	next_page.block = state[0];
+	next_page.page = state[1];
+	next_page.valid = (enum address_valid) state[2];
+	free_blocks = state[3];
+	return;
 }
@@ -59,7 +59,7 @@ static inline void swap(double *x, double *y)
  * because i can start at -1 */
 long partition(double *array1, double *array2, long left, long right)
 {
-	long pivot = array1[right];
+	double pivot = array1[right];
 	long i = left - 1;
 	long j;
 	for(j = left; j < right; j++)
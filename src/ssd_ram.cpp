@@ -24,6 +24,10 @@
  * This is a basic implementation that only provides delay updates to events
  * based on a delay value multiplied by the size (number of pages) needed to
  * be read or written.
+ *
+ * The Ram also keeps the write-back buffer of logical pages for the
+ * Controller.  Only the state of each buffered page is tracked: whether it is
+ * dirty and how recently it was used.
  */
 
 #include <assert.h>
@@ -33,10 +37,19 @@
 using namespace ssd;
 
  
-Ram::Ram(double read_delay, double write_delay):
+Ram::Ram(double read_delay, double write_delay, unsigned int buffer_size):
 	read_delay(read_delay),
-	write_delay(write_delay)
+	write_delay(write_delay),
+	buffer_size(buffer_size)
 {
+	stats.read_hits = 0;
+	stats.read_misses = 0;
+	stats.write_hits = 0;
+	stats.write_misses = 0;
+	stats.overwrites_absorbed = 0;
+	stats.flushes = 0;
+	stats.pages_flushed = 0;
+
 	if(read_delay <= 0)
 	{
 		fprintf(stderr, "RAM: %s: constructor received negative read delay value\n\tsetting read delay to 0.0\n", __func__);
@@ -68,3 +81,151 @@ enum status Ram::write(Event &event)
 	(void) event.incr_time_taken(write_delay * event.get_size());
 	return SUCCESS;
 }
+
+/* look up a logical page for a read or write request and count the hit or miss
+ * a hit becomes the most recently used page, and a write hit leaves it dirty
+ * returns true on a hit */
+bool Ram::buffer_lookup(unsigned long logical_address, bool write)
+{
+	std::map<unsigned long, struct buffer_entry>::iterator entry = buffer.find(logical_address);
+	if(entry == buffer.end())
+	{
+		if(write)
+			stats.write_misses++;
+		else
+			stats.read_misses++;
+		return false;
+	}
+	if(write)
+	{
+		stats.write_hits++;
+		if(entry -> second.dirty)
+			stats.overwrites_absorbed++;
+		entry -> second.dirty = true;
+	}
+	else
+		stats.read_hits++;
+	lru.splice(lru.end(), lru, entry -> second.position);
+	return true;
+}
+
+bool Ram::buffer_full(void) const
+{
+	return buffer.size() >= buffer_size;
+}
+
+/* add a page missing from the buffer as the most recently used page
+ * make room first with buffer_victim if the buffer is full */
+void Ram::buffer_insert(unsigned long logical_address, bool dirty)
+{
+	assert(buffer.find(logical_address) == buffer.end() && !buffer_full());
+	struct buffer_entry entry;
+	entry.dirty = dirty;
+	entry.position = lru.insert(lru.end(), logical_address);
+	buffer[logical_address] = entry;
+	return;
+}
+
+void Ram::buffer_remove(unsigned long logical_address)
+{
+	std::map<unsigned long, struct buffer_entry>::iterator entry = buffer.find(logical_address);
+	if(entry == buffer.end())
+		return;
+	lru.erase(entry -> second.position);
+	buffer.erase(entry);
+	return;
+}
+
+/* choose the page to evict from a non-empty buffer by WRITE_BUFFER_POLICY
+ * CFLRU prefers the least recently used clean page within the window so dirty
+ * pages stay buffered longer to absorb overwrites */
+unsigned long Ram::buffer_victim(void) const
+{
+	assert(!lru.empty());
+	if(WRITE_BUFFER_POLICY == BUFFER_CFLRU)
+	{
+		unsigned int i = 0;
+		std::list<unsigned long>::const_iterator cur;
+		for(cur = lru.begin(); cur != lru.end() && i < WRITE_BUFFER_WINDOW; cur++, i++)
+			if(!buffer.find(*cur) -> second.dirty)
+				return *cur;
+	}
+	return lru.front();
+}
+
+bool Ram::buffer_holds(unsigned long logical_address) const
+{
+	return buffer.find(logical_address) != buffer.end();
+}
+
+bool Ram::buffer_dirty(unsigned long logical_address) const
+{
+	std::map<unsigned long, struct buffer_entry>::const_iterator entry = buffer.find(logical_address);
+	return entry != buffer.end() && entry -> second.dirty;
+}
+
+/* mark a page clean after it was written to the flash */
+void Ram::buffer_clean(unsigned long logical_address)
+{
+	std::map<unsigned long, struct buffer_entry>::iterator entry = buffer.find(logical_address);
+	assert(entry != buffer.end() && entry -> second.dirty);
+	entry -> second.dirty = false;
+	stats.pages_flushed++;
+	return;
+}
+
+/* list the dirty pages among count logical pages from first, in order */
+void Ram::buffer_dirty_pages(unsigned long first, unsigned long count, std::vector<unsigned long> &pages) const
+{
+	std::map<unsigned long, struct buffer_entry>::const_iterator entry;
+	pages.clear();
+	for(entry = buffer.lower_bound(first); entry != buffer.end() && entry -> first < first + count; entry++)
+		if(entry -> second.dirty)
+			pages.push_back(entry -> first);
+	return;
+}
+
+/* count a batch of pages written back to the flash */
+void Ram::buffer_flushed(void)
+{
+	stats.flushes++;
+	return;
+}
+
+const struct buffer_stats &Ram::get_buffer_stats(void) const
+{
+	return stats;
+}
+
+/* the buffered pages from least to most recently used and whether each is
+ * 	dirty, see Ssd::save_snapshot; the statistics are not saved */
+void Ram::save(Snapshot &snapshot) const
+{
+	std::vector<unsigned long> pages(lru.begin(), lru.end());
+	std::vector<unsigned char> dirty;
+	std::vector<unsigned long>::iterator page;
+	for(page = pages.begin(); page != pages.end(); page++)
+		dirty.push_back(buffer_dirty(*page));
+	snapshot.write_vector(pages);
+	snapshot.write_vector(dirty);
+	return;
+}
+
+void Ram::load(Snapshot &snapshot)
+{
+	std::vector<unsigned long> pages;
+	std::vector<unsigned char> dirty;
+	unsigned int i;
+	snapshot.read_vector(pages);
+	snapshot.read_vector(dirty);
+	if(dirty.size() != pages.size() || pages.size() > buffer_size)
+	{
+		fprintf(stderr, "Ram error: %s: snapshot holds %lu buffered pages, the buffer holds %u\n", __func__, (unsigned long) pages.size(), buffer_size);
+		exit(FILE_ERR);
+	}
+	buffer.clear();
+	lru.clear();
+	for(i = 0; i < pages.size(); i++)
+		buffer_insert(pages[i], dirty[i] != 0);
+	return;
+}
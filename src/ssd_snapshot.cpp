@@ -0,0 +1,202 @@
+/* Copyright 2009, 2010 Brendan Tauras */
+
+/* ssd_snapshot.cpp is part of FlashSim. */
+
+/* FlashSim is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version. */
+
+/* FlashSim is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details. */
+
+/* You should have received a copy of the GNU General Public License
+ * along with FlashSim.  If not, see <http://www.gnu.org/licenses/>. */
+
+/****************************************************************************/
+
+/* Snapshot class
+ *
+ * Reads and writes the sections of a snapshot file.  What the sections hold
+ * is up to the classes that save their state in them, see
+ * Ssd::save_snapshot.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ssd.h"
+
+using namespace ssd;
+
+/* the header of a snapshot file, changed with the layout of the sections */
+#define SNAPSHOT_MAGIC "FSIMSNAP"
+#define SNAPSHOT_VERSION 3ULL
+
+/* sections are padded so each starts 8-byte aligned in the mapping */
+#define SNAPSHOT_ALIGN 8
+
+Snapshot::Snapshot(void):
+	path(NULL),
+	file(NULL),
+	map(NULL),
+	map_size(0),
+	offset(0),
+	failed(false)
+{
+	return;
+}
+
+Snapshot::~Snapshot(void)
+{
+	(void) close();
+	return;
+}
+
+/* start writing a snapshot to path, replacing the file */
+enum status Snapshot::create(const char *path)
+{
+	uint64_t version = SNAPSHOT_VERSION;
+
+	assert(file == NULL && map == NULL);
+	this -> path = path;
+	failed = false;
+	file = fopen(path, "wb");
+	if(file == NULL)
+	{
+		fprintf(stderr, "Snapshot error: %s: unable to create %s\n", __func__, path);
+		return FAILURE;
+	}
+	if(fwrite(SNAPSHOT_MAGIC, 1, 8, file) != 8 || fwrite(&version, sizeof(version), 1, file) != 1)
+		failed = true;
+	return SUCCESS;
+}
+
+/* map a snapshot file at path for reading */
+enum status Snapshot::open(const char *path)
+{
+	int fd;
+	struct stat info;
+	void *mapping;
+	uint64_t version;
+
+	assert(file == NULL && map == NULL);
+	this -> path = path;
+	failed = false;
+	fd = ::open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		fprintf(stderr, "Snapshot error: %s: unable to open %s\n", __func__, path);
+		return FAILURE;
+	}
+	if(fstat(fd, &info) != 0 || info.st_size < 16)
+	{
+		fprintf(stderr, "Snapshot error: %s: %s is not a snapshot\n", __func__, path);
+		(void) ::close(fd);
+		return FAILURE;
+	}
+	mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) ::close(fd);
+	if(mapping == MAP_FAILED)
+	{
+		fprintf(stderr, "Snapshot error: %s: unable to map %s\n", __func__, path);
+		return FAILURE;
+	}
+	map = (const unsigned char *) mapping;
+	map_size = info.st_size;
+	memcpy(&version, map + 8, sizeof(version));
+	if(memcmp(map, SNAPSHOT_MAGIC, 8) != 0 || version != SNAPSHOT_VERSION)
+	{
+		fprintf(stderr, "Snapshot error: %s: %s is not a version %llu snapshot\n", __func__, path, SNAPSHOT_VERSION);
+		(void) close();
+		return FAILURE;
+	}
+	offset = 16;
+	return SUCCESS;
+}
+
+/* finish writing or reading
+ * returns FAILURE if any section could not be written */
+enum status Snapshot::close(void)
+{
+	enum status status = SUCCESS;
+
+	if(file != NULL)
+	{
+		if(fclose(file) != 0)
+			failed = true;
+		file = NULL;
+		if(failed)
+		{
+			fprintf(stderr, "Snapshot error: %s: unable to write %s\n", __func__, path);
+			status = FAILURE;
+		}
+	}
+	if(map != NULL)
+	{
+		(void) munmap((void *) map, map_size);
+		map = NULL;
+		map_size = 0;
+		offset = 0;
+	}
+	return status;
+}
+
+/* append a section holding size bytes at data */
+void Snapshot::write(const void *data, size_t size)
+{
+	static const unsigned char padding[SNAPSHOT_ALIGN] = {0};
+	uint64_t length = size;
+	size_t pad = (SNAPSHOT_ALIGN - size % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+
+	assert(file != NULL);
+	if(failed)
+		return;
+	if(fwrite(&length, sizeof(length), 1, file) != 1
+		|| (size > 0 && fwrite(data, 1, size, file) != size)
+		|| (pad > 0 && fwrite(padding, 1, pad, file) != pad))
+		failed = true;
+	return;
+}
+
+/* the length of the next section, which must fit in the mapping */
+size_t Snapshot::next_length(void)
+{
+	uint64_t length;
+
+	assert(map != NULL);
+	if(offset + sizeof(length) > map_size)
+	{
+		fprintf(stderr, "Snapshot error: %s: %s ends early\n", __func__, path);
+		exit(FILE_ERR);
+	}
+	memcpy(&length, map + offset, sizeof(length));
+	if(length > map_size - offset - sizeof(length))
+	{
+		fprintf(stderr, "Snapshot error: %s: %s ends early\n", __func__, path);
+		exit(FILE_ERR);
+	}
+	return length;
+}
+
+/* copy the next section, which must hold size bytes, to data */
+void Snapshot::read(void *data, size_t size)
+{
+	size_t length = next_length();
+
+	if(length != size)
+	{
+		fprintf(stderr, "Snapshot error: %s: %s has a section of %lu bytes where %lu were expected\n", __func__, path, (unsigned long) length, (unsigned long) size);
+		exit(FILE_ERR);
+	}
+	if(size > 0)
+		memcpy(data, map + offset + sizeof(uint64_t), size);
+	offset += sizeof(uint64_t) + size + (SNAPSHOT_ALIGN - size % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN;
+	return;
+}
@@ -24,48 +24,47 @@
  * SSD.  Creating a SSD causes all other objects in the SSD to be created.  The
  * event_arrive method is where events will arrive from DiskSim. */
 
+#include <algorithm>
 #include <cmath>
 #include <new>
 #include <assert.h>
 #include <stdio.h>
-#include <string>
-#include <map>
+#include <string.h>
 #include "ssd.h"
 
 using namespace ssd;
 
-static bool reads_passed;
-static bool writes_passed;
-static bool valid_op;
-std::map<std::string, std::map<unsigned long, Address>> block_map;
+/* marks a logical page with no physical page in the checker tables */
+#define NO_PHYSICAL_PAGE ((unsigned long) -1)
 
 /* use caution when editing the initialization list - initialization actually
  * occurs in the order of declaration in the class definition and not in the
  * order listed here */
-Ssd::Ssd(FILE *log_file, unsigned int ssd_size): 
+Ssd::Ssd(FILE *log_file, const Geometry &geometry): 
   log_file(log_file),
-	size(ssd_size), 
+	geometry(geometry),
+	size(geometry.get_ssd_size()), 
 	controller(*this, log_file), 
 	ram(RAM_READ_DELAY, RAM_WRITE_DELAY), 
 	bus(size, BUS_CTRL_DELAY, BUS_DATA_DELAY, BUS_TABLE_SIZE, BUS_MAX_CONNECT), 
 
+	/* page and block state for the whole SSD that the hardware classes view */
+	store(geometry, BLOCK_ERASES, PAGE_READ_DELAY, PAGE_WRITE_DELAY, BLOCK_ERASE_DELAY),
+
 	/* use a const pointer (Package * const data) to use as an array
 	 * but like a reference, we cannot reseat the pointer */
-	data((Package *) malloc(ssd_size * sizeof(Package))), 
-
-	/* set erases remaining to BLOCK_ERASES to match Block constructor args 
-	 *	in Plane class
-	 * this is the cheap implementation but can change to pass through classes */
-	erases_remaining(BLOCK_ERASES), 
-
-	/* assume all Planes are same so first one can start as least worn */
-	least_worn(0), 
-
-	/* assume hardware created at time 0 and had an implied free erasure */
-	last_erase_time(0.0),
+	data((Package *) malloc(size * sizeof(Package))), 
   total_erases_performed(0),
   total_writes_observed(0),
-  max_num_erases(0)
+	next_seq(0),
+	outstanding(0),
+	now(0.0),
+	gc_until(0.0),
+	trace_ring(TRACE_RING_SIZE),
+	trace_next(0),
+	trace_count(0),
+	total_host_writes(0),
+	reported_writes(0)
 {
 	unsigned int i;
 
@@ -80,14 +79,23 @@ Ssd::Ssd(FILE *log_file, unsigned int ssd_size):
 		fprintf(log_file, "Ssd error: %s: constructor unable to allocate Package data\n", __func__);
 		exit(MEM_ERR);
 	}
-	for (i = 0; i < ssd_size; i++)
+	for (i = 0; i < size; i++)
 	{
-		(void) new (&data[i]) Package(*this, bus.get_channel(i), PACKAGE_SIZE);
+		(void) new (&data[i]) Package(*this, bus.get_channel(i), store, i * geometry.get_package_blocks(), geometry.get_package_size());
 	}
 
+  /* logical pages can range over the whole raw size of the ssd */
+  if(CONSISTENCY_CHECK) {
+    ref_map.assign(geometry.get_raw_pages(), NO_PHYSICAL_PAGE);
+    unread_block.assign(geometry.get_raw_pages(), NO_PHYSICAL_PAGE);
+    unread_pages.assign(store.get_num_blocks(), 0);
+  }
+
   reads_passed = true;
   writes_passed = true;
 	valid_op = true;
+	memset(&request_stats, 0, sizeof(request_stats));
+	memset(&report_totals, 0, sizeof(report_totals));
   return;
 }
 
@@ -113,17 +121,10 @@ Ssd::~Ssd(void)
 double Ssd::event_arrive(enum event_type type, unsigned long logical_address, unsigned int size, double start_time, int *status, Address &address)
 {
 	assert(start_time >= 0.0);
-	assert((long long int) logical_address < (long long int) SSD_SIZE * PACKAGE_SIZE * DIE_SIZE * PLANE_SIZE * BLOCK_SIZE);
+	assert(logical_address < geometry.get_raw_pages());
 
-	/* allocate the event and address dynamically so that the allocator can
-	 * handle efficiency issues for us */
-	Event *event = NULL;
-
-	if((event = new Event(type, logical_address, size, start_time)) == NULL)
-	{
-		fprintf(log_file, "Ssd error: %s: could not allocate Event\n", __func__);
-		exit(MEM_ERR);
-	}
+	/* take the event from the pool so steady-state requests do not allocate */
+	Event *event = events.alloc(type, logical_address, size, start_time);
 
 	/* REAL SSD ONLY */
   *status = controller.event_arrive(*event);
@@ -136,12 +137,351 @@ double Ssd::event_arrive(enum event_type type, unsigned long logical_address, un
 
   //event -> print(log_file);
 
+	record_request(type, (enum status) *status, event -> get_start_time(), (*status == SUCCESS) ? size : 0, event -> get_time_taken(), event -> get_bus_wait_time());
+
 	/* use start_time as a temporary for returning time taken to service event */
 	start_time = event -> get_time_taken();
-	delete event;
+	events.free(*event);
 	return start_time;
 }
 
+/* Service an array of multi-page or scatter-gather requests, filling one
+ * 	completion per request
+ * This is a convenience wrapper that calls Ssd::service for each request in
+ * 	array order, at its own start time and without a queue depth limit.  No
+ * 	work is shared between the requests, so it costs the same as servicing
+ * 	them one at a time. */
+void Ssd::submit_batch(const struct request *reqs, size_t n, struct completion *out)
+{
+	size_t i;
+
+	assert(reqs != NULL && out != NULL);
+	for(i = 0; i < n; i++)
+		service(reqs[i], reqs[i].start_time, out[i]);
+	return;
+}
+
+/* Split a request into single-page events that all start at issue_time and
+ * 	translate and issue them in one pass, then consolidate them with the
+ * 	request's metaevent.  Pages that the FTL maps to different dies and
+ * 	channels overlap, so the time taken is the finish time of the last page
+ * 	rather than a sum.
+ * Pages of a request are issued in order so later pages see the FTL state
+ * 	left by earlier ones, exactly as separate event_arrive calls would.
+ * The time taken is with respect to the request's start time, so it includes
+ * 	any time waited before issue_time. */
+void Ssd::service(const struct request &req, double issue_time, struct completion &out)
+{
+	unsigned int j;
+	unsigned long logical_address;
+	Event *head = NULL;
+	Event *tail = NULL;
+
+	assert(req.start_time >= 0.0 && issue_time >= req.start_time);
+	out.status = SUCCESS;
+	out.time_taken = issue_time - req.start_time;
+	out.bus_wait_time = 0.0;
+	out.queue_wait_time = issue_time - req.start_time;
+	out.pages_failed = 0;
+
+	for(j = 0; j < req.size; j++)
+	{
+		logical_address = (req.pages != NULL) ? req.pages[j] : req.logical_address + j;
+		assert(logical_address < geometry.get_raw_pages());
+
+		/* issue the page before linking it so the FTL only sees this page */
+		Event *page = events.alloc(req.type, logical_address, 1, issue_time);
+		if(controller.event_arrive(*page) != SUCCESS)
+		{
+			fprintf(log_file, "Ssd error: %s: request page failed:\n", __func__);
+			page -> print(log_file);
+			out.status = FAILURE;
+			out.pages_failed++;
+		}
+		if(head == NULL)
+			head = page;
+		else
+			tail -> set_next(*page);
+		tail = page;
+	}
+	if(head == NULL)
+		return;
+
+	Event *metaevent = events.alloc(req.type, (req.pages != NULL) ? req.pages[0] : req.logical_address, req.size, issue_time);
+	metaevent -> consolidate_metaevent(*head);
+	out.time_taken += metaevent -> get_time_taken();
+	out.bus_wait_time = metaevent -> get_bus_wait_time();
+	events.free(*metaevent);
+	events.free(*head);
+	record_request(req.type, out.status, req.start_time, req.size - out.pages_failed, out.time_taken, out.bus_wait_time);
+	return;
+}
+
+/* add a simulated time to a histogram, taking the time units as seconds */
+static void add_latency(struct latency_histogram &histogram, double time)
+{
+	unsigned int bucket = 0;
+	double limit = 0.000001;
+	while(bucket < LATENCY_HISTOGRAM_BUCKETS - 1 && time >= limit)
+	{
+		bucket++;
+		limit *= 2;
+	}
+	histogram.buckets[bucket]++;
+	histogram.count++;
+	histogram.total += time;
+	if(time > histogram.max)
+		histogram.max = time;
+	return;
+}
+
+/* bucket of a simulated time in a percentile histogram */
+static unsigned int percentile_bucket(double time)
+{
+	uint64_t nanoseconds;
+	unsigned int exponent = 0;
+	if(time >= 1.0e9)
+		return PERCENTILE_BUCKETS - 1;
+	nanoseconds = (time > 0.0) ? (uint64_t) (time * 1.0e9) : 0;
+	if(nanoseconds < PERCENTILE_SUB_BUCKETS)
+		return (unsigned int) nanoseconds;
+	while(nanoseconds >> (exponent + 1) >= PERCENTILE_SUB_BUCKETS)
+		exponent++;
+	return (exponent + 1) * PERCENTILE_SUB_BUCKETS + (unsigned int) (nanoseconds >> exponent) - PERCENTILE_SUB_BUCKETS;
+}
+
+/* largest simulated time counted in a percentile histogram bucket */
+static double percentile_bucket_limit(unsigned int bucket)
+{
+	unsigned int exponent = bucket / PERCENTILE_SUB_BUCKETS;
+	uint64_t nanoseconds = bucket % PERCENTILE_SUB_BUCKETS;
+	if(exponent > 0)
+		nanoseconds = ((nanoseconds + PERCENTILE_SUB_BUCKETS + 1) << (exponent - 1)) - 1;
+	return nanoseconds / 1.0e9;
+}
+
+/* smallest bucket limit that at least fraction of the times are within,
+ * 	0 for an empty histogram */
+static double percentile(const struct percentile_histogram &histogram, double fraction)
+{
+	unsigned int i;
+	unsigned long seen = 0;
+	unsigned long rank = (unsigned long) (fraction * histogram.count);
+	if(histogram.count == 0)
+		return 0.0;
+	if(rank < fraction * histogram.count)
+		rank++;
+	if(rank == 0)
+		rank = 1;
+	for(i = 0; i < PERCENTILE_BUCKETS; i++)
+	{
+		seen += histogram.buckets[i];
+		if(seen >= rank)
+			break;
+	}
+	return percentile_bucket_limit(i);
+}
+
+/* account a finished host request in the request stats and its report window
+ * 	pages is the number of pages the request served
+ * A failed request is only counted as failed, its time taken is not a
+ * 	latency the host saw served */
+void Ssd::record_request(enum event_type type, enum status status, double start_time, unsigned int pages, double time_taken, double bus_wait_time)
+{
+	unsigned long window = (REPORT_WINDOW > 0.0) ? (unsigned long) (start_time / REPORT_WINDOW) : 0;
+	unsigned int bucket = percentile_bucket(time_taken);
+	unsigned long flash_writes = total_writes_observed - reported_writes;
+	if(type != READ && type != WRITE)
+		return;
+
+	std::map<unsigned long, struct report_window>::iterator it = report_windows.find(window);
+	if(it == report_windows.end())
+	{
+		struct report_window empty;
+		memset(&empty, 0, sizeof(empty));
+		empty.start_time = window * REPORT_WINDOW;
+		it = report_windows.insert(std::make_pair(window, empty)).first;
+	}
+	struct report_window &current = it -> second;
+	reported_writes = total_writes_observed;
+	current.flash_writes += flash_writes;
+	report_totals.flash_writes += flash_writes;
+	if(type == WRITE)
+	{
+		current.host_writes += pages;
+		report_totals.host_writes += pages;
+		total_host_writes += pages;
+	}
+
+	if(status != SUCCESS)
+	{
+		current.failed++;
+		report_totals.failed++;
+		return;
+	}
+	if(type == READ)
+	{
+		add_latency(request_stats.read_latency, time_taken);
+		current.read_latency.buckets[bucket]++;
+		current.read_latency.count++;
+		report_totals.read_latency.buckets[bucket]++;
+		report_totals.read_latency.count++;
+	}
+	else
+	{
+		add_latency(request_stats.write_latency, time_taken);
+		current.write_latency.buckets[bucket]++;
+		current.write_latency.count++;
+		report_totals.write_latency.buckets[bucket]++;
+		report_totals.write_latency.count++;
+	}
+	add_latency(request_stats.bus_wait, bus_wait_time);
+	return;
+}
+
+/* keep a flash operation issued by the controller in the trace ring,
+ * 	overwriting the oldest one when the ring is full */
+void Ssd::record_trace(const Event &event, enum status status)
+{
+	if(trace_ring.empty())
+		return;
+	struct trace_entry &entry = trace_ring[trace_next];
+	const Address &address = event.get_address();
+	entry.start_time = event.get_start_time();
+	entry.finish_time = event.get_finish_time();
+	entry.logical_address = event.get_logical_address();
+	entry.physical_page = (address.valid >= BLOCK) ? store.get_block_index(address) * geometry.get_block_size() + ((address.valid >= PAGE) ? address.page : 0) : 0;
+	entry.type = event.get_event_type();
+	entry.status = status;
+	trace_next = (trace_next + 1) % trace_ring.size();
+	trace_count++;
+	return;
+}
+
+/* write the operations in the trace ring to stream as struct trace_entry
+ * 	records, oldest first
+ * returns the number of records written */
+unsigned long Ssd::dump_trace(FILE *stream) const
+{
+	unsigned long kept = (trace_count < trace_ring.size()) ? trace_count : trace_ring.size();
+	unsigned long first = (trace_count < trace_ring.size()) ? 0 : trace_next;
+	unsigned long written = 0;
+	if(kept == 0)
+		return 0;
+	written += fwrite(&trace_ring[first], sizeof(struct trace_entry), kept - first, stream);
+	if(first > 0)
+		written += fwrite(&trace_ring[0], sizeof(struct trace_entry), first, stream);
+	return written;
+}
+
+/* order the engine heaps by time, then by submission order */
+static bool later(const struct pending_io &a, const struct pending_io &b)
+{
+	return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+}
+
+/* Accept a request for the discrete-event engine
+ * The request is issued when Ssd::run reaches its start time and a queue
+ * 	slot is free, and the callback is called when Ssd::run reaches its
+ * 	completion.  A scatter-gather page list must stay valid until the
+ * 	request is issued. */
+void Ssd::submit(const struct request &req, completion_callback callback, void *context)
+{
+	assert(req.start_time >= 0.0);
+	struct pending_io io;
+	io.req = req;
+	io.callback = callback;
+	io.context = context;
+	io.seq = next_seq++;
+	io.time = req.start_time;
+	arrivals.push_back(io);
+	std::push_heap(arrivals.begin(), arrivals.end(), later);
+	return;
+}
+
+/* Advance the simulated time to until, issuing accepted requests and calling
+ * 	completion callbacks in time order
+ * A completion frees its queue slot before a request arriving at the same
+ * 	time is issued.  A request that arrives while QUEUE_DEPTH requests are
+ * 	outstanding is issued at the next completion.
+ * The hardware timelines are updated when a request is issued, so issuing in
+ * 	time order lets channels, dies and planes see requests in the order they
+ * 	use them.
+ * With BACKGROUND_GC, the FTL cleans in the idle gaps before arrivals and
+ * 	after each request while free log blocks are below GC_LOW_WATERMARK. */
+void Ssd::run(double until)
+{
+	struct pending_io io;
+
+	for(;;)
+	{
+		if(BACKGROUND_GC && outstanding == 0)
+			collect_idle((arrivals.empty() || arrivals.front().time > until) ? until : arrivals.front().time);
+
+		bool can_issue = !arrivals.empty() && outstanding < QUEUE_DEPTH && arrivals.front().time <= until;
+		bool can_complete = !completions.empty() && completions.front().time <= until;
+
+		if(can_complete && (!can_issue || completions.front().time <= std::max(arrivals.front().time, now)))
+		{
+			/* copy out of the heap first, the callback may submit more requests */
+			std::pop_heap(completions.begin(), completions.end(), later);
+			io = completions.back();
+			completions.pop_back();
+			outstanding--;
+			if(io.time > now)
+				now = io.time;
+			if(io.callback != NULL)
+				io.callback(io.req, io.done, io.context);
+		}
+		else if(can_issue)
+		{
+			std::pop_heap(arrivals.begin(), arrivals.end(), later);
+			io = arrivals.back();
+			arrivals.pop_back();
+			if(io.time > now)
+				now = io.time;
+			service(io.req, now, io.done);
+			io.time = io.req.start_time + io.done.time_taken;
+			completions.push_back(io);
+			std::push_heap(completions.begin(), completions.end(), later);
+			outstanding++;
+
+			/* clean behind the request so it does not wait for the cleaning */
+			if(BACKGROUND_GC)
+				(void) controller.background_collect(std::max(now, gc_until), false, &gc_until);
+		}
+		else
+			break;
+	}
+	if(until > now && until != HUGE_VAL)
+		now = until;
+	return;
+}
+
+/* clean in steps while the device is idle before next_arrival
+ * a step that starts in the gap may finish after it, but no new step starts
+ * 	once a request is due, so arriving requests wait for at most one step on
+ * 	the dies the step uses */
+void Ssd::collect_idle(double next_arrival)
+{
+	double start = std::max(now, gc_until);
+	while(start < next_arrival && controller.background_collect(start, true, &gc_until) == SUCCESS)
+		start = gc_until;
+	return;
+}
+
+/* run until every accepted request has completed */
+void Ssd::drain(void)
+{
+	run(HUGE_VAL);
+	return;
+}
+
+unsigned int Ssd::get_outstanding(void) const
+{
+	return outstanding;
+}
+
 unsigned long Ssd::get_total_writes_observed()
 {
   return total_writes_observed;
@@ -149,148 +489,166 @@ unsigned long Ssd::get_total_writes_observed()
 
 unsigned long Ssd::get_pages_per_block()
 {
-  return BLOCK_SIZE;
+  return geometry.get_block_size();
+}
+
+/* record an event with the consistency checker and the counters before its
+ * 	flash operations run, see Controller::prepare_event
+ * the checker only looks at addresses, so the operations of independent
+ * 	events may run later and on other threads
+ * returns FAILURE if the event must not reach the hardware */
+enum status Ssd::prepare(Event &event)
+{
+  if(event.get_event_type() == READ) {
+    /*
+     * We remove the entry for the LBA which is read at least once, since it has to be read at least once
+     * before cleaning is performed.
+     */
+    if(CONSISTENCY_CHECK) {
+      unsigned long block = store.get_block_index(event.get_address());
+      if(unread_block[event.get_logical_address()] == block) {
+        unread_block[event.get_logical_address()] = NO_PHYSICAL_PAGE;
+        unread_pages[block]--;
+      }
+    }
+  }
+  else if(event.get_event_type() == WRITE) {
+    /*
+     * We record the block of the write to validate if we perform a read on it before erases occur.
+     */
+    if(CONSISTENCY_CHECK) {
+      unsigned long lba = event.get_logical_address();
+      unsigned long block = store.get_block_index(event.get_address());
+      if(unread_block[lba] != NO_PHYSICAL_PAGE) {
+        /*
+         * Remove stale entry.
+         */
+        unread_pages[unread_block[lba]]--;
+      }
+      unread_block[lba] = block;
+      unread_pages[block]++;
+
+      /*
+       * update ref_map with latest location of write.
+       */
+      ref_map[lba] = store.get_page_index(event.get_address());
+    }
+    total_writes_observed++;
+  }
+  else if(event.get_event_type() == ERASE) {
+    /*
+     * Only erase a block once every page written to it has been read at least
+     * once since, so we are sure the data was seen before it is lost.
+     */
+    if(CONSISTENCY_CHECK && unread_pages[store.get_block_index(event.get_address())] != 0) {
+      reads_passed = false;
+      return FAILURE;
+    }
+    total_erases_performed++;
+  }
+  else if(event.get_event_type() == MERGE) {
+    if(event.get_address().compare(event.get_merge_address()) < DIE)
+    {
+      fprintf(stderr, "Ssd error: %s: merge across dies is not supported\n", __func__);
+      return FAILURE;
+    }
+    if(event.get_address().valid < PAGE || event.get_merge_address().valid < PAGE) {
+      if(CONSISTENCY_CHECK)
+        valid_op = false;
+      return SUCCESS;
+    }
+    /*
+     * The copy reads the source page and records the destination like a write.
+     */
+    if(CONSISTENCY_CHECK) {
+      unsigned long lba = event.get_logical_address();
+      unsigned long block = store.get_block_index(event.get_merge_address());
+      if(unread_block[lba] != NO_PHYSICAL_PAGE)
+        unread_pages[unread_block[lba]]--;
+      unread_block[lba] = block;
+      unread_pages[block]++;
+      ref_map[lba] = store.get_page_index(event.get_merge_address());
+    }
+    total_writes_observed++;
+  }
+  return SUCCESS;
 }
 
 /* read write erase and merge should only pass on the event
  * 	the Controller should lock the bus channels
  * technically the Package is conceptual, but we keep track of statistics
  * 	and addresses with Packages, so send Events through Package but do not 
- * 	have Package do anything but update its statistics and pass on to Die */
+ * 	have Package do anything but update its statistics and pass on to Die
+ * they touch nothing outside the event's package, so the dispatcher may call
+ * 	them for different packages at once */
 enum status Ssd::read(Event &event)
 {
-  char block_str_copy[255] = "";
-  std::map<unsigned long, Address>::iterator inner_block_map_it;
 	assert(data != NULL && event.get_address().package < size && event.get_address().valid >= PACKAGE);
-  /*
-   * We remove the entry for the LBA which is read at least once, since it has to be read at least once
-   * before cleaning is performed.
-   */
-  snprintf(block_str_copy, 255, "%u,%u,%u,%u", event.get_address().package, event.get_address().die, event.get_address().plane, event.get_address().block);
-  std::string block_str = block_str_copy;
-  inner_block_map_it = (block_map[block_str]).find(event.get_logical_address());
-  if(inner_block_map_it != (block_map[block_str]).end()) {
-    (block_map[block_str]).erase(event.get_logical_address());
-  }
 	return data[event.get_address().package].read(event);
 }
 
 enum status Ssd::write(Event &event)
 {
-  Address prev_addr;
-  std::map<unsigned long, Address>::iterator ref_map_it;
-  std::map<unsigned long, Address>::iterator inner_block_map_it;
-  char block_str_copy[255] = "";
-  assert(data != NULL && event.get_address().package < size && event.get_address().valid >= PACKAGE);
-  /*
-   * We insert an Address to block_map to validate if we perform a read on it before erases occur.
-   */
-  ref_map_it = ref_map.find(event.get_logical_address());
-  if(ref_map_it != ref_map.end()) {
-    /*
-     * Remove stale entry.
-     */
-    prev_addr = ref_map[event.get_logical_address()];
-    snprintf(block_str_copy, 255, "%u,%u,%u,%u", prev_addr.package, prev_addr.die, prev_addr.plane, prev_addr.block);
-    std::string block_str = block_str_copy;
-    inner_block_map_it = (block_map[block_str]).find(event.get_logical_address());
-    if(inner_block_map_it != (block_map[block_str]).end()) {
-      (block_map[block_str]).erase(event.get_logical_address());
-    }
-  }
-  snprintf(block_str_copy, 255, "%u,%u,%u,%u", event.get_address().package, event.get_address().die, event.get_address().plane, event.get_address().block);
-  std::string block_str = block_str_copy;
-  (block_map[block_str])[event.get_logical_address()] = event.get_address();
-  total_writes_observed++;
-
-  /*
-   * update ref_map with latest location of write.
-   */
-  ref_map[event.get_logical_address()] = event.get_address();
+	assert(data != NULL && event.get_address().package < size && event.get_address().valid >= PACKAGE);
 	return data[event.get_address().package].write(event);
 }
 
+/* wear statistics are updated by the flash store */
 enum status Ssd::erase(Event &event)
 {
-  Address addr;
-  std::map<unsigned long, Address>::iterator inner_block_map_it;
-  std::map<unsigned long, Address>::iterator ref_map_it;
-  char block_str_copy[255] = "";
-
 	assert(data != NULL && event.get_address().package < size && event.get_address().valid >= PACKAGE);
-  /*
-   * First check if block_map contains an empty map, only then are we sure that
-   * we have seen at least one read for each page in ref_map before we are about
-   * to erase the block.
-   */
-  snprintf(block_str_copy, 255, "%u,%u,%u,%u", event.get_address().package, event.get_address().die, event.get_address().plane, event.get_address().block);
-  std::string block_str = block_str_copy;
-  if((block_map[block_str]).size() != 0) {
-    reads_passed = false;
-    return FAILURE;
-  }
-
-  for(inner_block_map_it = (block_map[block_str]).begin(); inner_block_map_it != (block_map[block_str]).end(); inner_block_map_it++) {
-    ref_map_it = ref_map.find(inner_block_map_it->first);
-    if(ref_map_it != ref_map.end()) {
-      addr = ref_map_it->second;
-      if((addr.package == event.get_address().package) && (addr.die == event.get_address().die) && (addr.plane == event.get_address().plane) && (addr.block == event.get_address().block)) {
-        writes_passed = false;
-        return FAILURE;
-      }
-    }
-  }
+	return data[event.get_address().package].erase(event);
+}
 
-	enum status status = data[event.get_address().package].erase(event);
-  total_erases_performed++;
-	/* update values if no errors */
-	if (status == SUCCESS) {
-		update_wear_stats(event.get_address());
-    if(get_erases_remaining(event.get_address()) < (BLOCK_ERASES-max_num_erases)) {
-      max_num_erases = (BLOCK_ERASES - get_erases_remaining(event.get_address()));
+/* the data of trimmed pages may be lost, so the consistency checker stops
+ * 	expecting them to be read before their blocks are erased */
+void Ssd::trim(const Event &event)
+{
+  if(!CONSISTENCY_CHECK)
+    return;
+  unsigned long lba;
+  for(lba = event.get_logical_address(); lba < event.get_logical_address() + event.get_size() && lba < ref_map.size(); lba++) {
+    if(unread_block[lba] != NO_PHYSICAL_PAGE) {
+      unread_pages[unread_block[lba]]--;
+      unread_block[lba] = NO_PHYSICAL_PAGE;
     }
+    ref_map[lba] = NO_PHYSICAL_PAGE;
   }
-	return status;
 }
 
+/* merges stay inside a die, so the data never crosses the bus
+ * the checker follows a copyback of a single page like a read of the source
+ * 	followed by a write of the destination, but it cannot tell the logical
+ * 	pages of a whole block merge apart */
 enum status Ssd::merge(Event &event)
 {
-  valid_op = false;
-  return FAILURE;
 	assert(data != NULL && event.get_address().package < size && event.get_address().valid >= PACKAGE);
 	return data[event.get_address().package].merge(event);
 }
 
-/* add up the erases remaining for all packages in the ssd*/
+/* if given a valid Package address, call the Package's method
+ * else return the erases remaining of the least worn block in the ssd */
 unsigned long Ssd::get_erases_remaining(const Address &address) const
 {
 	assert (data != NULL);
 	
 	if (address.package < size && address.valid >= PACKAGE)
 		return data[address.package].get_erases_remaining(address);
-	else return erases_remaining;
-}
-
-void Ssd::update_wear_stats(const Address &address)
-{
-	assert(data != NULL);
-	unsigned int i;
-	unsigned int max_index = 0;
-	unsigned long max = data[0].get_erases_remaining(address);
-	for(i = 1; i < size; i++)
-		if(data[i].get_erases_remaining(address) > max)
-			max_index = i;
-	least_worn = max_index;
-	erases_remaining = max;
-	last_erase_time = data[max_index].get_last_erase_time(address);
-	return;
+	else return BLOCK_ERASES - store.get_wear_summary().min_erases;
 }
 
 void Ssd::get_least_worn(Address &address) const
 {
   valid_op = false;
   return;
-	assert(data != NULL && least_worn < size);
+	assert(data != NULL);
+	unsigned int i;
+	unsigned int least_worn = 0;
+	Address ssd_address(address);
+	ssd_address.valid = NONE;
+	for(i = 1; i < size; i++)
+		if(data[i].get_erases_remaining(ssd_address) > data[least_worn].get_erases_remaining(ssd_address))
+			least_worn = i;
 	address.package = least_worn;
 	address.valid = PACKAGE;
 	data[least_worn].get_least_worn(address);
@@ -305,7 +663,7 @@ double Ssd::get_last_erase_time(const Address &address) const
 	if(address.package < size && address.valid >= PACKAGE)
 		return data[address.package].get_last_erase_time(address);
 	else
-		return last_erase_time;
+		return store.get_wear_summary().last_erase_time;
 }
 
 enum page_state Ssd::get_state(const Address &address) const
@@ -347,7 +705,8 @@ unsigned long Ssd::get_total_erases_performed()
 
 void Ssd::write_ref_map(unsigned long lba, Address pba)
 {
-  ref_map[lba] = pba;
+  if(CONSISTENCY_CHECK)
+    ref_map[lba] = store.get_page_index(pba);
 }
 
 unsigned long Ssd::get_max_num_erases()
@@ -356,32 +715,309 @@ unsigned long Ssd::get_max_num_erases()
    * This function returns the max_erases left of
    * any block in the entire SSD.
    */
-  Address addr;
-  unsigned int package, die, plane, block;
-  unsigned long max_erases_remaining = 0;
-  for(package = 0; package < SSD_SIZE; package++) {
-    for(die = 0; die < PACKAGE_SIZE; die++) {
-      for(plane = 0; plane < DIE_SIZE; plane++) {
-        for(block = 0; block < PLANE_SIZE; block++) {
-          addr = Address(package, die, plane, block, 0, PAGE);
-          if(data[addr.package].get_erases_remaining(addr) > max_erases_remaining) {
-            max_erases_remaining = data[addr.package].get_erases_remaining(addr);
-          }
-        }
-      }
-    }
-  }
-  return max_erases_remaining;
-  //return max_num_erases;
+  return BLOCK_ERASES - store.get_wear_summary().min_erases;
+}
+
+/* wear statistics of the whole ssd */
+const struct wear_summary &Ssd::get_wear_summary(void) const
+{
+	return store.get_wear_summary();
+}
+
+/* wear statistics of the plane at address */
+const struct wear_summary &Ssd::get_wear_summary(const Address &address) const
+{
+	assert(address.package < size && address.valid >= PLANE);
+	return store.get_wear_summary(geometry.get_plane_index(address));
+}
+
+/* hit and overwrite counts of the write buffer in RAM */
+const struct buffer_stats &Ssd::get_buffer_stats(void) const
+{
+	return ram.get_buffer_stats();
+}
+
+const struct ftl_stats &Ssd::get_ftl_stats(void) const
+{
+	return controller.get_ftl_stats();
+}
+
+const struct request_stats &Ssd::get_request_stats(void) const
+{
+	return request_stats;
 }
 
+/* pages written by the host, not counting pages of failed writes */
+unsigned long Ssd::get_total_host_writes(void) const
+{
+	return total_host_writes;
+}
+
+/* flash pages programmed, garbage collection copies included, per page
+ * 	written by the host, 0 before the first host write
+ * pages still held or merged away in the write buffer were never
+ * 	programmed, so this can be below 1 */
+double Ssd::get_write_amplification(void) const
+{
+	if(total_host_writes == 0)
+		return 0.0;
+	return (double) total_writes_observed / total_host_writes;
+}
+
+/* simulated time that fraction of the host reads or writes so far were
+ * 	served within, see struct percentile_histogram for the precision */
+double Ssd::get_latency_percentile(enum event_type type, double fraction) const
+{
+	assert(fraction >= 0.0 && fraction <= 1.0);
+	assert(type == READ || type == WRITE);
+	return percentile((type == READ) ? report_totals.read_latency : report_totals.write_latency, fraction);
+}
+
+/* print one line of the report for a window or the whole run */
+static void print_report_window(FILE *stream, const char *label, const struct report_window &window)
+{
+	fprintf(stream, "%s: reads %lu p50 %.9lf p99 %.9lf p999 %.9lf writes %lu p50 %.9lf p99 %.9lf p999 %.9lf failed %lu host pages %lu flash pages %lu", label,
+		window.read_latency.count, percentile(window.read_latency, 0.5), percentile(window.read_latency, 0.99), percentile(window.read_latency, 0.999),
+		window.write_latency.count, percentile(window.write_latency, 0.5), percentile(window.write_latency, 0.99), percentile(window.write_latency, 0.999),
+		window.failed, window.host_writes, window.flash_writes);
+	if(window.host_writes > 0)
+		fprintf(stream, " wa %.3lf", (double) window.flash_writes / window.host_writes);
+	fprintf(stream, "\n");
+	return;
+}
+
+/* Print the write amplification, the erase count distribution of the blocks
+ * 	and the p50, p99 and p999 read and write latencies and the failed
+ * 	requests of each REPORT_WINDOW and of the whole run, for sizing
+ * 	OVERPROVISIONING from a single run
+ * The latencies are of the requests that succeeded only.
+ * Requests are placed in the window of their start time and the flash pages
+ * 	programmed in the window of the request that caused them, so background
+ * 	cleaning counts toward the next request recorded. */
+void Ssd::print_report(FILE *stream) const
+{
+	unsigned int i;
+	char label[64];
+	const struct wear_summary &wear = store.get_wear_summary();
+	const struct ftl_stats &stats = controller.get_ftl_stats();
+	std::map<unsigned long, struct report_window>::const_iterator it;
+
+	if(stream == NULL)
+		stream = stdout;
+	fprintf(stream, "host pages written: %lu\n", total_host_writes);
+	fprintf(stream, "flash pages written: %lu (gc copies %lu, copybacks %lu)\n", total_writes_observed, stats.gc_page_copies, stats.copybacks);
+	fprintf(stream, "write amplification: %.3lf\n", get_write_amplification());
+	fprintf(stream, "erases: %lu per block min %lu max %lu mean %.3lf\n", wear.total_erases, wear.min_erases, wear.max_erases, (double) wear.total_erases / store.get_num_blocks());
+
+	/* the wear summary buckets span all of BLOCK_ERASES, so bucket the
+	 * 	blocks again over the erase counts they actually reached */
+	unsigned long histogram[WEAR_HISTOGRAM_BUCKETS] = {0};
+	unsigned long width = (wear.max_erases - wear.min_erases) / WEAR_HISTOGRAM_BUCKETS + 1;
+	unsigned long block;
+	for(block = 0; block < store.get_num_blocks(); block++)
+		histogram[(BLOCK_ERASES - store.get_erases_remaining(block) - wear.min_erases) / width]++;
+	for(i = 0; i < WEAR_HISTOGRAM_BUCKETS; i++)
+		if(histogram[i] > 0)
+			fprintf(stream, "	erases %lu-%lu: %lu blocks\n", wear.min_erases + i * width, wear.min_erases + (i + 1) * width - 1, histogram[i]);
+	if(REPORT_WINDOW > 0.0)
+		for(it = report_windows.begin(); it != report_windows.end(); it++)
+		{
+			snprintf(label, sizeof(label), "window %.9lf", it -> second.start_time);
+			print_report_window(stream, label, it -> second);
+		}
+	print_report_window(stream, "total", report_totals);
+	return;
+}
+
+const Geometry &Ssd::get_geometry(void) const
+{
+	return geometry;
+}
+
+/* what the Ssd that loads a snapshot must agree on with the one that saved
+ * 	it: the geometry and the config entries that size or interpret the
+ * 	saved tables */
+struct snapshot_config
+{
+	uint64_t raw_pages;
+	uint64_t op_pages;
+	uint32_t sizes[5];
+	uint32_t block_erases;
+	uint32_t ftl_mode;
+	uint32_t block_striping;
+	uint32_t map_cache_size;
+	uint32_t map_entries_per_page;
+	uint32_t write_buffer_size;
+	uint32_t bus_table_size;
+	uint32_t consistency_check;
+	uint32_t padding;
+};
+
+static void get_snapshot_config(const Geometry &geometry, struct snapshot_config &config)
+{
+	memset(&config, 0, sizeof(config));
+	config.raw_pages = geometry.get_raw_pages();
+	config.op_pages = geometry.get_op_pages();
+	config.sizes[0] = geometry.get_ssd_size();
+	config.sizes[1] = geometry.get_package_size();
+	config.sizes[2] = geometry.get_die_size();
+	config.sizes[3] = geometry.get_plane_size();
+	config.sizes[4] = geometry.get_block_size();
+	config.block_erases = BLOCK_ERASES;
+	config.ftl_mode = FTL_MODE;
+	config.block_striping = BLOCK_STRIPING;
+	config.map_cache_size = MAP_CACHE_SIZE;
+	config.map_entries_per_page = MAP_ENTRIES_PER_PAGE;
+	config.write_buffer_size = WRITE_BUFFER_SIZE;
+	config.bus_table_size = BUS_TABLE_SIZE;
+	config.consistency_check = CONSISTENCY_CHECK;
+	return;
+}
+
+/* the counters, times and checker results of the Ssd, saved as one section */
+struct snapshot_ssd
+{
+	uint64_t total_erases_performed;
+	uint64_t total_writes_observed;
+	uint64_t total_host_writes;
+	double now;
+	double gc_until;
+	uint32_t reads_passed;
+	uint32_t writes_passed;
+	uint32_t valid_op;
+	uint32_t padding;
+};
+
+/* Save the state of the SSD to a snapshot file at path, so later runs can
+ * 	start from it with load_snapshot instead of preconditioning the drive
+ * The snapshot holds the flash store, the die, plane and channel timelines,
+ * 	the write buffer, every FTL table, the consistency checker tables and
+ * 	the lifetime host write, flash write and erase counters and FTL work
+ * 	counters, so the write amplification and the garbage collection copies
+ * 	cover the whole life of the drive.  Request statistics,
+ * 	the latency percentiles and the trace ring are left out, so a loaded SSD
+ * 	reports the latencies of the requests it serves itself.
+ * No request from Ssd::submit may be outstanding. */
+enum status Ssd::save_snapshot(const char *path)
+{
+	Snapshot snapshot;
+	struct snapshot_config config;
+	struct snapshot_ssd state;
+	unsigned int i;
+
+	if(!arrivals.empty() || outstanding > 0)
+	{
+		fprintf(log_file, "Ssd error: %s: requests are still outstanding\n", __func__);
+		return FAILURE;
+	}
+	if(snapshot.create(path) == FAILURE)
+		return FAILURE;
+	get_snapshot_config(geometry, config);
+	snapshot.write(&config, sizeof(config));
+
+	memset(&state, 0, sizeof(state));
+	state.total_erases_performed = total_erases_performed;
+	state.total_writes_observed = total_writes_observed;
+	state.total_host_writes = total_host_writes;
+	state.now = now;
+	state.gc_until = gc_until;
+	state.reads_passed = reads_passed;
+	state.writes_passed = writes_passed;
+	state.valid_op = valid_op;
+	snapshot.write(&state, sizeof(state));
+
+	store.save(snapshot);
+	for(i = 0; i < size; i++)
+		data[i].save(snapshot);
+	bus.save(snapshot);
+	ram.save(snapshot);
+	controller.get_ftl().save_ftl_user(snapshot);
+	snapshot.write_vector(ref_map);
+	snapshot.write_vector(unread_block);
+	snapshot.write_vector(unread_pages);
+	return snapshot.close();
+}
+
+/* Replace the state of the SSD with a snapshot file from save_snapshot
+ * The SSD must have the geometry and the table-sizing config entries of the
+ * 	one that saved the snapshot, otherwise FAILURE is returned and nothing
+ * 	is loaded.  The timing config entries and QUEUE_DEPTH may differ.
+ * No request from Ssd::submit may be outstanding, and request statistics
+ * 	and latency percentiles start over. */
+enum status Ssd::load_snapshot(const char *path)
+{
+	Snapshot snapshot;
+	struct snapshot_config config;
+	struct snapshot_config saved;
+	struct snapshot_ssd state;
+	unsigned int i;
+
+	if(!arrivals.empty() || outstanding > 0)
+	{
+		fprintf(log_file, "Ssd error: %s: requests are still outstanding\n", __func__);
+		return FAILURE;
+	}
+	if(snapshot.open(path) == FAILURE)
+		return FAILURE;
+	get_snapshot_config(geometry, config);
+	snapshot.read(&saved, sizeof(saved));
+	if(memcmp(&config, &saved, sizeof(config)) != 0)
+	{
+		fprintf(stderr, "Ssd error: %s: snapshot %s was saved with another geometry or FTL configuration\n", __func__, path);
+		(void) snapshot.close();
+		return FAILURE;
+	}
+
+	snapshot.read(&state, sizeof(state));
+	total_erases_performed = state.total_erases_performed;
+	total_writes_observed = state.total_writes_observed;
+	total_host_writes = state.total_host_writes;
+	now = state.now;
+	gc_until = state.gc_until;
+	reads_passed = state.reads_passed != 0;
+	writes_passed = state.writes_passed != 0;
+	valid_op = state.valid_op != 0;
+
+	store.load(snapshot);
+	for(i = 0; i < size; i++)
+		data[i].load(snapshot);
+	bus.load(snapshot);
+	ram.load(snapshot);
+	controller.get_ftl().load_ftl_user(snapshot);
+	snapshot.read_vector(ref_map);
+	snapshot.read_vector(unread_block);
+	snapshot.read_vector(unread_pages);
+
+	/* latencies cover the requests served after the load */
+	memset(&request_stats, 0, sizeof(request_stats));
+	memset(&report_totals, 0, sizeof(report_totals));
+	report_windows.clear();
+	reported_writes = total_writes_observed;
+	trace_next = 0;
+	trace_count = 0;
+	return snapshot.close();
+}
+
+/* the controller for drivers that exercise the FTL directly */
+Controller &Ssd::get_controller(void)
+{
+	return controller;
+}
+
+/*
+ * With the consistency checker off nothing is tracked, so only illegal
+ * operations are reported.
+ */
 bool Ssd::is_valid(unsigned long lba, Address validate_with)
 {
-  std::map<unsigned long, Address>::iterator validate_it = ref_map.find(lba);
-  Address addr;
-  if(validate_it != ref_map.end()) {
-    addr = validate_it->second;
-  } else {
+  if(!CONSISTENCY_CHECK)
+    return valid_op;
+
+  /* a request served by the write buffer has no flash address to check */
+  if(validate_with.valid == NONE && ram.buffer_holds(lba))
+    return reads_passed && writes_passed && valid_op;
+
+  if(lba >= ref_map.size() || ref_map[lba] == NO_PHYSICAL_PAGE) {
     fprintf(log_file, "LBA %lu is mapped to wrong physical address\n", lba);
     return false;
   }
@@ -401,7 +1037,7 @@ bool Ssd::is_valid(unsigned long lba, Address validate_with)
     return false;
   }
 
-  if(addr == validate_with) {
+  if(validate_with.valid == PAGE && validate_with.check_valid(geometry.get_ssd_size(), geometry.get_package_size(), geometry.get_die_size(), geometry.get_plane_size(), geometry.get_block_size()) == PAGE && ref_map[lba] == store.get_page_index(validate_with)) {
     return true;
   }
   fprintf(log_file, "LBA %lu is mapped to wrong physical address\n", lba);